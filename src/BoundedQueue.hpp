@@ -0,0 +1,82 @@
+// File name: BoundedQueue.hpp
+// Created on: 18-October-2026
+
+#ifndef BOUNDEDQUEUE_HPP_
+#define BOUNDEDQUEUE_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+ * Blocking FIFO with a fixed capacity, used to hand work between the stages
+ * of a threaded pipeline. Producers block while the queue is full, consumers
+ * block while it is empty. Once close() is called, push() fails and pop()
+ * drains the remaining items before failing.
+ */
+template <typename T>
+class BoundedQueue{
+
+    public:
+        explicit BoundedQueue(std::size_t capacity)
+            : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+        /**
+         * Add an item, waiting for space if the queue is full
+         * @param item the item to add
+         * @return false if the queue was closed and the item was dropped
+         */
+        bool push(T item){
+            std::unique_lock<std::mutex> lock(mtx);
+            not_full.wait(lock, [this]{
+                return closed || items.size() < capacity;
+            });
+            if(closed){
+                return false;
+            }
+            items.push_back(std::move(item));
+            not_empty.notify_one();
+            return true;
+        }
+
+        /**
+         * Remove the oldest item, waiting for one if the queue is empty
+         * @param item where the removed item is stored
+         * @return false if the queue is closed and empty
+         */
+        bool pop(T &item){
+            std::unique_lock<std::mutex> lock(mtx);
+            not_empty.wait(lock, [this]{
+                return closed || !items.empty();
+            });
+            if(items.empty()){
+                return false;
+            }
+            item = std::move(items.front());
+            items.pop_front();
+            not_full.notify_one();
+            return true;
+        }
+
+        /**
+         * Stop accepting items and wake every waiting thread
+         */
+        void close(){
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+
+    private:
+        std::deque<T> items;
+        std::size_t capacity;
+        bool closed;
+        std::mutex mtx;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+};
+
+#endif /* BOUNDEDQUEUE_HPP_ */
@@ -0,0 +1,170 @@
+// File name: CellMoments.cpp
+// Created on: 18-October-2026
+
+#include "CellMoments.hpp"
+
+/**
+ * @param cell_count the number of cells of the volume
+ * @param groups the moment groups to keep for every cell
+ */
+CellMoments::CellMoments(size_t cell_count,
+        const std::vector<MomentGroup> &groups) : groups(groups){
+    stride = 0;
+    sketch_stride = 0;
+    for (size_t g = 0; g < groups.size(); g++) {
+        group_offsets.push_back(stride);
+        stride += MOMENT_M2 + (groups[g].power > 1 ? groups[g].power - 1 : 0);
+        sketch_index.push_back(groups[g].quantiles ? (int)sketch_stride++ : -1);
+    }
+    values.assign(cell_count * stride, 0);
+    sketches.resize(cell_count * sketch_stride);
+    for (size_t cell = 0; cell < cell_count; cell++) {
+        for (size_t g = 0; g < groups.size(); g++) {
+            double *group = &values[cell * stride + group_offsets[g]];
+            group[MOMENT_MAX] = (float) NO_DATA;
+            group[MOMENT_MIN] = (float) MAX_ELEV;
+        }
+    }
+}
+
+/**
+ * Fold a peak into the moments of a cell
+ * @param cell the cell of the volume the peak is in
+ * @param peak the peak
+ */
+void CellMoments::add(size_t cell, const PeakRecord &peak){
+    double *cell_values = &values[cell * stride];
+    for (size_t g = 0; g < groups.size(); g++) {
+        if (!counts(peak, groups[g].peaks)) {
+            continue;
+        }
+        double *group = cell_values + group_offsets[g];
+        float cur_val = peak_value(peak, groups[g].var);
+        if (cur_val > group[MOMENT_MAX]) {
+            group[MOMENT_MAX] = cur_val;
+        }
+        if (cur_val < group[MOMENT_MIN]) {
+            group[MOMENT_MIN] = cur_val;
+        }
+
+        double n1 = group[MOMENT_COUNT];
+        double n = n1 + 1;
+        double delta = cur_val - group[MOMENT_MEAN];
+        double delta_n = delta / n;
+        double term = delta * delta_n * n1;
+        group[MOMENT_COUNT] = n;
+        group[MOMENT_MEAN] += delta_n;
+        //Each higher moment is updated from the lower ones before they change
+        int power = groups[g].power;
+        if (power >= 4) {
+            group[MOMENT_M4] += term * delta_n * delta_n * (n * n - 3 * n + 3)
+                + 6 * delta_n * delta_n * group[MOMENT_M2]
+                - 4 * delta_n * group[MOMENT_M3];
+        }
+        if (power >= 3) {
+            group[MOMENT_M3] += term * delta_n * (n - 2)
+                - 3 * delta_n * group[MOMENT_M2];
+        }
+        if (power >= 2) {
+            group[MOMENT_M2] += term;
+        }
+        if (sketch_index[g] >= 0) {
+            sketches[cell * sketch_stride + sketch_index[g]].add(cur_val);
+        }
+    }
+}
+
+/**
+ * @param peaks the code of the peaks of the group
+ * @param var the code of the variable of the group
+ * @param power the highest power of the distance from the mean needed
+ * @param quantiles whether a sketch of the values is needed
+ * @return the index of a group with at least these moments, -1 if none
+ */
+int CellMoments::find_group(int peaks, int var, int power,
+        bool quantiles) const{
+    for (size_t g = 0; g < groups.size(); g++) {
+        if (groups[g].peaks == peaks && groups[g].var == var &&
+                groups[g].power >= power &&
+                (groups[g].quantiles || !quantiles)) {
+            return g;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @return the bytes held by the moments and sketches of every cell
+ */
+size_t CellMoments::bytes() const{
+    size_t total = values.size() * sizeof(double);
+    for (const QuantileSketch &cell_sketch : sketches) {
+        total += cell_sketch.bytes();
+    }
+    return total;
+}
+
+/**
+ * get the property value from a peak record
+ * @param peak the record to extract data from
+ * @param prod_var the code of the variable
+ * @return the property value of the peak, 0 for an unknown variable
+ */
+float CellMoments::peak_value(const PeakRecord &peak, int prod_var){
+    switch (prod_var){
+        case 0: //elevation
+            return peak.elev;
+        case 1: //amplitude
+            return peak.amp;
+        case 2: //pulse width
+            return peak.width;
+        case 3: //rise time
+            return peak.rise_time;
+        case 4: //backscatter coefficient
+            return peak.backscatter;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @param prod_calc the code of a calculation
+ * @return the fraction of the values below the quantile the calculation
+ * finds, -1 if it is not a quantile
+ */
+double CellMoments::quantile_of(int prod_calc){
+    switch (prod_calc){
+        case 6: //median
+            return 0.5;
+        case 7: //10th percentile
+            return 0.1;
+        case 8: //25th percentile
+            return 0.25;
+        case 9: //75th percentile
+            return 0.75;
+        case 10: //90th percentile
+            return 0.9;
+        case 11: //98th percentile
+            return 0.98;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @param peak the record to check
+ * @param prod_peaks the code of the peaks to use
+ * @return whether the peak passes the peak filter
+ */
+bool CellMoments::counts(const PeakRecord &peak, int prod_peaks){
+    switch (prod_peaks){
+        case 0: //first
+            return peak.flags & PEAK_RECORD_FIRST;
+        case 1: //last
+            return peak.flags & PEAK_RECORD_LAST;
+        case 2: //all
+            return true;
+        default:
+            return false;
+    }
+}
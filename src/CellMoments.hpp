@@ -0,0 +1,116 @@
+// File name: CellMoments.hpp
+// Created on: 18-October-2026
+
+#ifndef CELLMOMENTS_HPP_
+#define CELLMOMENTS_HPP_
+
+#include <cmath>
+#include <vector>
+#include "PeakTiles.hpp"
+#include "QuantileSketch.hpp"
+
+const double NO_DATA = -99999;
+const double MAX_ELEV = 99999.99;
+
+// Calculation codes of the quantile products, the median, P10, P25, P75, P90
+// and P98 follow the moments
+#define FIRST_QUANTILE_CALC 6
+#define QUANTILE_CALC_COUNT 6
+
+// Slots of the moments of a group, see CellMoments::moments
+#define MOMENT_COUNT 0
+#define MOMENT_MEAN 1
+#define MOMENT_MAX 2
+#define MOMENT_MIN 3
+#define MOMENT_M2 4
+#define MOMENT_M3 5
+#define MOMENT_M4 6
+
+//Products that share a peak filter and a variable
+struct MomentGroup{
+    int peaks;
+    int var;
+    int power; //highest power of the distance from the mean wanted,
+               //2 for std-dev, 3 skewness, 4 kurtosis, 0 for none
+    bool quantiles; //whether a quantile sketch of the values is wanted
+};
+
+/**
+ * Running moments of every cell of a volume, for a fixed set of moment
+ * groups. Peaks are folded in as they are found and need not be kept, so the
+ * memory used only depends on the number of cells and the groups asked for.
+ * Each cell holds the count, mean, max and min of every group, followed by
+ * the sums of the powers of the distance from the mean up to the power of the
+ * group, updated one peak at a time as in Welford and Pebay. Groups wanting
+ * quantiles also keep a QuantileSketch of each cell, bounded in size however
+ * many peaks the cell has.
+ */
+class CellMoments{
+
+    public:
+        CellMoments(size_t cell_count, const std::vector<MomentGroup> &groups);
+
+        void add(size_t cell, const PeakRecord &peak);
+        int find_group(int peaks, int var, int power,
+                bool quantiles = false) const;
+        //The moments of a group in a cell, indexed by the MOMENT_ slots
+        const double* moments(size_t cell, size_t group) const {
+            return &values[cell * stride + group_offsets[group]];
+        }
+        //The sketch of a group wanting quantiles in a cell
+        const QuantileSketch& sketch(size_t cell, size_t group) const {
+            return sketches[cell * sketch_stride + sketch_index[group]];
+        }
+        size_t bytes() const;
+
+        static float peak_value(const PeakRecord &peak, int prod_var);
+        static bool counts(const PeakRecord &peak, int prod_peaks);
+        static double quantile_of(int prod_calc);
+
+        //peak_value and counts for codes known when compiling, so a kernel
+        //over many peaks picks the field and filter once
+        template <int PROD_VAR>
+        static float peak_value(const PeakRecord &peak){
+            return PROD_VAR == 0 ? peak.elev : PROD_VAR == 1 ? peak.amp :
+                PROD_VAR == 2 ? peak.width : PROD_VAR == 3 ? peak.rise_time :
+                PROD_VAR == 4 ? peak.backscatter : 0;
+        }
+        template <int PROD_PEAKS>
+        static bool counts(const PeakRecord &peak){
+            return PROD_PEAKS == 0 ? (peak.flags & PEAK_RECORD_FIRST) != 0 :
+                PROD_PEAKS == 1 ? (peak.flags & PEAK_RECORD_LAST) != 0 :
+                PROD_PEAKS == 2;
+        }
+
+        /**
+         * Raise a distance from the mean to a power by multiplying, the
+         * fourth power as the square of the square, the same way every
+         * statistic of the products does
+         */
+        template <int POWER>
+        static double power_of(double diff){
+            return POWER == 2 ? diff * diff :
+                POWER == 3 ? diff * diff * diff :
+                POWER == 4 ? (diff * diff) * (diff * diff) :
+                std::pow(diff, POWER);
+        }
+        static double power_of(double diff, int power){
+            return power == 2 ? power_of<2>(diff) :
+                power == 3 ? power_of<3>(diff) :
+                power == 4 ? power_of<4>(diff) : std::pow(diff, power);
+        }
+
+    private:
+        std::vector<MomentGroup> groups;
+        std::vector<size_t> group_offsets;
+        //Doubles of every cell
+        size_t stride;
+        std::vector<double> values;
+        //Sketches of every cell, sketch_stride of them, and the place of the
+        //sketch of each group among them, -1 if it wants no quantiles
+        std::vector<int> sketch_index;
+        size_t sketch_stride;
+        std::vector<QuantileSketch> sketches;
+};
+
+#endif /* CELLMOMENTS_HPP_ */
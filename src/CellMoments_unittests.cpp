@@ -0,0 +1,83 @@
+// File name: CellMoments_unittests.cpp
+// Created on: 18-October-2026
+
+#include "CellMoments.hpp"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+class CellMomentsTest : public testing::Test {
+    protected:
+
+        static PeakRecord make_record(float amp, float elev, uint32_t flags){
+            PeakRecord peak = PeakRecord();
+            peak.amp = amp;
+            peak.elev = elev;
+            peak.flags = flags;
+            return peak;
+        }
+};
+
+//Tests that the slots kept depend on the groups asked for
+TEST_F(CellMomentsTest, layout){
+    std::vector<MomentGroup> groups = {{2, 1, 0, false}, {0, 0, 4, false}, {1, 1, 2, false}};
+    CellMoments moments(10, groups);
+    EXPECT_EQ(10 * (4 + 7 + 5) * sizeof(double), moments.bytes());
+
+    EXPECT_EQ(0, moments.find_group(2, 1, 0));
+    EXPECT_EQ(1, moments.find_group(0, 0, 3));
+    EXPECT_EQ(2, moments.find_group(1, 1, 2));
+    EXPECT_EQ(-1, moments.find_group(1, 1, 3));
+    EXPECT_EQ(-1, moments.find_group(2, 0, 0));
+
+    const double *empty = moments.moments(9, 1);
+    EXPECT_EQ(0, empty[MOMENT_COUNT]);
+    EXPECT_EQ((float) NO_DATA, empty[MOMENT_MAX]);
+    EXPECT_EQ((float) MAX_ELEV, empty[MOMENT_MIN]);
+}
+
+//Tests the running moments against sums over the kept values
+TEST_F(CellMomentsTest, runningMoments){
+    std::vector<MomentGroup> groups = {{2, 1, 4, false}, {0, 1, 2, false}};
+    CellMoments moments(3, groups);
+    std::vector<float> all, first;
+    srand(7);
+    for (int i = 0; i < 200; i++) {
+        float amp = rand() % 10000 / 100.0;
+        uint32_t flags = i % 3 == 0 ? PEAK_RECORD_FIRST : 0;
+        moments.add(1, make_record(amp, 0, flags));
+        all.push_back(amp);
+        if (flags) {
+            first.push_back(amp);
+        }
+    }
+
+    double mean = 0;
+    for (float value : all) {
+        mean += value;
+    }
+    mean /= all.size();
+    double sums[5] = {0, 0, 0, 0, 0};
+    for (float value : all) {
+        for (int power = 2; power <= 4; power++) {
+            sums[power] += pow(value - mean, power);
+        }
+    }
+
+    const double *cell = moments.moments(1, 0);
+    EXPECT_EQ(200, cell[MOMENT_COUNT]);
+    EXPECT_NEAR(mean, cell[MOMENT_MEAN], 1e-9);
+    EXPECT_EQ(*std::max_element(all.begin(), all.end()), cell[MOMENT_MAX]);
+    EXPECT_EQ(*std::min_element(all.begin(), all.end()), cell[MOMENT_MIN]);
+    EXPECT_NEAR(1, cell[MOMENT_M2] / sums[2], 1e-9);
+    EXPECT_NEAR(sums[3] / sums[2], cell[MOMENT_M3] / sums[2], 1e-9);
+    EXPECT_NEAR(1, cell[MOMENT_M4] / sums[4], 1e-9);
+
+    cell = moments.moments(1, 1);
+    EXPECT_EQ(first.size(), cell[MOMENT_COUNT]);
+
+    //Other cells are untouched
+    EXPECT_EQ(0, moments.moments(0, 0)[MOMENT_COUNT]);
+    EXPECT_EQ(0, moments.moments(2, 1)[MOMENT_COUNT]);
+}
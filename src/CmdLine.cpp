@@ -4,15 +4,18 @@
 
 
 #include "CmdLine.hpp" 
+#include "CellMoments.hpp"
 #include <iostream>
 #include "spdlog/spdlog.h"
 #include <math.h>
+#include <cctype>
+#include <algorithm>
 
 using namespace std;
 
-//type is ((id - 1) % 6)
-const static std::string prod_calc[6] = {"max", "min", "mean", "stdev", "skew",
-    "kurt"};
+//type is ((id - 1) % 6), the quantiles following the moments
+const static std::string prod_calc[12] = {"max", "min", "mean", "stdev", "skew",
+    "kurt", "median", "p10", "p25", "p75", "p90", "p98"};
 //data used is floor(((id -1) % 18) / 6)
 const static std::string prod_peaks[3] = {"first", "last", "all"};
 //variable is ((id - 1) / 18)
@@ -38,6 +41,10 @@ const static std::vector<int> start = {0,18,36,54,72,90};//,96,102};
  */
 void CmdLine::setInputFileName(char *args){
     plsFileName = args;
+    std::string extension = PEAK_STORE_EXTENSION;
+    is_peak_store = plsFileName.size() > extension.size()
+        && plsFileName.compare(plsFileName.size() - extension.size(),
+                extension.size(), extension) == 0;
     check_input_file_exists();
 }
 
@@ -55,7 +62,9 @@ void CmdLine::setUsageMessage()
     buffer << std::endl;
     buffer << "Options:  " << std::endl;
     buffer << "       -f  <path to pls file>"
-        << "  :Generates a Geotif file" << std::endl;
+        << "  :Generates a Geotif file, from a peak store written with"
+        << " --emit-peaks if the path ends in " << PEAK_STORE_EXTENSION
+        << std::endl;
     buffer << "       -h [adv]"
         << "  :Prints this help message, the argument 'adv' will display the "
         << "advanced command line options" << std::endl << std::endl;
@@ -100,6 +109,28 @@ void CmdLine::setUsageMessage()
     buffer << "| Std.Dev     | All         | 16             |" << std::endl;
     buffer << "| Skewness    | All         | 17             |" << std::endl;
     buffer << "| Kurtosis    | All         | 18             |" << std::endl;
+    buffer << "| Median      | First       | 19             |" << std::endl;
+    buffer << "| 10th Pctl.  | First       | 20             |" << std::endl;
+    buffer << "| 25th Pctl.  | First       | 21             |" << std::endl;
+    buffer << "| 75th Pctl.  | First       | 22             |" << std::endl;
+    buffer << "| 90th Pctl.  | First       | 23             |" << std::endl;
+    buffer << "| 98th Pctl.  | First       | 24             |" << std::endl;
+    buffer << "| Median      | Last        | 25             |" << std::endl;
+    buffer << "| 10th Pctl.  | Last        | 26             |" << std::endl;
+    buffer << "| 25th Pctl.  | Last        | 27             |" << std::endl;
+    buffer << "| 75th Pctl.  | Last        | 28             |" << std::endl;
+    buffer << "| 90th Pctl.  | Last        | 29             |" << std::endl;
+    buffer << "| 98th Pctl.  | Last        | 30             |" << std::endl;
+    buffer << "| Median      | All         | 31             |" << std::endl;
+    buffer << "| 10th Pctl.  | All         | 32             |" << std::endl;
+    buffer << "| 25th Pctl.  | All         | 33             |" << std::endl;
+    buffer << "| 75th Pctl.  | All         | 34             |" << std::endl;
+    buffer << "| 90th Pctl.  | All         | 35             |" << std::endl;
+    buffer << "| 98th Pctl.  | All         | 36             |" << std::endl;
+    buffer << std::endl;
+    buffer << "Product number 0 selects products 1 to 18. Quantiles are exact"
+        << " for cells of up to " << 2 * QUANTILE_SKETCH_SIZE << " peaks and"
+        << " estimated for larger ones." << std::endl;
     buffer << std::endl;
     buffer << "Valid ways to format the product list include:" << std::endl;
     buffer << "                   -e 1,2,3           (no white-space)" << std::endl;
@@ -116,6 +147,50 @@ void CmdLine::setUsageMessage()
         << "  :Disables gaussian fitter, using first differencing method instead" << std::endl;
     advBuffer << "       -n  <level>"
         << "  :Sets the noise level. Defaults to 6.\n";
+    advBuffer << "       -g  <fitter>"
+        << "  :Sets the gaussian fitting solver, 'gsl' or 'native'. Defaults to gsl."
+        << std::endl;
+    advBuffer << "       -t  <threads>"
+        << "  :Sets the number of threads used to fit pulses and compute products."
+        << " Defaults to 1."
+        << std::endl;
+    advBuffer << "       --mmap"
+        << "  :Reads the pls and wvs files by memory mapping them" << std::endl;
+    advBuffer << "       --bbox <xmin,ymin,xmax,ymax>"
+        << "  :Only creates products for this window, skipping pulses outside"
+        << " of it" << std::endl;
+    advBuffer << "       --resolution <size>[,<size>]*"
+        << "  :Sets the width and height of a cell of the products, in the"
+        << " units of the pls file. Defaults to 1. Several sizes make a set of"
+        << " products for each, named after the size, fitting the pulses once."
+        << std::endl;
+    advBuffer << "       --max_memory <MB>"
+        << "  :Keeps the peaks in tiles, spilling tiles to disk once they use"
+        << " more than this much memory" << std::endl;
+    advBuffer << "       --tile_size <pixels>"
+        << "  :Sets the size of the tiles of the products, 0 writes strips."
+        << " Defaults to " << RASTER_TILE_SIZE << "." << std::endl;
+    advBuffer << "       --compress <method>"
+        << "  :Sets the compression of the products, 'none', 'deflate',"
+        << " 'lzw' or 'zstd'. Defaults to deflate." << std::endl;
+    advBuffer << "       --int16 <scale[,offset]>"
+        << "  :Stores the products as Int16 counts of scale from offset"
+        << " instead of as Float32" << std::endl;
+    advBuffer << "       --overviews"
+        << "  :Gives the products internal overviews, built while they are"
+        << " written" << std::endl;
+    advBuffer << "       --write_memory <MB>"
+        << "  :Sets the memory of finished blocks waiting to be written in the"
+        << " background, 0 writes them on the main thread. Defaults to "
+        << (RASTER_WRITE_MEMORY >> 20) << "." << std::endl;
+    advBuffer << "       --multiband"
+        << "  :Writes every product as a band of a single file" << std::endl;
+    advBuffer << "       --stream"
+        << "  :Keeps only the running moments of each cell instead of its"
+        << " peaks, using memory in proportion to the cells" << std::endl;
+    advBuffer << "       --emit-peaks <file>"
+        << "  :Writes every fitted peak to a peak store, which can be given"
+        << " to -f to make products again without fitting" << std::endl;
     advBuffer << "       -v  <verbosity level>"
         << "  :Sets the level of verbosity for the logger to use" << std::endl;
     advBuffer << "           Options are 'trace', 'debug', 'info', 'warn', 'error'"
@@ -177,6 +252,117 @@ bool CmdLine::set_verbosity (char* new_verb) {
     return false;
 }
 
+/**
+ * Parses the window given with --bbox
+ * @param arg "xmin,ymin,xmax,ymax"
+ * @return true if arg is four numbers with xmin < xmax and ymin < ymax
+ */
+bool CmdLine::set_bbox(char* arg){
+    std::stringstream ss(arg);
+    std::string value;
+    std::vector<double> values;
+    while (getline(ss, value, ',')) {
+        try {
+            size_t used;
+            values.push_back(std::stod(value, &used));
+            if (value.find_first_not_of(" \t", used) != std::string::npos) {
+                return false;
+            }
+        } catch (const std::exception& e) {
+            return false;
+        }
+    }
+    if (values.size() != 4 || values[0] >= values[2]
+            || values[1] >= values[3]) {
+        return false;
+    }
+    bbox_x_min = values[0];
+    bbox_y_min = values[1];
+    bbox_x_max = values[2];
+    bbox_y_max = values[3];
+    use_bbox = true;
+    return true;
+}
+
+/**
+ * Parses the cell sizes given with --resolution
+ * @param arg a comma separated list of positive sizes
+ * @return true if every size is valid and none is repeated
+ */
+bool CmdLine::set_resolutions(char* arg){
+    std::stringstream ss(arg);
+    std::string value;
+    std::vector<double> values;
+    while (getline(ss, value, ',')) {
+        try {
+            size_t used;
+            values.push_back(std::stod(value, &used));
+            if (value.find_first_not_of(" \t", used) != std::string::npos) {
+                return false;
+            }
+        } catch (const std::exception& e) {
+            return false;
+        }
+        if (!std::isfinite(values.back()) || values.back() <= 0 ||
+                std::count(values.begin(), values.end() - 1,
+                    values.back()) > 0) {
+            return false;
+        }
+    }
+    if (values.empty()) {
+        return false;
+    }
+    resolutions = values;
+    return true;
+}
+
+/**
+ * Parses the compression given with --compress
+ * @param arg "none", "deflate", "lzw" or "zstd", in any case
+ * @return true if arg is one of these
+ */
+bool CmdLine::set_compression(char* arg){
+    std::string method(arg);
+    for (char &c : method) {
+        c = toupper(c);
+    }
+    if (method != "NONE" && method != "DEFLATE" && method != "LZW" &&
+            method != "ZSTD") {
+        return false;
+    }
+    raster_options.compression = method;
+    return true;
+}
+
+/**
+ * Parses the encoding given with --int16
+ * @param arg "scale" or "scale,offset", the products are stored as a count
+ * of scale from offset
+ * @return true if arg is one or two numbers and scale is positive
+ */
+bool CmdLine::set_int16(char* arg){
+    std::stringstream ss(arg);
+    std::string value;
+    std::vector<double> values;
+    while (getline(ss, value, ',')) {
+        try {
+            size_t used;
+            values.push_back(std::stod(value, &used));
+            if (value.find_first_not_of(" \t", used) != std::string::npos) {
+                return false;
+            }
+        } catch (const std::exception& e) {
+            return false;
+        }
+    }
+    if (values.empty() || values.size() > 2 || !(values[0] > 0)) {
+        return false;
+    }
+    raster_options.int16_scale = values[0];
+    raster_options.int16_offset = values.size() == 2 ? values[1] : 0;
+    return true;
+}
+
 /**
  * Function that parses the command line arguments
  * @param argc count of arguments
@@ -220,6 +406,20 @@ bool CmdLine::parse_args(int argc,char *argv[]){
         {"backscatter", required_argument,NULL,'b'},
         {"all", required_argument,NULL,'l'},
         {"max_amp_multiplier", required_argument, NULL, 'm'},
+        {"threads", required_argument, NULL, 't'},
+        {"fitter", required_argument, NULL, 'g'},
+        {"mmap", no_argument, NULL, 'M'},
+        {"bbox", required_argument, NULL, 'B'},
+        {"resolution", required_argument, NULL, 'R'},
+        {"max_memory", required_argument, NULL, 'X'},
+        {"stream", no_argument, NULL, 'S'},
+        {"tile_size", required_argument, NULL, 'T'},
+        {"compress", required_argument, NULL, 'C'},
+        {"int16", required_argument, NULL, 'I'},
+        {"multiband", no_argument, NULL, 'U'},
+        {"overviews", no_argument, NULL, 'O'},
+        {"write_memory", required_argument, NULL, 'W'},
+        {"emit-peaks", required_argument, NULL, 'P'},
         {0, 0, 0, 0}
     };
 
@@ -233,7 +433,7 @@ bool CmdLine::parse_args(int argc,char *argv[]){
      * ":h:ds:" indicate that option 'd' is without arguments while
      * option 'h' and 's' require arguments
      */
-    while((optionChar = getopt_long (argc, argv, "-:hdf:n:e:a:w:r:b:l:v:m:",
+    while((optionChar = getopt_long (argc, argv, "-:hdf:n:e:a:w:r:b:l:v:m:t:g:",
                     long_options, &option_index))!= -1){
         if (optionChar == 'f') { //Set the filename to parse
             fArg = optarg;
@@ -253,6 +453,110 @@ bool CmdLine::parse_args(int argc,char *argv[]){
                 msgs.push_back("Cannot fit noise level in type int. Error: " + std::string(e.what()));
                 printUsageMessage = true;
             }
+        } else if (optionChar == 't'){
+            try{
+                num_threads = std::stoi(optarg);
+                if (num_threads < 1){
+                    msgs.push_back("Number of threads must be at least 1");
+                    printUsageMessage = true;
+                }
+            }catch(const std::invalid_argument& e){
+                msgs.push_back("Cannot convert number of threads to int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }catch(const std::out_of_range& e){
+                msgs.push_back("Cannot fit number of threads in type int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'M'){ //Long option only
+            use_mmap = true;
+        } else if (optionChar == 'B'){ //Long option only
+            if (!set_bbox(optarg)) {
+                msgs.push_back("Invalid bounding box, expected "
+                        "xmin,ymin,xmax,ymax: " + std::string(optarg));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'T'){ //Long option only
+            try{
+                raster_options.tile_size = std::stoi(optarg);
+                if (raster_options.tile_size < 0 ||
+                        raster_options.tile_size % 16 != 0){
+                    msgs.push_back("Tile size must be a multiple of 16, or 0"
+                            " to write strips");
+                    printUsageMessage = true;
+                }
+            }catch(const std::invalid_argument& e){
+                msgs.push_back("Cannot convert tile size to int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }catch(const std::out_of_range& e){
+                msgs.push_back("Cannot fit tile size in type int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'R'){ //Long option only
+            if (!set_resolutions(optarg)) {
+                msgs.push_back("Invalid resolution: " + std::string(optarg));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'W'){ //Long option only
+            try{
+                long long megabytes = std::stoll(optarg);
+                if (megabytes < 0){
+                    msgs.push_back("Write memory can not be negative");
+                    printUsageMessage = true;
+                } else {
+                    raster_options.write_memory = (size_t)megabytes << 20;
+                }
+            }catch(const std::invalid_argument& e){
+                msgs.push_back("Cannot convert write memory to int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }catch(const std::out_of_range& e){
+                msgs.push_back("Cannot fit write memory in type long long. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'C'){ //Long option only
+            if (!set_compression(optarg)) {
+                msgs.push_back("Invalid compression: " + std::string(optarg));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'I'){ //Long option only
+            if (!set_int16(optarg)) {
+                msgs.push_back("Invalid Int16 encoding, expected "
+                        "scale[,offset]: " + std::string(optarg));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'O'){ //Long option only
+            raster_options.overviews = true;
+        } else if (optionChar == 'U'){ //Long option only
+            multiband = true;
+        } else if (optionChar == 'S'){ //Long option only
+            stream_products = true;
+        } else if (optionChar == 'P'){ //Long option only
+            emit_peaks = optarg;
+        } else if (optionChar == 'X'){ //Long option only
+            try{
+                long long megabytes = std::stoll(optarg);
+                if (megabytes < 1){
+                    msgs.push_back("Memory limit must be at least 1 MB");
+                    printUsageMessage = true;
+                } else {
+                    max_memory = megabytes;
+                }
+            }catch(const std::invalid_argument& e){
+                msgs.push_back("Cannot convert memory limit to int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }catch(const std::out_of_range& e){
+                msgs.push_back("Cannot fit memory limit in type long long. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'g'){
+            std::string engine(optarg);
+            if (engine == "gsl"){
+                fitter_engine = Fitter::Engine::GSL;
+            } else if (engine == "native"){
+                fitter_engine = Fitter::Engine::Native;
+            } else {
+                msgs.push_back("Invalid fitter: " + engine);
+                printUsageMessage = true;
+            }
         } else if (optionChar == 'v') {
             if (!set_verbosity(optarg)) {
                 msgs.push_back("Invalid logging level");
@@ -271,9 +575,9 @@ bool CmdLine::parse_args(int argc,char *argv[]){
                     string substr;
                     getline(ss, substr, ',');
                     try {
-                        //If the inputted product number is above 18, stop now
+                        //If the inputted product number is above 36, stop now
                         int prod_num = stoi(substr.c_str());
-                        if (prod_num > 18 || prod_num < 0){
+                        if (prod_num > 36 || prod_num < 0){
                             msgs.push_back(string("Invalid product code: ")
                                 + substr);
                             printUsageMessage = true;
@@ -281,6 +585,9 @@ bool CmdLine::parse_args(int argc,char *argv[]){
                             for (int i = start[var]+1; i <= start[var+1]; i++){
                                 selected_products.push_back(i);
                             }
+                        } else if (prod_num > 18){ //Add a quantile product
+                            selected_products.push_back(QUANTILE_PRODUCT_OFFSET
+                                + start[var] + prod_num - 18);
                         } else { //Just add the listed products
                             selected_products.push_back(start[var] + prod_num);
                         }
@@ -356,6 +663,8 @@ bool CmdLine::parse_args(int argc,char *argv[]){
         lastOpt = optionChar;
     }
    
+    raster_options.threads = num_threads;
+
     //Backscatter coefficient requires a calibration constant
     if (calcBackscatter && calibration_constant == 0){
         msgs.push_back("Missing Calibration Constant");
@@ -374,6 +683,12 @@ bool CmdLine::parse_args(int argc,char *argv[]){
         printUsageMessage = true;
     }
 
+    //Peaks are only emitted while fitting
+    if (is_peak_store && !emit_peaks.empty()){
+        msgs.push_back("--emit-peaks needs a pls file to fit");
+        printUsageMessage = true;
+    }
+
     // Make sure at least one product was selected
     if (selected_products.size() < 1){
         msgs.push_back("Select at least one product");
@@ -411,6 +726,11 @@ void CmdLine::check_input_file_exists() {
         }
         printUsageMessage = true;
     }
+    //A peak store has no waves
+    if (is_peak_store) {
+        wvsFileName = "";
+        return;
+    }
     std::size_t idx = plsFileName.rfind(".pls");
     wvsFileName = plsFileName.substr(0,idx) + ".wvs";
     if (!std::ifstream(wvsFileName.c_str())) {
@@ -444,15 +764,42 @@ std::string CmdLine::getTrimmedFileName(bool pls){
  * get the output filename based on the command line arguments and input
  * filename
  * @param product_id the id of the product to produce
+ * @param resolution if not 0, the cell size of the product, added to the name
  * @return the output filename
  */
-std::string CmdLine::get_output_filename(int product_id) {
+std::string CmdLine::get_output_filename(int product_id, double resolution) {
     std::string output_filename = getTrimmedFileName(true);
     //Name file base on method used
     std::string file_type = ".tif";
     std::string fit_type = useGaussianFitting ? "_gaussian" : "_firstDiff";
     std::string prod_desc = "_" + get_product_desc(product_id);
-    return output_filename +  prod_desc + fit_type + file_type;
+    return output_filename +  prod_desc + fit_type +
+        get_resolution_desc(resolution) + file_type;
+}
+
+/**
+ * get the name of the file holding every product, one to a band
+ * @param resolution if not 0, the cell size of the products, added to the
+ * name
+ * @return the output filename
+ */
+std::string CmdLine::get_multiband_filename(double resolution) {
+    std::string fit_type = useGaussianFitting ? "_gaussian" : "_firstDiff";
+    return getTrimmedFileName(true) + "_products" + fit_type +
+        get_resolution_desc(resolution) + ".tif";
+}
+
+/**
+ * @param resolution a cell size, or 0
+ * @return the cell size as a part of a filename, "_2.5m" for 2.5, empty for 0
+ */
+std::string CmdLine::get_resolution_desc(double resolution) {
+    if (resolution == 0) {
+        return "";
+    }
+    std::ostringstream desc;
+    desc << "_" << resolution << "m";
+    return desc.str();
 }
 
 /**
@@ -471,6 +818,10 @@ std::string CmdLine::get_product_desc(int id){
  * @return the code for the calculation used
  */
 int CmdLine::get_calculation_code(int id){
+    if (id > QUANTILE_PRODUCT_OFFSET) {
+        return FIRST_QUANTILE_CALC
+            + get_calculation_code(id - QUANTILE_PRODUCT_OFFSET);
+    }
     //loop through variable start points until the product id is less than
     //the start point of the next variable
     size_t i;
@@ -485,6 +836,9 @@ int CmdLine::get_calculation_code(int id){
  * @return the code for the peaks used
  */
 int CmdLine::get_peaks_code(int id){
+    if (id > QUANTILE_PRODUCT_OFFSET) {
+        return get_peaks_code(id - QUANTILE_PRODUCT_OFFSET);
+    }
     //loop through variable start points until the product id is less than
     //the start point of the next variable
     size_t i;
@@ -501,6 +855,9 @@ int CmdLine::get_peaks_code(int id){
  * @return the code for the variable used
  */
 int CmdLine::get_variable_code(int id){
+    if (id > QUANTILE_PRODUCT_OFFSET) {
+        return get_variable_code(id - QUANTILE_PRODUCT_OFFSET);
+    }
     //loop through variable start points until the product id is less than
     //the start point of the next variable 
     size_t i;
@@ -15,8 +15,15 @@
 #include <cstring>
 #include <stdexcept>
 #include <stdlib.h>
+#include "Fitter.hpp"
+#include "RasterWriter.hpp"
+#include "PeakStore.hpp"
 #include <map>
 
+// Product ids of the quantile products are offset by this from the id of the
+// moment product of the same peaks and variable six calculations before
+#define QUANTILE_PRODUCT_OFFSET 1000
+
 class CmdLine{
 
 private:
@@ -34,6 +41,10 @@ private:
     bool max_elev_flag;
 
     bool set_verbosity(char* new_verb);
+    bool set_bbox(char* arg);
+    bool set_resolutions(char* arg);
+    bool set_compression(char* arg);
+    bool set_int16(char* arg);
 
 public:
     //calibration constant (for backscatter option)
@@ -48,6 +59,49 @@ public:
     //Default noise level
     int noise_level = 6;
 
+    //Number of threads used to fit pulses and compute products, 1 works on
+    //the calling thread
+    int num_threads = 1;
+
+    //Solver used for gaussian fitting
+    Fitter::Engine fitter_engine = Fitter::Engine::GSL;
+
+    //Read the input by memory mapping it instead of through PulseWaves
+    bool use_mmap = false;
+
+    //Only process pulses inside this window, set by --bbox
+    bool use_bbox = false;
+    double bbox_x_min = 0, bbox_y_min = 0, bbox_x_max = 0, bbox_y_max = 0;
+
+    //Width and height of a cell of the products, in the units of the pls
+    //file, set by --resolution. Each resolution gets a set of products of its
+    //own from a single fit of the pulses.
+    std::vector<double> resolutions = std::vector<double>(1, 1.0);
+
+    //Megabytes of peaks kept in memory before tiles of the volume are spilled
+    //to disk, 0 keeps the whole volume in memory
+    size_t max_memory = 0;
+
+    //Keep only the running moments of each cell the selected products need,
+    //instead of every peak, set by --stream
+    bool stream_products = false;
+
+    //Peak store every fitted peak is written to, set by --emit-peaks
+    std::string emit_peaks;
+
+    //The input is a peak store written with --emit-peaks instead of a pls
+    //file, so the products are made without fitting
+    bool is_peak_store = false;
+
+    //Tiling, compression, encoding and overviews of the products and the
+    //memory of blocks waiting to be written, set by --tile_size, --compress,
+    //--int16, --overviews and --write_memory. Products are compressed on as many threads as
+    //pulses are fitted on.
+    RasterOptions raster_options;
+
+    //Write every product as a band of one file, set by --multiband
+    bool multiband = false;
+
     // Whether or not backscatter coefficient has been requested
     bool calcBackscatter;
 
@@ -73,7 +127,9 @@ public:
     void setInputFileName(std::string filename);
     std::string getInputFileName(bool pls);
     std::string getTrimmedFileName(bool pls);
-    std::string get_output_filename(int product_id);
+    std::string get_output_filename(int product_id, double resolution = 0);
+    std::string get_multiband_filename(double resolution = 0);
+    std::string get_resolution_desc(double resolution);
     std::string get_product_desc(int product_id);
     int get_calculation_code(int id);
     int get_peaks_code(int id);
@@ -114,6 +114,41 @@ TEST_F(CmdLineTest, invalidFileName){
     ASSERT_TRUE(cmd.printUsageMessage);
 }
 
+//Tests a peak store given in place of a pls file, and writing one
+TEST_F(CmdLineTest, peakStoreFile){
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"--emit-peaks",13);
+    strncpy(commonArgSpace[6],"do_not_use.peaks",17);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_FALSE(cmd.is_peak_store);
+    EXPECT_EQ("do_not_use.peaks", cmd.emit_peaks);
+    EXPECT_TRUE(cmd2.emit_peaks.empty());
+
+    //Read without a wvs file
+    std::ofstream store ("do_not_use.peaks");
+    store.close();
+    std::remove("do_not_use.wvs");
+    optind = 0;
+    numberOfArgs = 5;
+    strncpy(commonArgSpace[2],"do_not_use.peaks",17);
+    cmd2.quiet = true;
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    EXPECT_FALSE(cmd2.printUsageMessage);
+    EXPECT_TRUE(cmd2.is_peak_store);
+    EXPECT_EQ("do_not_use_max_first_elev_gaussian.tif",
+            cmd2.get_output_filename(1));
+
+    //Emitting peaks needs fitting
+    optind = 0;
+    numberOfArgs = 7;
+    cmd3.quiet = true;
+    ASSERT_NO_THROW(cmd3.parse_args(numberOfArgs,commonArgSpace));
+    EXPECT_TRUE(cmd3.printUsageMessage);
+    std::remove("do_not_use.peaks");
+}
+
 //Tests file was correctly trimmed with various paths
 TEST_F(CmdLineTest, fileTrimmingTestPath){
     numberOfArgs = 5;
@@ -218,7 +253,7 @@ TEST_F(CmdLineTest, invalidProductNumber){
     //Invalid product number
     optind = 0;
     numberOfArgs = 5;
-    strncpy(commonArgSpace[4],"19",3);
+    strncpy(commonArgSpace[4],"37",3);
     ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
     ASSERT_TRUE(cmd.printUsageMessage);
 
@@ -430,6 +465,258 @@ TEST_F(CmdLineTest, invalidLongOption){
     ASSERT_TRUE(cmd.printUsageMessage);
 }
 
+//Tests the number of fitting threads option
+TEST_F(CmdLineTest, validThreadsOption){
+    //Defaults to fitting on a single thread
+    optind = 0;
+    numberOfArgs = 5;
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_EQ(1, cmd.num_threads);
+
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"-t",3);
+    strncpy(commonArgSpace[6],"4",2);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_EQ(4, cmd.num_threads);
+
+    optind = 0;
+    strncpy(commonArgSpace[5],"--threads",10);
+    strncpy(commonArgSpace[6],"8",2);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd2.printUsageMessage);
+    EXPECT_EQ(8, cmd2.num_threads);
+}
+
+//Tests invalid numbers of fitting threads
+TEST_F(CmdLineTest, invalidThreadsOption){
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"-t",3);
+    strncpy(commonArgSpace[6],"0",2);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd.printUsageMessage);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"four",5);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd2.printUsageMessage);
+}
+
+//Tests the fitter engine option
+TEST_F(CmdLineTest, fitterOption){
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"--fitter",9);
+    strncpy(commonArgSpace[6],"native",7);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_TRUE(cmd.fitter_engine == Fitter::Engine::Native);
+
+    optind = 0;
+    strncpy(commonArgSpace[5],"-g",3);
+    strncpy(commonArgSpace[6],"gsl",4);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd2.printUsageMessage);
+    EXPECT_TRUE(cmd2.fitter_engine == Fitter::Engine::GSL);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"lm",3);
+    ASSERT_NO_THROW(cmd3.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd3.printUsageMessage);
+}
+
+//Tests the memory mapped reader option
+TEST_F(CmdLineTest, mmapOption){
+    optind = 0;
+    numberOfArgs = 5;
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    EXPECT_FALSE(cmd.use_mmap);
+
+    optind = 0;
+    numberOfArgs = 6;
+    strncpy(commonArgSpace[5],"--mmap",7);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd2.printUsageMessage);
+    EXPECT_TRUE(cmd2.use_mmap);
+}
+
+//Tests the window option
+TEST_F(CmdLineTest, bboxOption){
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"--bbox",7);
+    strncpy(commonArgSpace[6],"516400.5,4767900,516500,4768000",32);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_TRUE(cmd.use_bbox);
+    EXPECT_EQ(516400.5, cmd.bbox_x_min);
+    EXPECT_EQ(4767900, cmd.bbox_y_min);
+    EXPECT_EQ(516500, cmd.bbox_x_max);
+    EXPECT_EQ(4768000, cmd.bbox_y_max);
+
+    //Three values, and a window with its corners swapped
+    optind = 0;
+    strncpy(commonArgSpace[6],"1,2,3",6);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd2.printUsageMessage);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"3,4,1,2",8);
+    ASSERT_NO_THROW(cmd3.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd3.printUsageMessage);
+}
+
+//Tests the size of a cell of the products
+TEST_F(CmdLineTest, resolutionOption){
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"--resolution",13);
+    strncpy(commonArgSpace[6],"2.5",4);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    ASSERT_EQ(1u, cmd.resolutions.size());
+    EXPECT_EQ(2.5, cmd.resolutions[0]);
+    ASSERT_EQ(1u, cmd2.resolutions.size());
+    EXPECT_EQ(1, cmd2.resolutions[0]);
+
+    //Several resolutions, in the order given
+    CmdLine cmd4;
+    optind = 0;
+    strncpy(commonArgSpace[6],"1,5,30",7);
+    ASSERT_NO_THROW(cmd4.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd4.printUsageMessage);
+    ASSERT_EQ(3u, cmd4.resolutions.size());
+    EXPECT_EQ(1, cmd4.resolutions[0]);
+    EXPECT_EQ(5, cmd4.resolutions[1]);
+    EXPECT_EQ(30, cmd4.resolutions[2]);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"0",2);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd2.printUsageMessage);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"5m",3);
+    ASSERT_NO_THROW(cmd3.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd3.printUsageMessage);
+
+    //A repeated or missing resolution in a list
+    CmdLine cmd5, cmd6;
+    optind = 0;
+    strncpy(commonArgSpace[6],"5,5",4);
+    ASSERT_NO_THROW(cmd5.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd5.printUsageMessage);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"1,,5",5);
+    ASSERT_NO_THROW(cmd6.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd6.printUsageMessage);
+}
+
+//Tests the memory limit of the tiled volume
+TEST_F(CmdLineTest, maxMemoryOption){
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"--max_memory",13);
+    strncpy(commonArgSpace[6],"512",4);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_EQ(512u, cmd.max_memory);
+    EXPECT_EQ(0u, cmd2.max_memory);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"0",2);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd2.printUsageMessage);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"lots",5);
+    ASSERT_NO_THROW(cmd3.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd3.printUsageMessage);
+}
+
+//Tests the streaming accumulator option
+TEST_F(CmdLineTest, streamOption){
+    optind = 0;
+    numberOfArgs = 5;
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    EXPECT_FALSE(cmd.stream_products);
+
+    optind = 0;
+    numberOfArgs = 6;
+    strncpy(commonArgSpace[5],"--stream",9);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd2.printUsageMessage);
+    EXPECT_TRUE(cmd2.stream_products);
+}
+
+//Tests that --overviews gives the products overviews
+TEST_F(CmdLineTest, overviewsOption){
+    optind = 0;
+    numberOfArgs = 6;
+    strncpy(commonArgSpace[5],"--overviews",12);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_TRUE(cmd.raster_options.overviews);
+}
+
+//Tests the memory of blocks waiting to be written
+TEST_F(CmdLineTest, writeMemoryOption){
+    optind = 0;
+    numberOfArgs = 6;
+    strncpy(commonArgSpace[5],"--write_memory=16",18);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_EQ(16u << 20, cmd.raster_options.write_memory);
+
+    optind = 0;
+    strncpy(commonArgSpace[5],"--write_memory=0",17);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd2.printUsageMessage);
+    EXPECT_EQ(0u, cmd2.raster_options.write_memory);
+
+    optind = 0;
+    strncpy(commonArgSpace[5],"--write_memory=-1",18);
+    ASSERT_NO_THROW(cmd3.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd3.printUsageMessage);
+}
+
+//Tests the tiling, compression and encoding of the products
+TEST_F(CmdLineTest, rasterOptions){
+    optind = 0;
+    numberOfArgs = 5;
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    EXPECT_EQ(RASTER_TILE_SIZE, cmd.raster_options.tile_size);
+    EXPECT_EQ("DEFLATE", cmd.raster_options.compression);
+    EXPECT_EQ(0, cmd.raster_options.int16_scale);
+    EXPECT_FALSE(cmd.raster_options.overviews);
+    EXPECT_EQ((size_t) RASTER_WRITE_MEMORY, cmd.raster_options.write_memory);
+
+    optind = 0;
+    numberOfArgs = 10;
+    strncpy(commonArgSpace[5],"--compress",11);
+    strncpy(commonArgSpace[6],"zStd",5);
+    strncpy(commonArgSpace[7],"--int16",8);
+    strncpy(commonArgSpace[8],"0.01,1200",10);
+    strncpy(commonArgSpace[9],"--tile_size=512",16);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd2.printUsageMessage);
+    EXPECT_EQ(512, cmd2.raster_options.tile_size);
+    EXPECT_EQ("ZSTD", cmd2.raster_options.compression);
+    EXPECT_EQ(0.01, cmd2.raster_options.int16_scale);
+    EXPECT_EQ(1200, cmd2.raster_options.int16_offset);
+
+    optind = 0;
+    strncpy(commonArgSpace[6],"jpeg",5);
+    strncpy(commonArgSpace[8],"-1",3);
+    strncpy(commonArgSpace[9],"--tile_size=100",16);
+    ASSERT_NO_THROW(cmd3.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd3.printUsageMessage);
+}
+
 /****************************************************************************
  *
  * Output filename tests
@@ -453,6 +740,33 @@ TEST_F(CmdLineTest, outputFileNameMethod){
             cmd.get_output_filename(1));
 }
 
+//Tests naming of the file holding every product
+TEST_F(CmdLineTest, multibandFileName){
+    optind = 0;
+    numberOfArgs = 6;
+    strncpy(commonArgSpace[5],"--multiband",12);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_TRUE(cmd.multiband);
+    EXPECT_FALSE(cmd2.multiband);
+    EXPECT_EQ("do_not_use_products_gaussian.tif",
+            cmd.get_multiband_filename());
+}
+
+//Tests naming the products of one of several resolutions
+TEST_F(CmdLineTest, resolutionFileName){
+    optind = 0;
+    numberOfArgs = 5;
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_EQ("do_not_use_max_first_elev_gaussian_5m.tif",
+            cmd.get_output_filename(1, 5));
+    EXPECT_EQ("do_not_use_max_first_elev_gaussian_0.5m.tif",
+            cmd.get_output_filename(1, 0.5));
+    EXPECT_EQ("do_not_use_products_gaussian_30m.tif",
+            cmd.get_multiband_filename(30));
+}
+
 //Tests correct naming of variable
 TEST_F(CmdLineTest, outputFileNameVariable){
     //Set calibration coefficient for backscatter test
@@ -508,6 +822,37 @@ TEST_F(CmdLineTest, outputFileNameCalculation){
     }
 }
 
+//Tests the codes and naming of the quantile products
+TEST_F(CmdLineTest, quantileProducts){
+    std::vector<std::string> names = {"median", "p10", "p25", "p75", "p90",
+        "p98"};
+    for (int i = 0; i < 6; i ++){
+        optind = 0;
+        numberOfArgs = 5;
+        strncpy(commonArgSpace[4],std::to_string(i+19).c_str(),3);
+        std::string expectedName = std::string("do_not_use_")
+            + names.at(i) + std::string("_first_elev_gaussian.tif");
+        ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+        ASSERT_FALSE(cmd.printUsageMessage);
+        int id = cmd.selected_products.at(0);
+        EXPECT_EQ(expectedName.c_str(),cmd.get_output_filename(id));
+        EXPECT_EQ(6 + i, cmd.get_calculation_code(id));
+        EXPECT_EQ(0, cmd.get_peaks_code(id));
+        EXPECT_EQ(0, cmd.get_variable_code(id));
+    }
+
+    //98th percentile of the amplitudes of all peaks
+    optind = 0;
+    strncpy(commonArgSpace[3],"-a",3);
+    strncpy(commonArgSpace[4],"36",3);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    int id = cmd.selected_products.at(0);
+    EXPECT_EQ(11, cmd.get_calculation_code(id));
+    EXPECT_EQ(2, cmd.get_peaks_code(id));
+    EXPECT_EQ(1, cmd.get_variable_code(id));
+}
+
 /* Call RUN_ALL_TESTS() in main().
 
    We do this by linking in src/gtest_main.cc file, which consists of
@@ -0,0 +1,85 @@
+// File name: CsvWriter.cpp
+// Created on: 18-October-2026
+
+#include "CsvWriter.hpp"
+#include "spdlog/spdlog.h"
+
+/**
+ * @param buffer_size number of bytes buffered per product before they are
+ * written to the product's file
+ */
+CsvWriter::CsvWriter(size_t buffer_size){
+    this->buffer_size = buffer_size > 0 ? buffer_size : 1;
+}
+
+/**
+ * Open the output file of a product
+ * @param product_id the peak property to write, see Peak::to_string
+ * @param filename the file to write the property to
+ * @return false if the file could not be opened
+ */
+bool CsvWriter::add_product(int product_id, const std::string &filename){
+    ProductOutput output;
+    output.product_id = product_id;
+    output.filename = filename;
+    output.file.reset(new std::ofstream(filename));
+    output.has_values = false;
+    if (!output.file->is_open()) {
+        return false;
+    }
+    output.buffer.reserve(buffer_size);
+    outputs.push_back(std::move(output));
+    return true;
+}
+
+/**
+ * Append the properties of a pulse's peaks to every product. The peaks are
+ * not kept, so the caller is free to delete them afterwards.
+ * @param peaks the peaks to append
+ */
+void CsvWriter::append(const std::vector<Peak*> &peaks){
+    for (ProductOutput &output : outputs) {
+        for (const Peak* peak : peaks) {
+            if (output.has_values) {
+                output.buffer += ",";
+            }
+            peak->to_string(output.buffer, {output.product_id});
+            output.has_values = true;
+        }
+        if (output.buffer.size() >= buffer_size) {
+            flush(output);
+        }
+    }
+}
+
+/**
+ * Write out everything still buffered and close every product's file
+ * @return false if any of the files could not be written
+ */
+bool CsvWriter::close(){
+    bool success = true;
+    for (ProductOutput &output : outputs) {
+        output.buffer += '\n';
+        if (!flush(output)) {
+            success = false;
+        }
+        output.file->close();
+    }
+    outputs.clear();
+    return success;
+}
+
+/**
+ * Write a product's buffered text to its file
+ * @param output the product to write
+ * @return false if the file could not be written
+ */
+bool CsvWriter::flush(ProductOutput &output){
+    output.file->write(output.buffer.data(), output.buffer.size());
+    output.buffer.clear();
+    if (!output.file->good()) {
+        spdlog::error("Failed to write to file {}", output.filename);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+// File name: CsvWriter.hpp
+// Created on: 18-October-2026
+
+#ifndef CSVWRITER_HPP_
+#define CSVWRITER_HPP_
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Peak.hpp"
+
+// Default number of bytes buffered per product before it is written out
+#define CSV_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * Streams peak properties to one csv file per product. Peaks are appended
+ * a pulse at a time, so the whole flight line never has to be held in
+ * memory. Each product keeps at most buffer_size bytes of text before it is
+ * written to its file.
+ */
+class CsvWriter{
+
+    public:
+        CsvWriter(size_t buffer_size = CSV_BUFFER_SIZE);
+
+        bool add_product(int product_id, const std::string &filename);
+        void append(const std::vector<Peak*> &peaks);
+        bool close();
+
+    private:
+        //An open csv file along with the text waiting to be written to it
+        struct ProductOutput{
+            int product_id;
+            std::string filename;
+            std::unique_ptr<std::ofstream> file;
+            std::string buffer;
+            bool has_values;
+        };
+
+        size_t buffer_size;
+        std::vector<ProductOutput> outputs;
+
+        bool flush(ProductOutput &output);
+};
+
+#endif /* CSVWRITER_HPP_ */
@@ -0,0 +1,81 @@
+// File name: CsvWriter_unittests.cpp
+// Created on: 18-October-2026
+
+#include "CsvWriter.hpp"
+#include "gtest/gtest.h"
+#include <fstream>
+#include <sstream>
+
+class CsvWriterTest : public testing::Test {
+    protected:
+
+        virtual void SetUp(){
+            for (int i = 0; i < 3; i++) {
+                Peak *peak = new Peak();
+                peak->amp = 10 * (i + 1);
+                peak->position_in_wave = i + 1;
+                peaks.push_back(peak);
+            }
+        }
+
+        void TearDown(){
+            for (Peak *peak : peaks) {
+                delete peak;
+            }
+            std::remove("do_not_use_amp.csv");
+            std::remove("do_not_use_pos.csv");
+        }
+
+        static std::string read_file(std::string filename){
+            std::ifstream file(filename);
+            std::stringstream contents;
+            contents << file.rdbuf();
+            return contents.str();
+        }
+
+        std::vector<Peak*> peaks;
+};
+
+//Tests that every product gets one comma separated line of its property
+TEST_F(CsvWriterTest, writesEveryProduct){
+    CsvWriter writer;
+    ASSERT_TRUE(writer.add_product(1, "do_not_use_amp.csv"));
+    ASSERT_TRUE(writer.add_product(5, "do_not_use_pos.csv"));
+
+    writer.append(std::vector<Peak*>(peaks.begin(), peaks.begin() + 2));
+    writer.append(std::vector<Peak*>());
+    writer.append(std::vector<Peak*>(peaks.begin() + 2, peaks.end()));
+    ASSERT_TRUE(writer.close());
+
+    EXPECT_EQ(std::to_string(10.0) + "," + std::to_string(20.0) + ","
+            + std::to_string(30.0) + "\n", read_file("do_not_use_amp.csv"));
+    EXPECT_EQ("1,2,3\n", read_file("do_not_use_pos.csv"));
+}
+
+//Tests that a buffer smaller than a single value gives the same output
+TEST_F(CsvWriterTest, smallBuffer){
+    CsvWriter writer(1);
+    ASSERT_TRUE(writer.add_product(5, "do_not_use_pos.csv"));
+
+    for (Peak *peak : peaks) {
+        writer.append({peak});
+    }
+    ASSERT_TRUE(writer.close());
+
+    EXPECT_EQ("1,2,3\n", read_file("do_not_use_pos.csv"));
+}
+
+//Tests that a file with no peaks still ends its line
+TEST_F(CsvWriterTest, noPeaks){
+    CsvWriter writer;
+    ASSERT_TRUE(writer.add_product(1, "do_not_use_amp.csv"));
+    ASSERT_TRUE(writer.close());
+
+    EXPECT_EQ("\n", read_file("do_not_use_amp.csv"));
+}
+
+//Tests that an output file that cannot be opened is reported
+TEST_F(CsvWriterTest, invalidFile){
+    CsvWriter writer;
+    EXPECT_FALSE(writer.add_product(1, "no_such_directory/do_not_use.csv"));
+}
@@ -3,7 +3,9 @@
 #include <gsl/gsl_vector.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <map>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -11,15 +13,19 @@
 #include "spdlog/spdlog.h"
 
 #include "Fitter.hpp"
+#include "GaussianKernels.hpp"
 
 namespace Fitter{
 
 //Small wrapper used to pass variables through the void* params pointer that GSL gives us.
 struct Pulse{
     Pulse() = delete;   //It doesn't make sense to make an empty one of these, since it is a group of aliases
-    Pulse(const std::vector<int>& idxData, const std::vector<int>& ampData) : indexData(idxData), amplitudeData(ampData){};
+    Pulse(const std::vector<int>& idxData, const std::vector<int>& ampData, const std::vector<double>& tData,
+        const std::vector<double>& yData) : indexData(idxData), amplitudeData(ampData), t(tData), y(yData){};
     const std::vector<int>& indexData;
     const std::vector<int>& amplitudeData;
+    const std::vector<double>& t;   //indexData as doubles, for the kernels
+    const std::vector<double>& y;   //amplitudeData as doubles, for the kernels
 };
 
 //https://en.wikipedia.org/wiki/Gaussian_function
@@ -45,6 +51,21 @@ std::string gaussianToString(const gsl_vector& x){
     return result;
 }
 
+/**
+ * Nicely formats a parameter array for debug messages.
+ * @param x     The parameters to format, some multiple of {a,b,c}
+ * @param p     Number of parameters
+ * @return      "{a, b, c} " where a b and c are padded to 6 characters with 2 decimals.
+ */
+std::string gaussianToString(const double* x, std::size_t p){
+    std::string result;
+    for(std::size_t i = 0; i < p/3; ++i){
+        result += fmt::format("{{{:>6.2f}, {:>6.2f}, {:>6.2f}}} ", x[i*3], x[i*3+1], x[i*3+2]);
+    }
+
+    return result;
+}
+
 //@@TODO name
 /**
  * Given the parameters x (which is a list of {a,b,c} tuples), put the error into the vector f.
@@ -60,6 +81,10 @@ int func_f(const gsl_vector* x, void* params, gsl_vector* f){
 
     const Pulse& data = *reinterpret_cast<const Pulse*>(params);
 
+    if(x->stride == 1 && f->stride == 1){   //Contiguous, hand the whole wave to the vector kernels
+        GaussianKernels::residuals(data.t.data(), data.y.data(), data.t.size(), x->data, x->size, f->data);
+        return GSL_SUCCESS;
+    }
 
     for(std::size_t i = 0; i < data.indexData.size(); ++i){
         double t = data.indexData[i];
@@ -99,6 +124,11 @@ int func_df(const gsl_vector* x, void* params, gsl_matrix* J){
 
     const Pulse& data = *reinterpret_cast<const Pulse*>(params);
 
+    if(x->stride == 1){ //Contiguous, hand the whole wave to the vector kernels
+        GaussianKernels::jacobian(data.t.data(), data.t.size(), x->data, x->size, J->data, J->tda);
+        return GSL_SUCCESS;
+    }
+
     for(std::size_t i = 0; i < data.indexData.size(); ++i){
         double t = data.indexData[i];
 
@@ -180,36 +210,455 @@ bool solveSystem(gsl_multifit_nlinear_workspace* workspace, gsl_vector* results)
 }
 
 /**
- * Sets up the workspace for the solver. Note that the workspace returned will later need to be free.
- * @param data      Problem data
- * @param guess     Initial starting guess
- * @param system    Empty system, this needs to have the same lifetime as the returned workspace
- * @param params    Empty params, this needs to have the same lifetime as the returned workspace
- * @return          A ready to use workspace that needs to eventually be freed
+ * A GSL workspace kept for reuse, along with the system and parameter vector it was set up with. The workspace holds
+ * on to a pointer to the system, so they have to live together.
+ */
+struct CachedWorkspace{
+    CachedWorkspace() : workspace(nullptr, &gsl_multifit_nlinear_free), params(nullptr, &gsl_vector_free) {};
+    std::unique_ptr<gsl_multifit_nlinear_workspace, decltype(&gsl_multifit_nlinear_free)> workspace;
+    std::unique_ptr<gsl_vector, decltype(&gsl_vector_free)> params;
+    gsl_multifit_nlinear_fdf system;
+};
+
+//Workspaces for this thread, keyed by {number of samples, number of parameters}
+thread_local std::map<std::pair<std::size_t, std::size_t>, CachedWorkspace> workspaceCache;
+
+/**
+ * The wave being fitted as doubles for the kernels. Kept per thread like the workspaces, so a fit only allocates
+ * when a longer wave than any seen before comes along.
+ */
+struct GslScratch{
+    std::vector<double> t;          //Sample indices
+    std::vector<double> y;          //Sample amplitudes
+};
+
+thread_local GslScratch gslScratch;
+
+//Stop caching new sizes past this many per thread, fits of other sizes get a workspace of their own
+const std::size_t maxCachedWorkspaces = 256;
+
+std::atomic<unsigned long long> workspaceCacheHits{0};
+std::atomic<unsigned long long> workspaceCacheMisses{0};
+
+/**
+ * Allocates a workspace and parameter vector for n samples and p parameters.
+ * @param n         Number of samples
+ * @param p         Number of parameters
+ * @param cached    Output, filled with a newly allocated workspace
+ */
+void allocWorkspace(std::size_t n, std::size_t p, CachedWorkspace& cached){
+    gsl_multifit_nlinear_parameters params = gsl_multifit_nlinear_default_parameters();
+    params.trs = gsl_multifit_nlinear_trs_lmaccel;
+
+    cached.system.f    = func_f;
+    cached.system.df   = func_df;
+    cached.system.fvv  = nullptr;
+    cached.system.n    = n;     //number of data points
+    cached.system.p    = p;     //Number of params
+
+    cached.workspace.reset(gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &params, n, p));
+    cached.params.reset(gsl_vector_alloc(p));
+}
+
+/**
+ * Finds this thread's workspace for n samples and p parameters, allocating one the first time a size is seen.
+ * @param n         Number of samples
+ * @param p         Number of parameters
+ * @param uncached  Used to hold the workspace when the cache is full, must outlive the returned workspace
+ * @return          A workspace for n samples and p parameters. Needs to be initialised before use.
+ */
+CachedWorkspace& getWorkspace(std::size_t n, std::size_t p, CachedWorkspace& uncached){
+    auto found = workspaceCache.find({n, p});
+    if(found != workspaceCache.end()){
+        ++workspaceCacheHits;
+        return found->second;
+    }
+
+    ++workspaceCacheMisses;
+    CachedWorkspace& cached = workspaceCache.size() < maxCachedWorkspaces ? workspaceCache[{n, p}] : uncached;
+    allocWorkspace(n, p, cached);
+    return cached;
+}
+
+WorkspaceCacheStats workspaceCacheStats(){
+    WorkspaceCacheStats stats;
+    stats.hits = workspaceCacheHits;
+    stats.misses = workspaceCacheMisses;
+    return stats;
+}
+
+void clearWorkspaceCache(){
+    workspaceCache.clear();
+}
+
+/**
+ * Fits the guesses with GSL's NLS fitter.
+ * @param indexData     The indices of the amplitude data
+ * @param amplitudeData The amplitude data of the curve to fit
+ * @param guesses       Starting Gaussians, overwritten with the results
+ * @return              True if system successfully converges, false otherwise.
+ */
+bool solveGsl(const std::vector<int>& indexData, const std::vector<int>& amplitudeData, std::vector<Gaussian>& guesses){
+    //Reuse a workspace of the right size rather than allocating one per pulse
+    CachedWorkspace uncached;
+    CachedWorkspace& cached = getWorkspace(amplitudeData.size(), 3*guesses.size(), uncached);
+    gsl_vector* params = cached.params.get();
+
+    //Copy to gsl vector
+    for(std::size_t i = 0; i < guesses.size(); ++i){
+        gsl_vector_set(params, i*3,   guesses[i].a);
+        gsl_vector_set(params, i*3+1, guesses[i].b);
+        gsl_vector_set(params, i*3+2, guesses[i].c);
+    }
+
+    GslScratch& scratch = gslScratch;
+    scratch.t.assign(indexData.begin(), indexData.end());
+    scratch.y.assign(amplitudeData.begin(), amplitudeData.end());
+    const Pulse data{indexData, amplitudeData, scratch.t, scratch.y};   //For passing through void*
+    cached.system.params = reinterpret_cast<void*>(const_cast<Pulse*>(&data)); //Cast to void* (remove const then change type)
+    gsl_multifit_nlinear_init(params, &cached.system, cached.workspace.get());   //Resets all solver state
+
+    bool result = solveSystem(cached.workspace.get(), params);
+
+    //Copy back to return the results
+    for(std::size_t i = 0; i < guesses.size(); ++i){
+        double a = gsl_vector_get(params, i*3);
+        double b = gsl_vector_get(params, i*3+1);
+        double c = gsl_vector_get(params, i*3+2);
+        guesses.at(i) = {a,b,c};
+    }
+
+    return result;
+}
+
+/**
+ * Scratch space for the native engine. Kept per thread so repeated fits only allocate when a longer wave than any
+ * seen before comes along.
+ */
+struct NativeScratch{
+    std::vector<double> t;          //Sample indices
+    std::vector<double> y;          //Sample amplitudes
+    std::vector<double> f;          //Residuals at the current parameters
+    std::vector<double> fTrial;     //Residuals at the trial parameters
+    std::vector<double> J;          //Jacobian, n rows of p contiguous values
+};
+
+thread_local NativeScratch nativeScratch;
+
+const std::size_t maxNativeParams = 3 * maxNativeGaussians;
+
+/**
+ * Native counterpart of func_f.
+ * @param x     The current parameters. Is some amount of {a,b,c} tuples.
+ * @param p     Number of parameters
+ * @param t     Sample indices
+ * @param y     Sample amplitudes
+ * @param n     Number of samples
+ * @param f     Output array of n residuals
+ * @return      Half the sum of the squared residuals
+ */
+double nativeResiduals(const double* x, std::size_t p, const double* t, const double* y, std::size_t n, double* f){
+    GaussianKernels::residuals(t, y, n, x, p, f);
+
+    double cost = 0;
+    for(std::size_t i = 0; i < n; ++i){
+        cost += f[i] * f[i];
+    }
+    return 0.5 * cost;
+}
+
+/**
+ * Native counterpart of func_df.
+ * @param x     Gaussian parameters
+ * @param p     Number of parameters
+ * @param t     Sample indices
+ * @param n     Number of samples
+ * @param J     Output n x p jacobian, row major
+ */
+void nativeJacobian(const double* x, std::size_t p, const double* t, std::size_t n, double* J){
+    GaussianKernels::jacobian(t, n, x, p, J, p);
+}
+
+/**
+ * Forms the normal equations J^T J and the gradient J^T f.
+ * @param J     n x p jacobian, row major
+ * @param f     n residuals
+ * @param n     Number of samples
+ * @param p     Number of parameters
+ * @param JtJ   Output p x p matrix, row major
+ * @param g     Output gradient of p values
+ */
+void nativeNormalEquations(const double* J, const double* f, std::size_t n, std::size_t p, double* JtJ, double* g){
+    std::fill(JtJ, JtJ + p*p, 0.0);
+    std::fill(g, g + p, 0.0);
+    for(std::size_t i = 0; i < n; ++i){
+        const double* row = J + i*p;
+        for(std::size_t r = 0; r < p; ++r){
+            g[r] += row[r] * f[i];
+            for(std::size_t c = r; c < p; ++c){
+                JtJ[r*p + c] += row[r] * row[c];
+            }
+        }
+    }
+    for(std::size_t r = 0; r < p; ++r){
+        for(std::size_t c = 0; c < r; ++c){
+            JtJ[r*p + c] = JtJ[c*p + r];
+        }
+    }
+}
+
+/**
+ * Cholesky factorisation of a small symmetric matrix, in place.
+ * @param A     p x p symmetric matrix, the lower triangle is overwritten by its factor
+ * @param p     Number of parameters
+ * @return      False if A is not positive definite
+ */
+bool nativeCholesky(double* A, std::size_t p){
+    for(std::size_t j = 0; j < p; ++j){
+        double d = A[j*p + j];
+        for(std::size_t k = 0; k < j; ++k){
+            d -= A[j*p + k] * A[j*p + k];
+        }
+        if(!(d > 0)){
+            return false;
+        }
+        d = std::sqrt(d);
+        A[j*p + j] = d;
+        for(std::size_t i = j+1; i < p; ++i){
+            double v = A[i*p + j];
+            for(std::size_t k = 0; k < j; ++k){
+                v -= A[i*p + k] * A[j*p + k];
+            }
+            A[i*p + j] = v / d;
+        }
+    }
+    return true;
+}
+
+/**
+ * Solves L L^T x = -b using a factor from nativeCholesky.
+ * @param L     Cholesky factor
+ * @param b     Right hand side, negated
+ * @param p     Number of parameters
+ * @param x     Output solution
  */
-gsl_multifit_nlinear_workspace* setupWorkspace(const Pulse& data, const gsl_vector* guess, gsl_multifit_nlinear_fdf& system, gsl_multifit_nlinear_parameters& params){
-    assert(guess);
+void nativeCholeskySolve(const double* L, const double* b, std::size_t p, double* x){
+    for(std::size_t i = 0; i < p; ++i){
+        double v = -b[i];
+        for(std::size_t k = 0; k < i; ++k){
+            v -= L[i*p + k] * x[k];
+        }
+        x[i] = v / L[i*p + i];
+    }
+    for(std::size_t i = p; i-- > 0;){
+        double v = x[i];
+        for(std::size_t k = i+1; k < p; ++k){
+            v -= L[k*p + i] * x[k];
+        }
+        x[i] = v / L[i*p + i];
+    }
+}
+
+/**
+ * Norm of a vector scaled by D.
+ */
+double nativeScaledNorm(const double* D, const double* v, std::size_t p){
+    double sum = 0;
+    for(std::size_t k = 0; k < p; ++k){
+        sum += D[k] * v[k] * D[k] * v[k];
+    }
+    return std::sqrt(sum);
+}
+
+/**
+ * Levenberg-Marquardt fit of a sum of at most maxNativeGaussians Gaussians. Follows the same trust region scheme as
+ * the GSL path (Moré scaling, geodesic acceleration from a finite difference second directional derivative) and
+ * uses the same iteration limit, tolerances and convergence tests as solveSystem, so the two engines stop at the
+ * same point. Stores the final parameters (regardless of success) in guesses.
+ * @param indexData     The indices of the amplitude data
+ * @param amplitudeData The amplitude data of the curve to fit
+ * @param guesses       Starting Gaussians, overwritten with the results
+ * @return              True if system successfully converges, false otherwise.
+ */
+bool solveNative(const std::vector<int>& indexData, const std::vector<int>& amplitudeData, std::vector<Gaussian>& guesses){
+    const size_t maxIter = 150;
+    const double xTol = 1.0e-2;
+    const double gTol = 1.0e-8;
+
+    //gsl_multifit_nlinear_default_parameters
+    const size_t maxTries = 15;     //Rejected steps in a row before giving up
+    const double factorUp = 3;
+    const double factorDown = 2;
+    const double avMax = 0.75;      //Largest acceleration to velocity ratio accepted
+    const double hFvv = 0.02;       //Step used for the second directional derivative
+
+    const std::size_t n = amplitudeData.size();
+    const std::size_t p = 3 * guesses.size();
+    assert(p <= maxNativeParams);
+
+    NativeScratch& scratch = nativeScratch;
+    scratch.t.resize(n);
+    scratch.y.resize(n);
+    scratch.f.resize(n);
+    scratch.fTrial.resize(n);
+    scratch.J.resize(n*p);
+    for(std::size_t i = 0; i < n; ++i){
+        scratch.t[i] = indexData[i];
+        scratch.y[i] = amplitudeData[i];
+    }
+    const double* t = scratch.t.data();
+    const double* y = scratch.y.data();
+
+    double x[maxNativeParams];
+    double xTrial[maxNativeParams];
+    double v[maxNativeParams];      //Velocity, the plain LM step
+    double acc[maxNativeParams];    //Geodesic acceleration
+    double dx[maxNativeParams];
+    double g[maxNativeParams];
+    double Jtfvv[maxNativeParams];
+    double D[maxNativeParams];
+    double JtJ[maxNativeParams * maxNativeParams];
+    double L[maxNativeParams * maxNativeParams];
+
+    for(std::size_t i = 0; i < guesses.size(); ++i){
+        x[i*3]   = guesses[i].a;
+        x[i*3+1] = guesses[i].b;
+        x[i*3+2] = guesses[i].c;
+    }
 
-    params = gsl_multifit_nlinear_default_parameters();
+    spdlog::debug("Starting fitting with guesses {}", gaussianToString(x, p));
 
-    system.f    = func_f;
-    system.df   = func_df;
-    system.fvv  = nullptr;
-    params.trs  = gsl_multifit_nlinear_trs_lmaccel;
+    double cost = nativeResiduals(x, p, t, y, n, scratch.f.data());
+    nativeJacobian(x, p, t, n, scratch.J.data());
+    nativeNormalEquations(scratch.J.data(), scratch.f.data(), n, p, JtJ, g);
 
-    system.n = data.amplitudeData.size();   //number of data points
-    system.p = guess->size;                 //Number of params
-    system.params = reinterpret_cast<void*>(const_cast<Pulse*>(&data)); //Cast to void* (remove const then change type)
+    //Moré scaling, the largest column norm seen so far
+    for(std::size_t k = 0; k < p; ++k){
+        D[k] = std::sqrt(JtJ[k*p + k]);
+        if(D[k] == 0){
+            D[k] = 1;
+        }
+    }
+    double delta = 0.3 * std::max(1.0, nativeScaledNorm(D, x, p));
+
+    bool converged = false;
+    const char* failure = "exceeded max number of iterations";
+    for(std::size_t iter = 1; iter <= maxIter && !converged; ++iter){
+        //Look for a step that lowers the cost
+        bool accepted = false;
+        for(std::size_t tries = 0; tries < maxTries && !accepted; ++tries){
+            const double mu = 1.0 / delta;
+            double rho = -1;
+
+            std::copy(JtJ, JtJ + p*p, L);
+            for(std::size_t k = 0; k < p; ++k){
+                L[k*p + k] += mu * D[k] * D[k];
+            }
+
+            if(nativeCholesky(L, p)){
+                nativeCholeskySolve(L, g, p, v);
+
+                //Second directional derivative of f along v, by finite differences
+                for(std::size_t k = 0; k < p; ++k){
+                    xTrial[k] = x[k] + hFvv * v[k];
+                }
+                nativeResiduals(xTrial, p, t, y, n, scratch.fTrial.data());
+                std::fill(Jtfvv, Jtfvv + p, 0.0);
+                for(std::size_t i = 0; i < n; ++i){
+                    const double* row = scratch.J.data() + i*p;
+                    double Jv = 0;
+                    for(std::size_t k = 0; k < p; ++k){
+                        Jv += row[k] * v[k];
+                    }
+                    double fvv = (2.0 / hFvv) * ((scratch.fTrial[i] - scratch.f[i]) / hFvv - Jv);
+                    for(std::size_t k = 0; k < p; ++k){
+                        Jtfvv[k] += row[k] * fvv;
+                    }
+                }
+                nativeCholeskySolve(L, Jtfvv, p, acc);
+
+                double vNorm = nativeScaledNorm(D, v, p);
+                double avRatio = vNorm > 0 ? nativeScaledNorm(D, acc, p) / vNorm : 0;
+
+                double predicted = 0;
+                for(std::size_t k = 0; k < p; ++k){
+                    dx[k] = v[k] + 0.5 * acc[k];
+                    xTrial[k] = x[k] + dx[k];
+                    predicted += v[k] * (mu * D[k] * D[k] * v[k] - g[k]);
+                }
+                predicted *= 0.5;
+
+                if(avRatio <= avMax && predicted > 0){
+                    double costTrial = nativeResiduals(xTrial, p, t, y, n, scratch.fTrial.data());
+                    if(std::isfinite(costTrial)){
+                        rho = (cost - costTrial) / predicted;
+                    }
+                    if(rho > 0){
+                        std::copy(xTrial, xTrial + p, x);
+                        std::swap(scratch.f, scratch.fTrial);
+                        cost = costTrial;
+                        accepted = true;
+                    }
+                }
+            }
+
+            if(rho > 0.75){
+                delta *= factorUp;
+            }else if(rho < 0.25){
+                delta /= factorDown;
+            }
+        }
+
+        if(!accepted){
+            failure = "iteration is not making any progress towards solution";
+            break;
+        }
 
-    gsl_multifit_nlinear_workspace* workspace =
-        gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &params, data.amplitudeData.size(), guess->size);
+        if(spdlog::default_logger()->level() == spdlog::level::trace){  //Don't do the next part unless trace
+            spdlog::trace("Iteration {}\tData: {}", iter, gaussianToString(x, p));
+        }
+
+        nativeJacobian(x, p, t, n, scratch.J.data());
+        nativeNormalEquations(scratch.J.data(), scratch.f.data(), n, p, JtJ, g);
+        for(std::size_t k = 0; k < p; ++k){
+            D[k] = std::max(D[k], std::sqrt(JtJ[k*p + k]));
+        }
+
+        //Same small step and small gradient tests as gsl_multifit_nlinear_test
+        bool smallStep = true;
+        double gNorm = 0;
+        for(std::size_t k = 0; k < p; ++k){
+            if(std::fabs(dx[k]) > xTol * (xTol + std::fabs(x[k]))){
+                smallStep = false;
+            }
+            gNorm = std::max(gNorm, std::fabs(g[k]) * std::max(std::fabs(x[k]), 1.0));
+        }
+
+        if(smallStep){
+            spdlog::trace("Fitting converged due to small step size");
+            converged = true;
+        }else if(gNorm <= gTol * std::max(cost, 1.0)){
+            spdlog::trace("Fitting converged due to a small gradient");
+            converged = true;
+        }
+    }
 
-    gsl_multifit_nlinear_init(guess, &system, workspace);
-    return workspace;
+    for(std::size_t i = 0; i < guesses.size(); ++i){
+        guesses[i] = {x[i*3], x[i*3+1], x[i*3+2]};
+    }
+
+    if(!converged){
+        spdlog::error("Fitting failed with error \"{}\"", failure);
+        spdlog::error("Last guesses: {}", gaussianToString(x, p));
+        return false;
+    }
+
+    spdlog::debug("Final Guesses: {}", gaussianToString(x, p));
+    return true;
 }
 
 //See Fitter.hpp for docs @@TODO misc note: noise_level never did anything regarding the fitter itself
-bool fitGaussians(const std::vector<int>& indexData, const std::vector<int>& amplitudeData, std::vector<Gaussian>& guesses){
+bool fitGaussians(const std::vector<int>& indexData, const std::vector<int>& amplitudeData, std::vector<Gaussian>& guesses, Engine engine){
     //@@TODO: prefix logs with function name?
     //@@TODO this should probably be an assert
     if(indexData.size() != amplitudeData.size()){
@@ -244,32 +693,11 @@ bool fitGaussians(const std::vector<int>& indexData, const std::vector<int>& amp
         spdlog::trace("Amplitude Data:\n{}", tmp);		
     }
 
-    //Create workspace and params
-    std::unique_ptr<gsl_vector, decltype(&gsl_vector_free)> params
-        (gsl_vector_alloc(3*guesses.size()), &gsl_vector_free);  //Owning pointer auto frees
-    //Note: Compilers seem to be able to completely optimize this away: https://godbolt.org/z/SooW3d
-
-    //Copy to gsl vector
-    for(std::size_t i = 0; i < guesses.size(); ++i){
-        gsl_vector_set(params.get(), i*3,   guesses[i].a);
-        gsl_vector_set(params.get(), i*3+1, guesses[i].b);
-        gsl_vector_set(params.get(), i*3+2, guesses[i].c);
-    }
-
-    const Pulse data{indexData, amplitudeData};  //For passing through void*
-    gsl_multifit_nlinear_fdf system;
-    gsl_multifit_nlinear_parameters fdf_params;;
-    std::unique_ptr<gsl_multifit_nlinear_workspace, decltype(&gsl_multifit_nlinear_free)> workspace
-        (setupWorkspace(data, params.get(), system, fdf_params), &gsl_multifit_nlinear_free);
-
-    bool result = solveSystem(workspace.get(), params.get());
-
-    //Copy back to return the results
-    for(std::size_t i = 0; i < guesses.size(); ++i){
-        double a = gsl_vector_get(params.get(), i*3);
-        double b = gsl_vector_get(params.get(), i*3+1);
-        double c = gsl_vector_get(params.get(), i*3+2);
-        guesses.at(i) = {a,b,c};
+    bool result;
+    if(engine == Engine::Native && guesses.size() <= maxNativeGaussians){
+        result = solveNative(indexData, amplitudeData, guesses);
+    }else{
+        result = solveGsl(indexData, amplitudeData, guesses);
     }
 
     //If failed, log waveform
@@ -1,5 +1,6 @@
 #ifndef ADAPTLIDAR_FITTER_HPP
 #define ADAPTLIDAR_FITTER_HPP
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
@@ -17,18 +18,34 @@ namespace Fitter{
         double c=0;
     };
 
+    /**
+     * Solvers available to fitGaussians.
+     * GSL    uses GSL's trust region NLS fitter.
+     * Native uses a Levenberg-Marquardt fitter specialised for small sums of Gaussians that keeps its buffers between
+     *        calls on the same thread. Sums of more than maxNativeGaussians are handed to GSL.
+     */
+    enum class Engine{
+        GSL,
+        Native
+    };
+
+    //The most Gaussians the native engine fits at once
+    const std::size_t maxNativeGaussians = 8;
+
     /**
      * Given reasonably accurate guesses, fits them to a curve denoted by {indexData_i, amplitudeData_i}.
-     * The equation is a sum of Gaussians, fitted using GSL's NLS fitter.
+     * The equation is a sum of Gaussians, fitted using the requested engine.
      *
      * It is better for the parameters of a guess to be too small than too large.
      *
      * @param indexData     The indices of the amplitude data. Must be the same length as amplitudeData.
      * @param amplitudeData The amplitude data of the curve to fit. Must be the same length as indexData.
      * @param guesses       A set of starting Gaussians to begin fitting from. The final fitting results will be placed in this vector, overwriting the original guesses
+     * @param engine        The solver to fit with
      * @return bool         True if fitter completed without issues. False if there is no waveform data, no peaks, or other error.
      */
-    bool fitGaussians(const std::vector<int>& indexData, const std::vector<int>& amplitudeData, std::vector<Gaussian>& guesses);
+    bool fitGaussians(const std::vector<int>& indexData, const std::vector<int>& amplitudeData, std::vector<Gaussian>& guesses, Engine engine = Engine::GSL);
+
 
     /**
      * Guesses gaussians using second central finite differencing.
@@ -40,5 +57,24 @@ namespace Fitter{
      */
     void guessGaussians(const std::vector<int>& indexData, const std::vector<int>& amplitudeData, int noiseLevel, std::vector<Gaussian>& guesses);
 
+    /**
+     * How often the GSL engine found a workspace of the right size in its cache. Each thread keeps its own workspaces,
+     * keyed by the number of samples and parameters, so a miss is a size that thread had not fitted before.
+     */
+    struct WorkspaceCacheStats{
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+    };
+
+    /**
+     * @return  Workspace cache hits and misses, summed over all threads since the program started.
+     */
+    WorkspaceCacheStats workspaceCacheStats();
+
+    /**
+     * Frees every workspace cached by the calling thread.
+     */
+    void clearWorkspaceCache();
+
 } // namespace Fitter
 #endif  //ADAPTLIDAR_FITTER_HPP
@@ -36,6 +36,16 @@ FlightLineData::FlightLineData(){
     utm = 0;
 
     next_pulse_exists = false;
+    use_mapped_reader = false;
+    reader_seeks = true;
+    pulse_index_loaded = false;
+    next_pulse_index = 0;
+    pulse_range_end = 0;
+    use_window = false;
+    window_x_min = 0;
+    window_y_min = 0;
+    window_x_max = 0;
+    window_y_max = 0;
 }
 
 
@@ -43,9 +53,12 @@ FlightLineData::FlightLineData(){
 /**
  * Stores the instrument information and initializes pReader
  * @param fileName path to pls file to open
+ * @param memory_mapped true to read pulses by mapping the pls and wvs files
+ * instead of through pReader. Falls back to pReader if the files can't be
+ * mapped.
  * @return 0 if successful, 1 if file can't be used.
  */
-int FlightLineData::setFlightLineData(std::string fileName){
+int FlightLineData::setFlightLineData(std::string fileName, bool memory_mapped){
 
     pOpener.set_file_name(fileName.c_str());
     pReader = pOpener.open();
@@ -130,6 +143,29 @@ int FlightLineData::setFlightLineData(std::string fileName){
 
     spdlog::debug("scanner reads complete");
 
+    open_pulse_index(fileName);
+    next_pulse_index = 0;
+    reader_seeks = true;
+    pulse_range_end = getNumberOfPulses();
+
+    use_mapped_reader = false;
+    if(memory_mapped){
+        MappedPulseLayout layout;
+        if(read_mapped_layout(&layout) && mapped_reader.open(fileName,
+                    MappedPulseReader::wvs_file_name(fileName), layout)){
+            use_mapped_reader = true;
+            next_pulse_exists = mapped_reader.number_of_pulses() > 0;
+            if(!next_pulse_exists){
+                spdlog::critical("Input file had no data!");
+                return 1;
+            }
+            spdlog::info("Reading pulses from memory mapped files");
+            return 0;
+        }
+        spdlog::warn("Unable to map {}, reading it with PulseWaves instead",
+                fileName);
+    }
+
     //Initialize the pReader to read the pulse and the wave
     //If no data, throw an exception and exit
     try{
@@ -231,6 +267,16 @@ void FlightLineData::getNextPulse(PulseData *pd){
 
         return; // Returning empty pd
     }
+
+    if(use_mapped_reader){
+        //A pulse that can't be decoded is returned empty, like the ones
+        //PULSEreader can't make sense of
+        mapped_reader.read_pulse(next_pulse_index, pd,
+                &current_wave_gps_info);
+        next_pulse_index = next_pulse_in_window(next_pulse_index + 1);
+        next_pulse_exists = next_pulse_index < pulse_range_end;
+        return;
+    }
     current_wave_gps_info.populateGPS(pReader);
 
     double pulse_outgoing_start_time;
@@ -323,7 +369,18 @@ void FlightLineData::getNextPulse(PulseData *pd){
     }
 
     //Check if there exists a next pulse
-    if(pReader->read_pulse()){
+    int64_t next = next_pulse_in_window(next_pulse_index + 1);
+    if(next < pulse_range_end && next != next_pulse_index + 1){
+        //Jump over blocks outside the window without decoding them
+        if(!seekPulse(next)){
+            spdlog::critical("Unable to move to pulse {}, the rest of the "
+                    "flight line can't be read", next);
+            throw 1;
+        }
+        return;
+    }
+    next_pulse_index = next;
+    if(next_pulse_index < pulse_range_end && pReader->read_pulse()){
         if(pReader->read_waves()){
             next_pulse_exists = true;
             return;
@@ -335,11 +392,195 @@ void FlightLineData::getNextPulse(PulseData *pd){
 
 
 /**
- * Calculate x, y and z activation
+ * @return the number of pulses in the flight line
+ */
+int64_t FlightLineData::getNumberOfPulses(){
+    return pReader->header.number_of_pulses;
+}
+
+/**
+ * Move to a pulse, so it is the one getNextPulse reads next. If pReader can't
+ * seek in the file, the pulses up to it are read instead.
+ * @param index the pulse to move to, 0 is the first pulse in the file
+ * @return false if there is no such pulse or it could not be read
+ */
+bool FlightLineData::seekPulse(int64_t index){
+    next_pulse_exists = false;
+    if(index < 0 || index >= getNumberOfPulses()){
+        return false;
+    }
+    //pReader holds the pulse getNextPulse would have read next
+    int64_t current = next_pulse_index;
+    next_pulse_index = index;
+    if(use_mapped_reader){
+        next_pulse_exists = index < pulse_range_end;
+        return true;
+    }
+    if(reader_seeks){
+        if(pReader->seek(index) && pReader->read_pulse()
+                && pReader->read_waves()){
+            next_pulse_exists = index < pulse_range_end;
+            return true;
+        }
+        //Where a failed seek leaves the reader is unknown, start over
+        spdlog::warn("Unable to seek to pulse {}, reading up to it instead",
+                index);
+        reader_seeks = false;
+        current = -1;
+    }
+    if(!read_up_to_pulse(current, index)){
+        spdlog::error("Unable to read up to pulse {}", index);
+        return false;
+    }
+    next_pulse_exists = index < pulse_range_end;
+    return true;
+}
+
+/**
+ * Move pReader to a pulse by reading every pulse before it, for files it
+ * can't seek in
+ * @param current the pulse pReader holds, -1 if that isn't known
+ * @param index the pulse to move to
+ * @return false if the pulse could not be read
+ */
+bool FlightLineData::read_up_to_pulse(int64_t current, int64_t index){
+    if(current < 0 || index < current){
+        reopen_reader();
+        if(!pReader->read_pulse()){
+            return false;
+        }
+        current = 0;
+    }
+    while(current < index){
+        if(!pReader->read_pulse()){
+            return false;
+        }
+        current++;
+    }
+    return pReader->read_waves();
+}
+
+/**
+ * Only read the pulses in [first, end). Lets several readers each work
+ * through their own part of a flight line.
+ * @param first the first pulse to read
+ * @param end the pulse to stop before, clamped to the number of pulses
+ * @return false if first is not a pulse in the flight line
+ */
+bool FlightLineData::setPulseRange(int64_t first, int64_t end){
+    pulse_range_end = std::min(end, getNumberOfPulses());
+    return seekPulse(first);
+}
+
+/**
+ * Only read pulses whose block of the pulse index overlaps a window, and only
+ * keep the peaks inside it. The bounding box is shrunk to the window, so the
+ * products only cover it. Must be called after setFlightLineData.
+ * @param x_min west edge of the window
+ * @param y_min south edge of the window
+ * @param x_max east edge of the window
+ * @param y_max north edge of the window
+ * @return false if the window doesn't overlap the flight line
+ */
+bool FlightLineData::setWindow(double x_min, double y_min, double x_max,
+        double y_max){
+    if(x_min > bb_x_max || x_max < bb_x_min || y_min > bb_y_max
+            || y_max < bb_y_min){
+        spdlog::error("Window {},{} - {},{} is outside of the flight line",
+                x_min, y_min, x_max, y_max);
+        return false;
+    }
+    use_window = true;
+    window_x_min = x_min;
+    window_y_min = y_min;
+    window_x_max = x_max;
+    window_y_max = y_max;
+    bb_x_min = std::max(bb_x_min, x_min);
+    bb_y_min = std::max(bb_y_min, y_min);
+    bb_x_max = std::min(bb_x_max, x_max);
+    bb_y_max = std::min(bb_y_max, y_max);
+
+    if(!pulse_index_loaded && !build_pulse_index()){
+        spdlog::error("Unable to read {} after indexing it", pls_file_name);
+        return false;
+    }
+    int64_t skipped = 0;
+    for(const PulseIndexBlock &block : pulse_index.blocks()){
+        if(!block_in_window(block)){
+            skipped += block.pulse_count;
+        }
+    }
+    spdlog::info("Window skips {} of {} pulses", skipped, getNumberOfPulses());
+
+    if(next_pulse_exists){
+        int64_t next = next_pulse_in_window(next_pulse_index);
+        if(next >= pulse_range_end){
+            next_pulse_exists = false;
+        }else if(next != next_pulse_index && !seekPulse(next)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @param x x coordinate of a point
+ * @param y y coordinate of a point
+ * @return true if there is no window or the point is inside it
+ */
+bool FlightLineData::in_window(double x, double y){
+    return !use_window || (x >= window_x_min && x <= window_x_max
+            && y >= window_y_min && y <= window_y_max);
+}
+
+/**
+ * @param block a block of the pulse index
+ * @return true if the block's pulses may be inside the window
+ */
+bool FlightLineData::block_in_window(const PulseIndexBlock &block){
+    return !use_window || (block.x_max >= window_x_min
+            && block.x_min <= window_x_max && block.y_max >= window_y_min
+            && block.y_min <= window_y_max);
+}
+
+/**
+ * @param index a pulse
+ * @return index, or if its block is outside the window the first pulse of
+ * the next block inside the window. pulse_range_end if there are none.
+ */
+int64_t FlightLineData::next_pulse_in_window(int64_t index){
+    const PulseIndexBlock *block = pulse_index.find_block(index);
+    while(block != NULL && !block_in_window(*block)){
+        index = block->first_pulse + block->pulse_count;
+        block = pulse_index.find_block(index);
+    }
+    return std::min(index, pulse_range_end);
+}
+
+/**
+ * Calculate x, y and z activation using the gps information of the most
+ * recently read pulse
+ * @param peaks pointer to the peaks to calculate activations for
+ * @param arena the arena owning the peaks, dropped peaks are released to it
+ * @return the number of peaks left after calculation
+ */
+int FlightLineData::calc_xyz_activation(std::vector<Peak*> *peaks,
+        PeakArena *arena){
+    return calc_xyz_activation(peaks, current_wave_gps_info, arena);
+}
+
+/**
+ * Calculate x, y and z activation. Peaks that are dropped are removed from
+ * the vector and handed back to their arena, so they are reused by the next
+ * pulse instead of living as long as the peaks that are kept.
  * @param peaks pointer to the peaks to calculate activations for
+ * @param gps_info gps information of the pulse the peaks were found in
+ * @param arena the arena owning the peaks, NULL if dropped peaks are freed
+ * with it some other way
  * @return the number of peaks left after calculation
  */
-int FlightLineData::calc_xyz_activation(std::vector<Peak*> *peaks){
+int FlightLineData::calc_xyz_activation(std::vector<Peak*> *peaks,
+        const WaveGPSInformation &gps_info, PeakArena *arena){
     int i = 1;
     std::vector<Peak*>::iterator it;
     // for each of the incoming peaks
@@ -347,7 +588,9 @@ int FlightLineData::calc_xyz_activation(std::vector<Peak*> *peaks){
         // if the amplitude of the peak is too small just ignore the whole
         // thing
         if((*it)->amp <= (*it)->triggering_amp){
-            free(*it);
+            if(arena != NULL){
+                arena->release(*it);
+            }
             it = peaks->erase(it);
             continue;
         }
@@ -355,17 +598,25 @@ int FlightLineData::calc_xyz_activation(std::vector<Peak*> *peaks){
         // bounding box -- this is for x and y only. 
         // We do not care about the z_activation
         (*it)->x_activation =
-            (*it)->triggering_location * current_wave_gps_info.dx +
-            current_wave_gps_info.x_first;
+            (*it)->triggering_location * gps_info.dx +
+            gps_info.x_first;
+        (*it)->y_activation =
+            (*it)->triggering_location * gps_info.dy +
+            gps_info.y_first;
+        //peaks outside of the window aren't wanted
+        if(!in_window((*it)->x_activation, (*it)->y_activation)){
+            if(arena != NULL){
+                arena->release(*it);
+            }
+            it = peaks->erase(it);
+            continue;
+        }
         if((*it)->x_activation < bb_x_min || (*it)->x_activation > bb_x_max+1){
             spdlog::error("\nx activation: {} not in range: {} - {}", 
                          (*it)->x_activation, bb_x_min, bb_x_max);
               
         }
 
-        (*it)->y_activation =
-            (*it)->triggering_location * current_wave_gps_info.dy +
-            current_wave_gps_info.y_first;
         if((*it)->y_activation < bb_y_min || (*it)->y_activation > bb_y_max+1){
             spdlog::error("\ny activation: {} not in range: {} - {}",
                          (*it)->y_activation, bb_y_min, bb_y_max);
@@ -373,8 +624,8 @@ int FlightLineData::calc_xyz_activation(std::vector<Peak*> *peaks){
         }
 
         (*it)->z_activation =
-            (*it)->triggering_location * current_wave_gps_info.dz +
-            current_wave_gps_info.z_first;
+            (*it)->triggering_location * gps_info.dz +
+            gps_info.z_first;
         
         //mark the position in case any peaks were filtered
         (*it)->position_in_wave = i;
@@ -392,11 +643,127 @@ int FlightLineData::calc_xyz_activation(std::vector<Peak*> *peaks){
  * close and deallocate resources
  */
 void FlightLineData::closeFlightLineData(){
+    mapped_reader.close();
     pReader->close(true);
     delete pReader;
 }
 
 
+/**
+ * Collect what the mapped reader needs to know from the pls header
+ * @param layout where to put the pulse layout and descriptors
+ * @return false if the pulses are stored in a way the mapped reader can't read
+ */
+bool FlightLineData::read_mapped_layout(MappedPulseLayout *layout){
+    PULSEheader &header = pReader->header;
+    if(header.pulse_compression != 0 || header.pulse_format != 0){
+        spdlog::warn("Pulse format {} with compression {} can't be mapped",
+                header.pulse_format, header.pulse_compression);
+        return false;
+    }
+    layout->offset_to_pulse_data = header.offset_to_pulse_data;
+    layout->number_of_pulses = header.number_of_pulses;
+    layout->pulse_size = header.pulse_size;
+    layout->t_scale_factor = header.t_scale_factor;
+    layout->t_offset = header.t_offset;
+    layout->x_scale_factor = header.x_scale_factor;
+    layout->y_scale_factor = header.y_scale_factor;
+    layout->z_scale_factor = header.z_scale_factor;
+    layout->x_offset = header.x_offset;
+    layout->y_offset = header.y_offset;
+    layout->z_offset = header.z_offset;
+
+    //Descriptor indices are stored in 8 bits
+    layout->descriptors.assign(256, MappedDescriptor());
+    PULSEdescriptor descriptor;
+    for(U32 i = 0; i < 256; i++){
+        if(!header.get_pulse_descriptor(&descriptor, i)){
+            continue;
+        }
+        if(descriptor.composition->compression != 0){
+            spdlog::warn("Compressed descriptor {} can't be mapped", i);
+            return false;
+        }
+        MappedDescriptor &mapped = layout->descriptors[i];
+        mapped.number_of_extra_waves_bytes =
+            descriptor.composition->number_of_extra_waves_bytes;
+        for(U16 m = 0; m < descriptor.composition->number_of_samplings; m++){
+            const PULSEsampling &sampling = descriptor.samplings[m];
+            if(sampling.compression != 0){
+                spdlog::warn("Compressed sampling in descriptor {} can't be "
+                        "mapped", i);
+                return false;
+            }
+            MappedSampling out;
+            out.type = sampling.type;
+            out.bits_for_duration_from_anchor =
+                sampling.bits_for_duration_from_anchor;
+            out.bits_for_number_of_segments =
+                sampling.bits_for_number_of_segments;
+            out.bits_for_number_of_samples = sampling.bits_for_number_of_samples;
+            out.scale_for_duration_from_anchor =
+                sampling.scale_for_duration_from_anchor;
+            out.offset_for_duration_from_anchor =
+                sampling.offset_for_duration_from_anchor;
+            out.number_of_segments = sampling.number_of_segments;
+            out.number_of_samples = sampling.number_of_samples;
+            out.bits_per_sample = sampling.bits_per_sample;
+            mapped.samplings.push_back(out);
+        }
+    }
+    return true;
+}
+
+/**
+ * Load the pulse index of a pls file from its sidecar file, if there is an
+ * up to date one. It is only built when a window needs it, so reading a
+ * whole flight line never costs an extra pass over its pulses.
+ * @param fileName path to the pls file
+ */
+void FlightLineData::open_pulse_index(std::string fileName){
+    pls_file_name = fileName;
+    std::string indexFileName = PulseIndex::index_file_name(fileName);
+    pulse_index_loaded = pulse_index.load(indexFileName, getNumberOfPulses(),
+            PulseIndex::file_size(fileName));
+    if(pulse_index_loaded){
+        spdlog::debug("Loaded pulse index {}", indexFileName);
+    }
+}
+
+/**
+ * Build the pulse index of the flight line and save it to its sidecar file,
+ * then put pReader back on the pulse getNextPulse reads next. If the sidecar
+ * can't be written, e.g. next to a read only file, every run that sets a
+ * window builds the index again.
+ * @return false if pReader could not be put back
+ */
+bool FlightLineData::build_pulse_index(){
+    spdlog::info("Indexing pulses of {}", pls_file_name);
+    //Reopen rather than seek back, seeking isn't supported by every format
+    reopen_reader();
+    pulse_index.build(pReader, PulseIndex::file_size(pls_file_name));
+    pulse_index.save(PulseIndex::index_file_name(pls_file_name));
+    pulse_index_loaded = true;
+    if(use_mapped_reader || !next_pulse_exists){
+        return true;
+    }
+    return read_up_to_pulse(-1, next_pulse_index);
+}
+
+/**
+ * Close pReader and open the file again, so the next pulse it reads is the
+ * first one
+ */
+void FlightLineData::reopen_reader(){
+    pReader->close();
+    delete pReader;
+    pReader = pOpener.open();
+    if(pReader == NULL){
+        spdlog::critical("Unable to open the pls file again");
+        throw 1;
+    }
+}
+
 /**
  * search for UTM in a string, extract the integer value following it
  * @param input a string containing the UTM
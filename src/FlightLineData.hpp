@@ -12,7 +12,10 @@
 #include "pulsewriter.hpp"
 #include "PulseData.hpp"
 #include "Peak.hpp"
+#include "PeakArena.hpp"
 #include "WaveGPSInformation.hpp"
+#include "MappedPulseReader.hpp"
+#include "PulseIndex.hpp"
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -64,18 +67,38 @@ class FlightLineData{
 
         WaveGPSInformation current_wave_gps_info;
 
+        //Where every block of pulses starts, loaded from or saved to a sidecar
+        //file next to the pls file. Only built once a window needs it.
+        PulseIndex pulse_index;
+
         FlightLineData();
-        int setFlightLineData(std::string fileName);
+        int setFlightLineData(std::string fileName, bool memory_mapped = false);
+        bool is_memory_mapped() const { return use_mapped_reader; }
         void FlightLineDataToCSV();
         bool hasNextPulse();
         void getNextPulse(PulseData* pd);;
-        int calc_xyz_activation(std::vector<Peak*> *peaks);
+        int64_t getNumberOfPulses();
+        bool seekPulse(int64_t index);
+        bool setPulseRange(int64_t first, int64_t end);
+        bool setWindow(double x_min, double y_min, double x_max, double y_max);
+        bool in_window(double x, double y);
+        int calc_xyz_activation(std::vector<Peak*> *peaks,
+                PeakArena *arena = NULL);
+        int calc_xyz_activation(std::vector<Peak*> *peaks,
+                const WaveGPSInformation &gps_info, PeakArena *arena = NULL);
         void closeFlightLineData(void);
         int parse_for_UTM_value(std::string input);
         void tokenize_geoascii_params_to_vector(std::stringstream *geo_stream,
                 std::vector<std::string> *tokens);
         int locate_utm_field(std::vector<std::string> *tokens);
         int locate_geog_cs_field(std::vector<std::string> *tokens);
+        bool read_mapped_layout(MappedPulseLayout *layout);
+        void open_pulse_index(std::string fileName);
+        bool build_pulse_index();
+        void reopen_reader();
+        bool read_up_to_pulse(int64_t current, int64_t index);
+        bool block_in_window(const PulseIndexBlock &block);
+        int64_t next_pulse_in_window(int64_t index);
 
 
     private:
@@ -84,6 +107,22 @@ class FlightLineData{
         WAVESsampling *sampling;
         PULSEscanner scanner;
 
+        //Used instead of pReader to read pulses when the files are mapped
+        MappedPulseReader mapped_reader;
+        bool use_mapped_reader;
+        //False once pReader failed to seek, pulses are read up to instead
+        bool reader_seeks;
+        //The pls file read, and whether pulse_index is loaded or built
+        std::string pls_file_name;
+        bool pulse_index_loaded;
+        //The pulse getNextPulse returns next, and the one to stop before
+        int64_t next_pulse_index;
+        int64_t pulse_range_end;
+
+        //Area of interest set by setWindow
+        bool use_window;
+        double window_x_min, window_y_min, window_x_max, window_y_max;
+
 };
 
 #endif /* FLIGHTLINEDATA_HPP_ */
@@ -221,3 +221,61 @@ TEST_F(FlightLineDataTest, testGeogCSParsing_not_found){
     EXPECT_EQ(idx,-1);
 
 }
+
+/****************************************************************************
+ *
+ * Reading the pulses by mapping the files gives the same pulses as reading
+ * them through PULSEreader
+ *
+ ****************************************************************************/
+TEST_F(FlightLineDataTest, testMappedMatchesPulseReader){
+
+    std::string file_name =  "etc/140823_183115_1_clipped_test.pls";
+    FlightLineData read;
+    FlightLineData mapped;
+    ASSERT_EQ(0, read.setFlightLineData(file_name, false));
+    ASSERT_EQ(0, mapped.setFlightLineData(file_name, true));
+    EXPECT_FALSE(read.is_memory_mapped());
+    ASSERT_TRUE(mapped.is_memory_mapped());
+    ASSERT_EQ(read.getNumberOfPulses(), mapped.getNumberOfPulses());
+
+    PulseData read_pulse, mapped_pulse;
+    int64_t pulses = 0;
+    while (read.hasNextPulse()) {
+        ASSERT_TRUE(mapped.hasNextPulse());
+        read.getNextPulse(&read_pulse);
+        mapped.getNextPulse(&mapped_pulse);
+
+        EXPECT_EQ(read_pulse.outgoingIdx, mapped_pulse.outgoingIdx);
+        EXPECT_EQ(read_pulse.outgoingWave, mapped_pulse.outgoingWave);
+        EXPECT_EQ(read_pulse.returningIdx, mapped_pulse.returningIdx);
+        EXPECT_EQ(read_pulse.returningWave, mapped_pulse.returningWave);
+
+        WaveGPSInformation &r = read.current_wave_gps_info;
+        WaveGPSInformation &m = mapped.current_wave_gps_info;
+        EXPECT_DOUBLE_EQ(r.gpsTime, m.gpsTime);
+        EXPECT_DOUBLE_EQ(r.x_anchor, m.x_anchor);
+        EXPECT_DOUBLE_EQ(r.y_anchor, m.y_anchor);
+        EXPECT_DOUBLE_EQ(r.z_anchor, m.z_anchor);
+        EXPECT_DOUBLE_EQ(r.x_target, m.x_target);
+        EXPECT_DOUBLE_EQ(r.y_target, m.y_target);
+        EXPECT_DOUBLE_EQ(r.z_target, m.z_target);
+        EXPECT_DOUBLE_EQ(r.x_first, m.x_first);
+        EXPECT_DOUBLE_EQ(r.y_first, m.y_first);
+        EXPECT_DOUBLE_EQ(r.z_first, m.z_first);
+        EXPECT_DOUBLE_EQ(r.x_last, m.x_last);
+        EXPECT_DOUBLE_EQ(r.y_last, m.y_last);
+        EXPECT_DOUBLE_EQ(r.z_last, m.z_last);
+        EXPECT_DOUBLE_EQ(r.dx, m.dx);
+        EXPECT_DOUBLE_EQ(r.dy, m.dy);
+        EXPECT_DOUBLE_EQ(r.dz, m.dz);
+        if (HasFailure()) {
+            FAIL() << "pulse " << pulses << " differs";
+        }
+        pulses++;
+    }
+    EXPECT_FALSE(mapped.hasNextPulse());
+    EXPECT_EQ(read.getNumberOfPulses(), pulses);
+    read.closeFlightLineData();
+    mapped.closeFlightLineData();
+}
@@ -32,6 +32,33 @@ void GaussianFitter::setDiagnostics(bool newval) {
     log_diagnostics = newval;
 }
 
+/**
+ * @return a new peak, owned by peak_arena or, when that is NULL, the fitter
+ */
+Peak* GaussianFitter::new_peak(){
+    return owning_arena()->allocate();
+}
+
+/**
+ * @return the arena the peaks found are allocated from, to hand back any of
+ * them that are dropped
+ */
+PeakArena* GaussianFitter::owning_arena(){
+    return peak_arena != NULL ? peak_arena : &own_peaks;
+}
+
+/**
+ * Hand peaks found by this fitter back to their arena to be reused
+ * @param peaks the peaks to release, emptied
+ */
+void GaussianFitter::release_peaks(std::vector<Peak*> &peaks){
+    PeakArena *arena = owning_arena();
+    for(Peak* peak : peaks){
+        arena->release(peak);
+    }
+    peaks.clear();
+}
+
 
 void GaussianFitter::incr_total(){
     total++;
@@ -384,7 +411,7 @@ int GaussianFitter::find_peaks(std::vector<Peak*>* results,
         return 0;
     }
 
-    bool result = Fitter::fitGaussians(idxData, ampData, guesses);
+    bool result = Fitter::fitGaussians(idxData, ampData, guesses, fitter_engine);
     total++;
 
     if(!result){
@@ -408,7 +435,7 @@ int GaussianFitter::find_peaks(std::vector<Peak*>* results,
             valid = false;
         }
 
-        Peak* peakPtr = new Peak();
+        Peak* peakPtr = new_peak();
         peakPtr->amp = peak.a;
         peakPtr->location = peak.b;
         peakPtr->fwhm = peak.c * C_TO_FWHM;
@@ -419,10 +446,7 @@ int GaussianFitter::find_peaks(std::vector<Peak*>* results,
 
     if(!valid){
         fail++;
-        for(Peak* ptr : *results){
-            delete(ptr);
-        }
-        results->clear();
+        release_peaks(*results);
         return 0;
     }else{
         pass++;
@@ -584,19 +608,19 @@ int GaussianFitter::find_peaks(std::vector<Peak*>* results,
             // are invalid -- this should be logged
             if(peak->amp >= 300 ){
                 spdlog::error("Results invalid: amp too large");
-                results->clear();
+                release_peaks(*results);
                 break;
             }else if(peak->amp < (noise_level/2.)){
                 spdlog::error("Results invalid: amp too small");
-                results->clear();
+                release_peaks(*results);
                 break;
             }else if(peak->triggering_location > n){
                 spdlog::error("Results invalid: triggering location > n");
-                results->clear();
+                release_peaks(*results);
                 break;
             }else if(peak->triggering_location <0) {
                 spdlog::error("Results invalid: triggering location <n");
-                results->clear();
+                release_peaks(*results);
                 break;
             } else{
                 //set the peak position in the wave
@@ -640,7 +664,7 @@ int GaussianFitter::find_peaks(std::vector<Peak*>* results,
         spdlog::trace("Time Data: {}",time.str());
         spdlog::trace("Amp Data: {}",data.str());
         spdlog::trace("Model Data: {}",model.str());
-        results->clear();
+        release_peaks(*results);
     }
 
     free(fit_data.t);
@@ -742,7 +766,7 @@ int GaussianFitter::guess_peaks(std::vector<Peak*>* results,
             // We were going up before and are now going down
             if (a2 - a1 > 0 && a3 - a2 < 0) {
                 // Record amplitude and time value in a new Peak object
-                Peak* peak = new Peak();
+                Peak* peak = new_peak();
                 peak->amp = a2;
                 int t2 = idxData[i];
                 peak->location = t2;
@@ -771,7 +795,7 @@ int GaussianFitter::guess_peaks(std::vector<Peak*>* results,
                     float t2 = (idxData[before+1] + idxData[i]) / 2.;
 		    spdlog::trace("Peak location: {}",t2);
                     // Record amplitude and time value in a new Peak object
-                    Peak* peak = new Peak();
+                    Peak* peak = new_peak();
                     peak->amp = a2;
               //malik: need to clarify
 	            peak->location = t2;
@@ -6,6 +6,8 @@
 #define GAUSIANFITTING_HPP_
 
 #include "Peak.hpp"
+#include "PeakArena.hpp"
+#include "Fitter.hpp"
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_blas.h>
@@ -41,6 +43,8 @@ class GaussianFitter{
                 const std::vector<int>& ampData, 
                 const std::vector<int>& idxData);
         void smoothing_expt(std::vector<int> *waveArray);
+        void release_peaks(std::vector<Peak*> &peaks);
+        PeakArena* owning_arena();
         GaussianFitter();
         std::string get_equation(int idx);
         int greatest_change(const std::vector<int> &data, int idx, int amp, bool left);
@@ -77,10 +81,21 @@ class GaussianFitter{
         float max_amp_multiplier; // Val is multiplied by max data point in wave
         float amp_lower_bound; // Val is unmodified (no multiplication)
 
+        // Solver used by find_peaks
+        Fitter::Engine fitter_engine = Fitter::Engine::GSL;
+
+        // Arena the peaks found are allocated from, and owned by. When NULL
+        // they are owned by the fitter and freed along with it. Copies of a
+        // fitter share the arena pointer but not the fitter's own peaks.
+        PeakArena *peak_arena = NULL;
+
 
     private:
         bool log_diagnostics;
 
+        PeakArena own_peaks;
+        Peak* new_peak();
+
         int solve_system (gsl_vector *x,
                 gsl_multifit_nlinear_fdf *fdf,
                 gsl_multifit_nlinear_parameters *params, int max,
@@ -2320,3 +2320,114 @@ TEST_F(GaussianFitterTest,problem_waveform_12_find){
 
         //////////////////////////
         //////////////////////////
+
+        ////////////////////////////////
+        // TESTING the native fitter  //
+        ////////////////////////////////
+
+//Fits ampData with both engines and checks that the peaks agree
+static void expect_engines_agree(std::vector<int> ampData){
+    std::vector<int> idxData(ampData.size(), 0);
+    std::iota(idxData.begin(), idxData.end(), 0);
+
+    GaussianFitter gslFitter;
+    gslFitter.noise_level = 10;
+    std::vector<Peak*> gslPeaks;
+    int gslCount = gslFitter.find_peaks(&gslPeaks, ampData, idxData, 200);
+
+    GaussianFitter nativeFitter;
+    nativeFitter.noise_level = 10;
+    nativeFitter.fitter_engine = Fitter::Engine::Native;
+    std::vector<Peak*> nativePeaks;
+    int nativeCount = nativeFitter.find_peaks(&nativePeaks, ampData, idxData,
+            200);
+
+    ASSERT_EQ(gslCount, nativeCount);
+    ASSERT_EQ(gslPeaks.size(), nativePeaks.size());
+    for(size_t i = 0; i < gslPeaks.size(); i++){
+        EXPECT_NEAR(gslPeaks.at(i)->amp, nativePeaks.at(i)->amp,
+                .02*gslPeaks.at(i)->amp);
+        EXPECT_NEAR(gslPeaks.at(i)->location, nativePeaks.at(i)->location,
+                .2);
+        EXPECT_NEAR(gslPeaks.at(i)->fwhm, nativePeaks.at(i)->fwhm,
+                .05*gslPeaks.at(i)->fwhm);
+    }
+    EXPECT_EQ(gslFitter.get_fail(), nativeFitter.get_fail());
+}
+
+TEST_F(GaussianFitterTest, native_matches_gsl){
+    //NayaniClipped1
+    expect_engines_agree({
+2,2,1,1,0,1,1,2,2,2,2,6,14,36,74,121,162,190,200,200,192,179,160,139,120,99,79,63,50,46,43,43,40,35,31,28,29,33,34,31,24,17,11,8,7,6,5,6,5,4,4,5,5,6,5,5,2,1,1,1
+    });
+    //Split3
+    expect_engines_agree({
+37,38,41,52,57,63,68,69,69,54,51,45,32,32,45,48,52,64,75,90,90,82,72,61,53,45,21,10,4,2,2,2,1,1,1,1
+    });
+    //problem_waveform_11
+    expect_engines_agree({
+1,1,0,0,0,0,0,0,0,0,0,0,8,34,87,154,211,239,236,199,144,86,41,17,11,12,13,14,14,13,12,9,7,7,7,7,6,5,4,3,3,2,2,3,5,3,3,2,1,1,0,0,0,0,0,1,3,2,1
+    });
+    //problem_waveform_12
+    expect_engines_agree({
+0,1,1,1,1,0,0,0,2,1,1,2,4,18,57,120,185,227,237,213,163,105,57,25,12,9,11,14,16,16,15,12,9,6,6,5,5,4,4,4,4,4,4,4,4,4,4,3,3,2,1,1,0,0,0,0,0,0,0,1
+    });
+}
+
+TEST_F(GaussianFitterTest, native_synthetic){
+    //Two well separated gaussians, the fit should land on them
+    std::vector<int> ampData;
+    std::vector<int> idxData;
+    for(int t = 0; t < 80; t++){
+        double z1 = (t - 20.3) / 3.1;
+        double z2 = (t - 45.7) / 4.2;
+        ampData.push_back(std::lround(150 * exp(-.5 * z1 * z1)
+                    + 60 * exp(-.5 * z2 * z2)));
+        idxData.push_back(t);
+    }
+
+    std::vector<Fitter::Gaussian> guesses{{140, 20, 2}, {55, 46, 3}};
+    ASSERT_TRUE(Fitter::fitGaussians(idxData, ampData, guesses,
+                Fitter::Engine::Native));
+
+    EXPECT_NEAR(150, guesses.at(0).a, 1);
+    EXPECT_NEAR(20.3, guesses.at(0).b, .05);
+    EXPECT_NEAR(3.1, guesses.at(0).c, .05);
+    EXPECT_NEAR(60, guesses.at(1).a, 1);
+    EXPECT_NEAR(45.7, guesses.at(1).b, .05);
+    EXPECT_NEAR(4.2, guesses.at(1).c, .05);
+}
+
+TEST_F(GaussianFitterTest, gsl_workspace_reuse){
+    std::vector<int> ampData;
+    std::vector<int> idxData;
+    for(int t = 0; t < 60; t++){
+        double z = (t - 25.4) / 3.3;
+        ampData.push_back(std::lround(120 * exp(-.5 * z * z)));
+        idxData.push_back(t);
+    }
+
+    Fitter::clearWorkspaceCache();
+    Fitter::WorkspaceCacheStats before = Fitter::workspaceCacheStats();
+
+    //Same size twice, the second fit reuses the workspace and must not be
+    //affected by whatever state the first left in it
+    std::vector<Fitter::Gaussian> first{{100, 24, 2}};
+    std::vector<Fitter::Gaussian> second{{100, 24, 2}};
+    ASSERT_TRUE(Fitter::fitGaussians(idxData, ampData, first));
+    ASSERT_TRUE(Fitter::fitGaussians(idxData, ampData, second));
+    EXPECT_EQ(first.at(0).a, second.at(0).a);
+    EXPECT_EQ(first.at(0).b, second.at(0).b);
+    EXPECT_EQ(first.at(0).c, second.at(0).c);
+
+    Fitter::WorkspaceCacheStats after = Fitter::workspaceCacheStats();
+    EXPECT_EQ(before.misses + 1, after.misses);
+    EXPECT_EQ(before.hits + 1, after.hits);
+
+    //A different number of samples needs a workspace of its own
+    idxData.pop_back();
+    ampData.pop_back();
+    std::vector<Fitter::Gaussian> shorter{{100, 24, 2}};
+    ASSERT_TRUE(Fitter::fitGaussians(idxData, ampData, shorter));
+    EXPECT_EQ(before.misses + 2, Fitter::workspaceCacheStats().misses);
+}
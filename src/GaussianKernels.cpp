@@ -0,0 +1,324 @@
+#include <cmath>
+
+#include "GaussianKernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GAUSSIAN_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace GaussianKernels{
+
+//Out of bounds penalty, see residuals()
+double penalty(const double* x, std::size_t p){
+    double pen = 0;
+    for(std::size_t j = 0; j < p; j += 3){
+        if(x[j] < 5 || x[j+1] < 0 || x[j+2] < 1){
+            pen += 1000;
+        }
+    }
+    return pen;
+}
+
+//Residual of a single sample, also used for the samples left over by the vector kernels
+inline double residualAt(double t, double y, const double* x, std::size_t p, double pen){
+    double r = y;
+    for(std::size_t j = 0; j < p; j += 3){
+        double z = (t-x[j+1])/x[j+2];
+        r -= x[j] * std::exp(-0.5 * z * z);
+    }
+    return r + pen;
+}
+
+//Jacobian row of a single sample
+inline void jacobianAt(double t, const double* x, std::size_t p, double* row){
+    for(std::size_t j = 0; j < p; j += 3){
+        double a = x[j];
+        double c = x[j+2];
+        double z = (t-x[j+1])/c;
+        double e = std::exp(-0.5 * z * z);
+
+        row[j]   = -e;
+        row[j+1] = -(a/c) * e * z;
+        row[j+2] = -(a/c) * e * z * z;
+    }
+}
+
+void residualsScalar(const double* t, const double* y, std::size_t n, const double* x, std::size_t p, double* f){
+    const double pen = penalty(x, p);
+    for(std::size_t i = 0; i < n; ++i){
+        f[i] = residualAt(t[i], y[i], x, p, pen);
+    }
+}
+
+void jacobianScalar(const double* t, std::size_t n, const double* x, std::size_t p, double* J, std::size_t ldJ){
+    for(std::size_t i = 0; i < n; ++i){
+        jacobianAt(t[i], x, p, J + i*ldJ);
+    }
+}
+
+#ifdef GAUSSIAN_KERNELS_X86
+
+//exp(r) = sum r^k/k! on |r| <= ln(2)/2, truncated past the last term that still matters in double precision
+#define EXP_C0  1.0
+#define EXP_C1  1.0
+#define EXP_C2  (1.0/2)
+#define EXP_C3  (1.0/6)
+#define EXP_C4  (1.0/24)
+#define EXP_C5  (1.0/120)
+#define EXP_C6  (1.0/720)
+#define EXP_C7  (1.0/5040)
+#define EXP_C8  (1.0/40320)
+#define EXP_C9  (1.0/362880)
+#define EXP_C10 (1.0/3628800)
+#define EXP_C11 (1.0/39916800)
+#define EXP_C12 (1.0/479001600)
+#define EXP_LOG2E   1.4426950408889634074
+#define EXP_LN2_HI  6.93145751953125e-1     //ln(2) split so k*EXP_LN2_HI is exact
+#define EXP_LN2_LO  1.42860682030941723212e-6
+#define EXP_MIN     -708.0                  //Below this exp is treated as 0
+#define EXP_MAX     709.0
+
+/**
+ * exp of 4 doubles. Splits x into k*ln(2) + r, evaluates exp(r) with a polynomial and scales it by 2^k through the
+ * exponent bits.
+ */
+__attribute__((target("avx2,fma")))
+inline __m256d exp4(__m256d x){
+    const __m256d lo = _mm256_set1_pd(EXP_MIN);
+    __m256d xc = _mm256_min_pd(_mm256_max_pd(x, lo), _mm256_set1_pd(EXP_MAX));
+
+    __m256d k = _mm256_round_pd(_mm256_mul_pd(xc, _mm256_set1_pd(EXP_LOG2E)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_HI), xc);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_LO), r);
+
+    __m256d poly = _mm256_set1_pd(EXP_C12);
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C11));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C10));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C9));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C8));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C7));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C6));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C5));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C4));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C3));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C2));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C1));
+    poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(EXP_C0));
+
+    __m256i bits = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(k));
+    bits = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+    __m256d result = _mm256_mul_pd(poly, _mm256_castsi256_pd(bits));
+
+    return _mm256_blendv_pd(result, _mm256_setzero_pd(), _mm256_cmp_pd(x, lo, _CMP_LT_OQ));
+}
+
+/**
+ * exp of 8 doubles, see exp4.
+ */
+__attribute__((target("avx512f")))
+inline __m512d exp8(__m512d x){
+    const __m512d lo = _mm512_set1_pd(EXP_MIN);
+    __m512d xc = _mm512_min_pd(_mm512_max_pd(x, lo), _mm512_set1_pd(EXP_MAX));
+
+    __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(xc, _mm512_set1_pd(EXP_LOG2E)),
+                                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_HI), xc);
+    r = _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_LO), r);
+
+    __m512d poly = _mm512_set1_pd(EXP_C12);
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C11));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C10));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C9));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C8));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C7));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C6));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C5));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C4));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C3));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C2));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C1));
+    poly = _mm512_fmadd_pd(poly, r, _mm512_set1_pd(EXP_C0));
+
+    __m512i bits = _mm512_cvtepi32_epi64(_mm512_cvtpd_epi32(k));
+    bits = _mm512_slli_epi64(_mm512_add_epi64(bits, _mm512_set1_epi64(1023)), 52);
+    __m512d result = _mm512_mul_pd(poly, _mm512_castsi512_pd(bits));
+
+    return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, lo, _CMP_LT_OQ), result, _mm512_setzero_pd());
+}
+
+__attribute__((target("avx2,fma")))
+void residualsAVX2(const double* t, const double* y, std::size_t n, const double* x, std::size_t p, double* f){
+    const double pen = penalty(x, p);
+    const __m256d half = _mm256_set1_pd(-0.5);
+    std::size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d tv = _mm256_loadu_pd(t + i);
+        __m256d r = _mm256_loadu_pd(y + i);
+        for(std::size_t j = 0; j < p; j += 3){
+            __m256d z = _mm256_div_pd(_mm256_sub_pd(tv, _mm256_set1_pd(x[j+1])), _mm256_set1_pd(x[j+2]));
+            __m256d e = exp4(_mm256_mul_pd(half, _mm256_mul_pd(z, z)));
+            r = _mm256_fnmadd_pd(_mm256_set1_pd(x[j]), e, r);
+        }
+        _mm256_storeu_pd(f + i, _mm256_add_pd(r, _mm256_set1_pd(pen)));
+    }
+    for(; i < n; ++i){
+        f[i] = residualAt(t[i], y[i], x, p, pen);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void jacobianAVX2(const double* t, std::size_t n, const double* x, std::size_t p, double* J, std::size_t ldJ){
+    const __m256d half = _mm256_set1_pd(-0.5);
+    alignas(32) double da[4], db[4], dc[4];
+    std::size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d tv = _mm256_loadu_pd(t + i);
+        for(std::size_t j = 0; j < p; j += 3){
+            __m256d z = _mm256_div_pd(_mm256_sub_pd(tv, _mm256_set1_pd(x[j+1])), _mm256_set1_pd(x[j+2]));
+            __m256d e = exp4(_mm256_mul_pd(half, _mm256_mul_pd(z, z)));
+            __m256d dB = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(-(x[j]/x[j+2])), e), z);
+
+            _mm256_store_pd(da, _mm256_sub_pd(_mm256_setzero_pd(), e));
+            _mm256_store_pd(db, dB);
+            _mm256_store_pd(dc, _mm256_mul_pd(dB, z));
+            for(std::size_t l = 0; l < 4; ++l){
+                double* row = J + (i+l)*ldJ;
+                row[j]   = da[l];
+                row[j+1] = db[l];
+                row[j+2] = dc[l];
+            }
+        }
+    }
+    for(; i < n; ++i){
+        jacobianAt(t[i], x, p, J + i*ldJ);
+    }
+}
+
+__attribute__((target("avx512f")))
+void residualsAVX512(const double* t, const double* y, std::size_t n, const double* x, std::size_t p, double* f){
+    const double pen = penalty(x, p);
+    const __m512d half = _mm512_set1_pd(-0.5);
+    std::size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m512d tv = _mm512_loadu_pd(t + i);
+        __m512d r = _mm512_loadu_pd(y + i);
+        for(std::size_t j = 0; j < p; j += 3){
+            __m512d z = _mm512_div_pd(_mm512_sub_pd(tv, _mm512_set1_pd(x[j+1])), _mm512_set1_pd(x[j+2]));
+            __m512d e = exp8(_mm512_mul_pd(half, _mm512_mul_pd(z, z)));
+            r = _mm512_fnmadd_pd(_mm512_set1_pd(x[j]), e, r);
+        }
+        _mm512_storeu_pd(f + i, _mm512_add_pd(r, _mm512_set1_pd(pen)));
+    }
+    for(; i < n; ++i){
+        f[i] = residualAt(t[i], y[i], x, p, pen);
+    }
+}
+
+__attribute__((target("avx512f")))
+void jacobianAVX512(const double* t, std::size_t n, const double* x, std::size_t p, double* J, std::size_t ldJ){
+    const __m512d half = _mm512_set1_pd(-0.5);
+    alignas(64) double da[8], db[8], dc[8];
+    std::size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m512d tv = _mm512_loadu_pd(t + i);
+        for(std::size_t j = 0; j < p; j += 3){
+            __m512d z = _mm512_div_pd(_mm512_sub_pd(tv, _mm512_set1_pd(x[j+1])), _mm512_set1_pd(x[j+2]));
+            __m512d e = exp8(_mm512_mul_pd(half, _mm512_mul_pd(z, z)));
+            __m512d dB = _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(-(x[j]/x[j+2])), e), z);
+
+            _mm512_store_pd(da, _mm512_sub_pd(_mm512_setzero_pd(), e));
+            _mm512_store_pd(db, dB);
+            _mm512_store_pd(dc, _mm512_mul_pd(dB, z));
+            for(std::size_t l = 0; l < 8; ++l){
+                double* row = J + (i+l)*ldJ;
+                row[j]   = da[l];
+                row[j+1] = db[l];
+                row[j+2] = dc[l];
+            }
+        }
+    }
+    for(; i < n; ++i){
+        jacobianAt(t[i], x, p, J + i*ldJ);
+    }
+}
+
+#endif  //GAUSSIAN_KERNELS_X86
+
+Isa detectIsa(){
+#ifdef GAUSSIAN_KERNELS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        return Isa::AVX512;
+    }
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        return Isa::AVX2;
+    }
+#endif
+    return Isa::Scalar;
+}
+
+//See GaussianKernels.hpp for docs
+Isa bestIsa(){
+    static const Isa best = detectIsa();
+    return best;
+}
+
+//See GaussianKernels.hpp for docs
+bool isaSupported(Isa isa){
+    switch(isa){
+        case Isa::AVX512:
+            return bestIsa() == Isa::AVX512;
+        case Isa::AVX2:
+            return bestIsa() != Isa::Scalar;
+        default:
+            return true;
+    }
+}
+
+//See GaussianKernels.hpp for docs
+void residuals(const double* t, const double* y, std::size_t n, const double* x, std::size_t p, double* f){
+    residuals(t, y, n, x, p, f, bestIsa());
+}
+
+//See GaussianKernels.hpp for docs
+void residuals(const double* t, const double* y, std::size_t n, const double* x, std::size_t p, double* f, Isa isa){
+    switch(isa){
+#ifdef GAUSSIAN_KERNELS_X86
+        case Isa::AVX512:
+            residualsAVX512(t, y, n, x, p, f);
+            break;
+        case Isa::AVX2:
+            residualsAVX2(t, y, n, x, p, f);
+            break;
+#endif
+        default:
+            residualsScalar(t, y, n, x, p, f);
+            break;
+    }
+}
+
+//See GaussianKernels.hpp for docs
+void jacobian(const double* t, std::size_t n, const double* x, std::size_t p, double* J, std::size_t ldJ){
+    jacobian(t, n, x, p, J, ldJ, bestIsa());
+}
+
+//See GaussianKernels.hpp for docs
+void jacobian(const double* t, std::size_t n, const double* x, std::size_t p, double* J, std::size_t ldJ, Isa isa){
+    switch(isa){
+#ifdef GAUSSIAN_KERNELS_X86
+        case Isa::AVX512:
+            jacobianAVX512(t, n, x, p, J, ldJ);
+            break;
+        case Isa::AVX2:
+            jacobianAVX2(t, n, x, p, J, ldJ);
+            break;
+#endif
+        default:
+            jacobianScalar(t, n, x, p, J, ldJ);
+            break;
+    }
+}
+
+} // namespace GaussianKernels
@@ -0,0 +1,60 @@
+#ifndef ADAPTLIDAR_GAUSSIANKERNELS_HPP
+#define ADAPTLIDAR_GAUSSIANKERNELS_HPP
+#include <cstddef>
+
+// Evaluates a sum of Gaussians a*exp(-0.5*((t-b)/c)^2) and its partial derivatives over a whole wave at once.
+// The AVX2 and AVX-512 versions handle 4 and 8 samples per step with a vectorised exp, the best one the CPU supports
+// is picked at runtime. The vectorised exp is within a few ulp of std::exp.
+namespace GaussianKernels{
+
+    /**
+     * Instruction sets the kernels are built for.
+     */
+    enum class Isa{
+        Scalar,
+        AVX2,
+        AVX512
+    };
+
+    /**
+     * @return  The widest instruction set supported by this CPU. Detected once.
+     */
+    Isa bestIsa();
+
+    /**
+     * @param isa   The instruction set to check
+     * @return      True if the kernels for isa can run on this CPU
+     */
+    bool isaSupported(Isa isa);
+
+    /**
+     * Residuals of a sum of Gaussians, f_i = y_i - sum_j g_j(t_i). Every Gaussian with a < 5, b < 0 or c < 1 adds a
+     * penalty of 1000 to every residual, which acts as a constraint on the fit.
+     *
+     * @param t     Sample indices
+     * @param y     Sample amplitudes
+     * @param n     Number of samples
+     * @param x     Parameters, p/3 {a,b,c} tuples
+     * @param p     Number of parameters
+     * @param f     Output array of n residuals
+     * @param isa   Instruction set to use, must be supported
+     */
+    void residuals(const double* t, const double* y, std::size_t n, const double* x, std::size_t p, double* f);
+    void residuals(const double* t, const double* y, std::size_t n, const double* x, std::size_t p, double* f, Isa isa);
+
+    /**
+     * Jacobian of the residuals, d f_i / d x_k.
+     *
+     * @param t     Sample indices
+     * @param n     Number of samples
+     * @param x     Parameters, p/3 {a,b,c} tuples
+     * @param p     Number of parameters
+     * @param J     Output n x p matrix, row major
+     * @param ldJ   Distance between the starts of two rows of J, at least p
+     * @param isa   Instruction set to use, must be supported
+     */
+    void jacobian(const double* t, std::size_t n, const double* x, std::size_t p, double* J, std::size_t ldJ);
+    void jacobian(const double* t, std::size_t n, const double* x, std::size_t p, double* J, std::size_t ldJ, Isa isa);
+
+} // namespace GaussianKernels
+#endif  //ADAPTLIDAR_GAUSSIANKERNELS_HPP
@@ -0,0 +1,119 @@
+// File name: GaussianKernels_unittests.cpp
+// Created on: 18-October-2026
+
+#include "GaussianKernels.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+
+using GaussianKernels::Isa;
+
+class GaussianKernelsTest : public testing::Test {
+    protected:
+
+        virtual void SetUp(){
+            //Three peaks, the last one out of bounds so the penalty applies
+            params = {200, 18.5, 3.2, 43, 30.1, 1.7, 4, 38.6, 2.5};
+            for(int i = 0; i < 61; i++){
+                t.push_back(i);
+                y.push_back(200 * std::exp(-0.5 * std::pow((i - 18) / 3., 2))
+                        + (i % 7));
+            }
+        }
+
+        //Every instruction set this CPU can run
+        static std::vector<Isa> supported(){
+            std::vector<Isa> isas;
+            for(Isa isa : {Isa::Scalar, Isa::AVX2, Isa::AVX512}){
+                if(GaussianKernels::isaSupported(isa)){
+                    isas.push_back(isa);
+                }
+            }
+            return isas;
+        }
+
+        std::vector<double> params;
+        std::vector<double> t;
+        std::vector<double> y;
+};
+
+//The vectorised exp should be within a few ulp of std::exp. Exponents below
+//-708 are flushed to 0, so stop short of them
+TEST_F(GaussianKernelsTest, expAccuracy){
+    std::vector<double> zero(2000, 0);
+    std::vector<double> ts;
+    for(int i = 0; i < 2000; i++){
+        ts.push_back(i * 0.0185);
+    }
+    //a=5 keeps us clear of the penalty, c=1 makes the exponent -0.5*t^2
+    double single[] = {5, 0, 1};
+
+    for(Isa isa : supported()){
+        std::vector<double> f(ts.size());
+        GaussianKernels::residuals(ts.data(), zero.data(), ts.size(), single,
+                3, f.data(), isa);
+        for(size_t i = 0; i < ts.size(); i++){
+            double expected = -5 * std::exp(-0.5 * ts[i] * ts[i]);
+            EXPECT_NEAR(expected, f[i], 8e-16 * std::fabs(expected))
+                << "isa " << static_cast<int>(isa) << " t " << ts[i];
+        }
+    }
+}
+
+//Residuals of every instruction set should match the scalar kernel
+TEST_F(GaussianKernelsTest, residualsMatchScalar){
+    //Cover every number of left over samples
+    for(size_t n = 1; n <= t.size(); n++){
+        std::vector<double> expected(n);
+        GaussianKernels::residuals(t.data(), y.data(), n, params.data(),
+                params.size(), expected.data(), Isa::Scalar);
+
+        for(Isa isa : supported()){
+            std::vector<double> f(n);
+            GaussianKernels::residuals(t.data(), y.data(), n, params.data(),
+                    params.size(), f.data(), isa);
+            for(size_t i = 0; i < n; i++){
+                EXPECT_NEAR(expected[i], f[i], 1e-12 * (1 + std::fabs(expected[i])));
+            }
+        }
+    }
+}
+
+//Jacobians of every instruction set should match the scalar kernel
+TEST_F(GaussianKernelsTest, jacobianMatchesScalar){
+    const size_t p = params.size();
+    const size_t ld = p + 2;    //Rows padded, as GSL matrices can be
+    for(size_t n = 1; n <= t.size(); n++){
+        std::vector<double> expected(n * ld, -1);
+        GaussianKernels::jacobian(t.data(), n, params.data(), p,
+                expected.data(), ld, Isa::Scalar);
+
+        for(Isa isa : supported()){
+            std::vector<double> J(n * ld, -1);
+            GaussianKernels::jacobian(t.data(), n, params.data(), p, J.data(),
+                    ld, isa);
+            for(size_t i = 0; i < n * ld; i++){
+                EXPECT_NEAR(expected[i], J[i], 1e-12 * (1 + std::fabs(expected[i])));
+            }
+        }
+    }
+}
+
+//Far out in the tails the Gaussian should underflow to 0 rather than blow up
+TEST_F(GaussianKernelsTest, underflow){
+    std::vector<double> ts = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 1e3, 1e6, 1e9};
+    std::vector<double> zero(ts.size(), 0);
+    double narrow[] = {100, 5, 1};
+
+    for(Isa isa : supported()){
+        std::vector<double> f(ts.size());
+        GaussianKernels::residuals(ts.data(), zero.data(), ts.size(), narrow,
+                3, f.data(), isa);
+        for(size_t i = 0; i < ts.size(); i++){
+            EXPECT_TRUE(std::isfinite(f[i]));
+        }
+        EXPECT_EQ(0, f[10]);
+        EXPECT_EQ(0, f[11]);
+        EXPECT_EQ(0, f[12]);
+    }
+}
@@ -3,9 +3,11 @@
 #include <vector>
 #include <sstream>
 #include <math.h>
+#include <cstdlib>
 #include "pulsereader.hpp"
 #include "pulsewriter.hpp"
 #include "PulseData.hpp"
+#include "PulseIndex.hpp"
 
 // Activity level must be defined before spdlog is included.
 #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
@@ -26,7 +28,8 @@ int main (int argc, char *argv[]) {
     PULSEreader *pReader;
 
     if(argc < 2){
-        spdlog::error("Usage: {} <path to .pls file>", argv[0]);
+        spdlog::error("Usage: {} <path to .pls file> [--build-index "
+                "[pulses per block]]", argv[0]);
         return 1;
     }
 
@@ -38,6 +41,27 @@ int main (int argc, char *argv[]) {
         return 1;
     }
 
+    //Write the pulse index sidecar file instead of printing the header
+    if(argc > 2 && std::string(argv[2]) == "--build-index"){
+        long block_size = argc > 3 ? std::atol(argv[3]) : PULSE_INDEX_BLOCK_SIZE;
+        if(block_size < 1){
+            spdlog::error("Pulses per block must be at least 1");
+            return 1;
+        }
+        PulseIndex index(block_size);
+        index.build(pReader, PulseIndex::file_size(fileName));
+        pReader->close();
+        delete pReader;
+        std::string indexFileName = PulseIndex::index_file_name(fileName);
+        if(!index.save(indexFileName)){
+            return 1;
+        }
+        fprintf(stdout, "Indexed %lld pulses in %zu blocks: %s\n",
+                (long long)index.number_of_pulses(), index.blocks().size(),
+                indexFileName.c_str());
+        return 0;
+    }
+
     /* This record is simply an array of ASCII data. It contains one or 
      * many strings separated by null or space characters which are referenced 
      * by position from tags in the GeoKeyDirectory */
@@ -15,19 +15,55 @@ LidarDriver::LidarDriver() {
  * @param band_desc the description for the band data
  * @param x_idx_extent the x extent value
  * @param y_idx_extent the y extent value
+ * @param options the tiling, compression and encoding of the output
  * @return a pointer to a GDALDataset object with the provided metadata
  */
 
 GDALDataset* LidarDriver::setup_gdal_ds(GDALDriver *tiff_driver,
         std::string filename,
         std::string band_desc,
-        int x_idx_extent, int y_idx_extent)
+        int x_idx_extent, int y_idx_extent, const RasterOptions &options)
+{
+    return setup_gdal_ds(tiff_driver, filename,
+            std::vector<std::string>(1, band_desc), x_idx_extent,
+            y_idx_extent, options);
+}
+
+/**
+ * setup a gdal dataset (file) holding several products, one to a band
+ * @param tiff_driver pointer to the GTiff driver
+ * @param filename the filename for the output
+ * @param band_descs the description of each band
+ * @param x_idx_extent the x extent value
+ * @param y_idx_extent the y extent value
+ * @param options the tiling, compression and encoding of the output
+ * @return a pointer to a GDALDataset object with the provided metadata
+ */
+GDALDataset* LidarDriver::setup_gdal_ds(GDALDriver *tiff_driver,
+        std::string filename, const std::vector<std::string> &band_descs,
+        int x_idx_extent, int y_idx_extent, const RasterOptions &options)
 {
     GDALDataset * gdal_ds;
+    char **create_opts = RasterWriter::creation_options(options,
+            band_descs.size());
     gdal_ds = tiff_driver->Create(filename.c_str(), x_idx_extent, y_idx_extent,
-            1, GDT_Float32, NULL);
-    gdal_ds->GetRasterBand(1)->SetNoDataValue(NO_DATA);
-    gdal_ds->GetRasterBand(1)->SetDescription(band_desc.c_str());
+            band_descs.size(), RasterWriter::data_type(options), create_opts);
+    CSLDestroy(create_opts);
+    for (size_t i = 0; i < band_descs.size(); i++) {
+        GDALRasterBand *band = gdal_ds->GetRasterBand(i + 1);
+        if (options.int16_scale != 0) {
+            band->SetNoDataValue(RASTER_INT16_NO_DATA);
+            band->SetScale(options.int16_scale);
+            band->SetOffset(options.int16_offset);
+        } else {
+            band->SetNoDataValue(NO_DATA);
+        }
+        band->SetDescription(band_descs[i].c_str());
+    }
+    if (options.overviews &&
+            RasterWriter::create_overviews(gdal_ds, options) != CE_None) {
+        spdlog::error("Unable to create the overviews of {}", filename);
+    }
 
     return gdal_ds;
 }
@@ -36,8 +72,10 @@ GDALDataset* LidarDriver::setup_gdal_ds(GDALDriver *tiff_driver,
  * Calculates the memory needed to store all the requested products
  * @param data the FlightLineData object containing bounding box information
  * @param num_products the number of products that will be produced
+ * @param resolution the width and height of a cell of the products
  */
-void LidarDriver::calc_product_size(FlightLineData &data, int num_products){
+void LidarDriver::calc_product_size(FlightLineData &data, int num_products,
+        double resolution){
     //This keeps track of units
     size_t i = 0;
     double bytes = -1;
@@ -46,8 +84,9 @@ void LidarDriver::calc_product_size(FlightLineData &data, int num_products){
     //If we get bytes < 0 then we had an overflow
     for (i = 0; bytes < 0 and i < units.size(); i++){
         //Number of floats we are storing per product, based on the bounding box
-        double vals_per_product = std::ceil(data.bb_x_max - data.bb_x_min) *
-            std::ceil(data.bb_y_max - data.bb_y_min);
+        double vals_per_product =
+            std::ceil((data.bb_x_max - data.bb_x_min) / resolution) *
+            std::ceil((data.bb_y_max - data.bb_y_min) / resolution);
         //The number of bytes allocated for each float value
         float bytes_per_val = sizeof(float);
         //Find conversion from bytes to current prefix (kilo,mega,giga)
@@ -78,15 +117,33 @@ void LidarDriver::calc_product_size(FlightLineData &data, int num_products){
  * fits the raw data using either gaussian or first difference fitting
  * @param raw_data reference to FlightLineData object that holds raw data
  * @param fitted_data reference to LidarVolume object to store fit data in
- * @param useGaussianFitting flag to indicate fitting type
+ * @param cmdLine command line options, selects the fitting type and the
+ * number of threads to fit with
  */
 void LidarDriver::fit_data(FlightLineData &raw_data, LidarVolume &fitted_data,
         CmdLine &cmdLine) 
+{
+    std::vector<LidarVolume*> volumes(1, &fitted_data);
+    fit_data(raw_data, volumes, cmdLine);
+}
+
+/**
+ * fits the raw data once, adding every peak to a volume of each resolution
+ * @param raw_data reference to FlightLineData object that holds raw data
+ * @param volumes the volumes to store fit data in, volume i has cells of
+ * cmdLine.resolutions[i]
+ * @param cmdLine command line options, selects the fitting type, the number
+ * of threads to fit with, the resolutions and the peak store to write every
+ * peak to
+ */
+void LidarDriver::fit_data(FlightLineData &raw_data,
+        std::vector<LidarVolume*> &volumes, CmdLine &cmdLine)
 {
     PulseData pd;
     std::ostringstream stream;
     GaussianFitter fitter;
     fitter.noise_level = cmdLine.noise_level;
+    fitter.fitter_engine = cmdLine.fitter_engine;
     if (cmdLine.max_amp_multiplier != 0.0)
         fitter.max_amp_multiplier = cmdLine.max_amp_multiplier;
     std::vector<Peak*> peaks;
@@ -94,14 +151,53 @@ void LidarDriver::fit_data(FlightLineData &raw_data, LidarVolume &fitted_data,
 
     spdlog::debug("Start finding peaks. In {}:{}", __FILE__, __LINE__);
 
-    //setup the lidar volume bounding and allocate memory
-    setup_lidar_volume(raw_data, fitted_data);
+    //setup the bounding and allocate memory of each lidar volume
+    PeakArena pulse_peaks;
+    PeakArena *peak_owner = setup_lidar_volumes(raw_data, volumes, cmdLine);
+    fitter.peak_arena = peak_owner != NULL ? peak_owner : &pulse_peaks;
+
+    //every peak found is also written to the peak store, if asked for
+    PeakStoreWriter store;
+    if (!cmdLine.emit_peaks.empty()) {
+        PeakStoreInfo info;
+        info.bb_x_min = raw_data.bb_x_min;
+        info.bb_x_max = raw_data.bb_x_max;
+        info.bb_y_min = raw_data.bb_y_min;
+        info.bb_y_max = raw_data.bb_y_max;
+        info.bb_z_min = raw_data.bb_z_min;
+        info.bb_z_max = raw_data.bb_z_max;
+        info.utm = raw_data.utm;
+        info.geog_cs = raw_data.geog_cs;
+        info.gaussian = cmdLine.useGaussianFitting;
+        info.backscatter = cmdLine.calcBackscatter;
+        if (store.open(cmdLine.emit_peaks, info)) {
+            spdlog::info("Writing peaks to {}", cmdLine.emit_peaks);
+        }
+    }
 
     //message the user
     std::string fit_type=cmdLine.useGaussianFitting?"gaussian fitting":
         "first difference";
     spdlog::info("Finding peaks with {}", fit_type);
 
+    if (cmdLine.num_threads > 1) {
+        spdlog::info("Fitting with {} threads", cmdLine.num_threads);
+        PulsePipeline pipeline(cmdLine.num_threads);
+        pipeline.run(raw_data, fitter,
+                [&](PulseRecord &record, GaussianFitter &worker_fitter,
+                    std::vector<Peak*> &pulse_peaks) {
+                    fit_pulse(record.pulse, record.gps_info, raw_data,
+                            worker_fitter, cmdLine, pulse_peaks);
+                },
+                [&](PulseRecord &, std::vector<Peak*> &merged_peaks) {
+                    store.append(merged_peaks, merged_peaks.size());
+                    for (LidarVolume *volume : volumes) {
+                        add_peaks_to_volume(*volume, merged_peaks,
+                                merged_peaks.size());
+                    }
+                }, peak_owner);
+    }
+
     //Initialize variables to store max and min xyz values of the data
     //bool first = true;
     //int bb_x_min, bb_x_max, bb_y_min, bb_y_max, bb_z_min, bb_z_max;
@@ -133,38 +229,16 @@ void LidarDriver::fit_data(FlightLineData &raw_data, LidarVolume &fitted_data,
             bb_z_max = bb_z_max < z ? z : bb_z_max;
         }*/
        
-        //Skip all the empty returning waveforms
-        if (pd.returningIdx.empty()){
-            continue;
-        }
-        try {
-            // Smooth the data and test result
-            fitter.smoothing_expt(&pd.returningWave);
-           
-            // Check parameter for using gaussian fitting or first differencing
-            if (cmdLine.useGaussianFitting) {
-                peak_count = fitter.find_peaks(&peaks, pd.returningWave,
-                                     pd.returningIdx, 200);
-            } else {
-                peak_count = fitter.guess_peaks(&peaks, pd.returningWave,
-                                     pd.returningIdx);
-            }
- 
-            // for each peak - find the activation point
-            //               - calculate x,y,z
-            peak_count = raw_data.calc_xyz_activation(&peaks);
-           
-            // Calculate all requested information - Backscatter Coefficient
-            // - Energy at % Height  - Height at % Energy
-            peak_calculations(pd, peaks, fitter, cmdLine,
-                       raw_data.current_wave_gps_info);
-
-            add_peaks_to_volume(fitted_data, peaks, peak_count);
-        } catch (const char *msg) {
-            std::cerr << msg << std::endl;
+        peak_count = fit_pulse(pd, raw_data.current_wave_gps_info, raw_data,
+                fitter, cmdLine, peaks);
+        store.append(peaks, peak_count);
+        for (LidarVolume *volume : volumes) {
+            add_peaks_to_volume(*volume, peaks, peak_count);
         }
+        pulse_peaks.clear();
     }
     peaks.clear();
+    fitter.peak_arena = NULL;
 
     //Print the bounding box and our extreme x,y,z coordinates
     /*std::cout << "Bounding Box: " << fitted_data.bb_x_min << "-" <<
@@ -179,6 +253,175 @@ void LidarDriver::fit_data(FlightLineData &raw_data, LidarVolume &fitted_data,
     spdlog::info("Pass: {}", fitter.pass);
     spdlog::info("Fail: {}", fitter.fail);
     spdlog::info("Short: {}", fitter.small);
+
+    Fitter::WorkspaceCacheStats cache_stats = Fitter::workspaceCacheStats();
+    spdlog::debug("Fitter workspace cache hits: {}, misses: {}",
+            cache_stats.hits, cache_stats.misses);
+
+    if (store.is_open() && !store.close()) {
+        spdlog::error("Unable to write the peak store {}", cmdLine.emit_peaks);
+    }
+    finish_lidar_volumes(volumes);
+}
+
+/**
+ * Fills volumes with the peaks of a peak store instead of fitting them. The
+ * peaks are read a chunk at a time, skipping the columns the products are
+ * not made from.
+ * @param raw_data the flight line the volumes cover, its bounding box set
+ * from the store
+ * @param store an open peak store
+ * @param volumes the volumes to store the peaks in, volume i has cells of
+ * cmdLine.resolutions[i]
+ * @param cmdLine command line options, selects the resolutions and how the
+ * peaks are kept
+ * @return false if the store could not be read
+ */
+bool LidarDriver::load_peaks(FlightLineData &raw_data, PeakStoreReader &store,
+        std::vector<LidarVolume*> &volumes, CmdLine &cmdLine)
+{
+    if (cmdLine.calcBackscatter && !store.info().backscatter) {
+        spdlog::warn("Backscatter coefficients were not calculated when {} "
+                "was written", cmdLine.getInputFileName(true));
+    }
+    PeakArena chunk_peaks;
+    PeakArena *peak_owner = setup_lidar_volumes(raw_data, volumes, cmdLine);
+    PeakArena &arena = peak_owner != NULL ? *peak_owner : chunk_peaks;
+
+    spdlog::info("Reading {} peaks", store.peak_count());
+    std::vector<Peak*> peaks;
+    bool read = true;
+    for (size_t chunk = 0; chunk < store.chunk_count() && read; chunk++) {
+        read = store.read_chunk(chunk, arena, peaks,
+                PEAK_STORE_PRODUCT_COLUMNS);
+        for (LidarVolume *volume : volumes) {
+            add_peaks_to_volume(*volume, peaks, peaks.size());
+        }
+        chunk_peaks.clear();
+    }
+    finish_lidar_volumes(volumes);
+    return read;
+}
+
+/**
+ * Sets up a volume for each resolution to fit peaks into
+ * @param raw_data the flight line the volumes cover
+ * @param volumes the volumes to set up, volume i has cells of
+ * cmdLine.resolutions[i]
+ * @param cmdLine command line options, selects how the peaks are kept
+ * @return the arena the peaks added to the volumes must be allocated from,
+ * NULL if they only have to live until they are added
+ */
+PeakArena* LidarDriver::setup_lidar_volumes(FlightLineData &raw_data,
+        std::vector<LidarVolume*> &volumes, CmdLine &cmdLine)
+{
+    ProductEngine engine;
+    setup_product_engine(engine, cmdLine);
+    for (size_t i = 0; i < volumes.size(); i++) {
+        double resolution = i < cmdLine.resolutions.size() ?
+            cmdLine.resolutions[i] : 1;
+        if (cmdLine.stream_products) {
+            //only the moments the selected products are made from are kept
+            setup_lidar_volume(raw_data, *volumes[i], 0,
+                    &engine.moment_groups(), resolution);
+        } else {
+            //the volumes share the memory allowed for peaks, tiled like the
+            //products unless they are written in strips
+            int tile_size = cmdLine.raster_options.tile_size > 0 ?
+                cmdLine.raster_options.tile_size : VOLUME_TILE_SIZE;
+            setup_lidar_volume(raw_data, *volumes[i],
+                    cmdLine.max_memory * 1024 * 1024 / volumes.size(), NULL,
+                    resolution, tile_size);
+        }
+    }
+
+    //The first volume keeps the peaks it is given, unless it is tiled or
+    //streamed and copies what it needs, then they only have to live until
+    //they are added. Any other volume keeping peaks points at those of the
+    //first.
+    LidarVolume &fitted_data = *volumes[0];
+    return fitted_data.tiles == NULL && fitted_data.moments == NULL ?
+        &fitted_data.peak_arena : NULL;
+}
+
+/**
+ * Reports the memory of each volume once every peak is added, and gives the
+ * volumes after the first a copy of the peaks they point at
+ * @param volumes the volumes filled by fit_data or load_peaks
+ */
+void LidarDriver::finish_lidar_volumes(std::vector<LidarVolume*> &volumes)
+{
+    for (size_t i = volumes.size(); i-- > 0; ) {
+        LidarVolume &volume = *volumes[i];
+        if (volume.tiles != NULL) {
+            spdlog::debug("Peaks in memory: {} MB, spilled to disk: {} MB",
+                    volume.tiles->resident_bytes() / (1024 * 1024),
+                    volume.tiles->spilled_bytes() / (1024 * 1024));
+        }
+        if (volume.moments != NULL) {
+            spdlog::debug("Cell moments in memory: {} MB",
+                    volume.moments->bytes() / (1024 * 1024));
+        }
+        //the peaks of the first volume are freed when it is finalized, so
+        //the others take their own copy first
+        if (i > 0 && volume.tiles == NULL && volume.moments == NULL) {
+            volume.finalize();
+        }
+    }
+}
+
+/**
+ * Fits a single pulse and calculates the activation point and requested
+ * information of every peak found. Safe to call from several threads at once
+ * as long as each thread uses its own fitter.
+ * @param pulse the pulse to fit, its returning wave is smoothed in place
+ * @param gps_info gps information read along with the pulse
+ * @param raw_data the flight line the pulse was read from
+ * @param fitter the fitter to use for smoothing and fitting
+ * @param cmdLine command line object used to select the fitting type
+ * @param peaks vector to store the found peaks in
+ * @return count of peaks found, 0 for empty waveforms or failed fits
+ */
+int LidarDriver::fit_pulse(PulseData &pulse, WaveGPSInformation &gps_info,
+        FlightLineData &raw_data, GaussianFitter &fitter, CmdLine &cmdLine,
+        std::vector<Peak*> &peaks)
+{
+    int peak_count = 0;
+
+    // make sure that we have an empty vector
+    peaks.clear();
+
+    //Skip all the empty returning waveforms
+    if (pulse.returningIdx.empty()){
+        return 0;
+    }
+    try {
+        // Smooth the data and test result
+        fitter.smoothing_expt(&pulse.returningWave);
+
+        // Check parameter for using gaussian fitting or first differencing
+        if (cmdLine.useGaussianFitting) {
+            peak_count = fitter.find_peaks(&peaks, pulse.returningWave,
+                                 pulse.returningIdx, 200);
+        } else {
+            peak_count = fitter.guess_peaks(&peaks, pulse.returningWave,
+                                 pulse.returningIdx);
+        }
+
+        // for each peak - find the activation point
+        //               - calculate x,y,z
+        peak_count = raw_data.calc_xyz_activation(&peaks, gps_info,
+                fitter.owning_arena());
+
+        // Calculate all requested information - Backscatter Coefficient
+        // - Energy at % Height  - Height at % Energy
+        peak_calculations(pulse, peaks, fitter, cmdLine, gps_info);
+    } catch (const char *msg) {
+        std::cerr << msg << std::endl;
+        fitter.release_peaks(peaks);
+        return 0;
+    }
+    return peak_count;
 }
 
 void log_raw_data(std::vector<int> idx, std::vector<int> wave) {
@@ -218,13 +461,31 @@ void log_raw_data(std::vector<int> idx, std::vector<int> wave) {
  * setup the bounding and allocate memory for the LidarVolume
  * @param raw_data the flight light data to get values from
  * @param lidar_volume the lidar volume object to allocate
+ * @param memory_limit bytes of peaks to keep in memory before spilling tiles
+ * of the volume to disk, 0 keeps the whole volume in memory
+ * @param moment_groups if not NULL, only the running moments of these groups
+ * are kept for each cell instead of its peaks
+ * @param resolution the width and height of a cell of the volume
+ * @param tile_size number of cells along each side of a tile of a tiled
+ * volume, the tile size of the products so whole blocks are written at once
  */
 void LidarDriver::setup_lidar_volume(FlightLineData &raw_data,
-        LidarVolume &lidar_volume){
+        LidarVolume &lidar_volume, size_t memory_limit,
+        const std::vector<MomentGroup> *moment_groups, double resolution,
+        int tile_size){
     lidar_volume.setBoundingBox(raw_data.bb_x_min, raw_data.bb_x_max,
             raw_data.bb_y_min, raw_data.bb_y_max,
-            raw_data.bb_z_min, raw_data.bb_z_max);
-    lidar_volume.allocateMemory();
+            raw_data.bb_z_min, raw_data.bb_z_max, resolution);
+    if (moment_groups != NULL) {
+        spdlog::info("Streaming peaks into the moments of each cell");
+        lidar_volume.enableStreaming(*moment_groups);
+    } else if (memory_limit > 0) {
+        spdlog::info("Keeping peaks in tiles, spilling to disk after {} MB",
+                memory_limit / (1024 * 1024));
+        lidar_volume.enableTiling(memory_limit, tile_size);
+    } else {
+        lidar_volume.allocateMemory();
+    }
 }
 
 /**
@@ -282,6 +543,7 @@ void LidarDriver::peak_calculations(PulseData &pulse, std::vector<Peak*> &peaks,
                 (*it)->backscatter_coefficient = NO_DATA;
             }
         }
+        fitter.release_peaks(emitted_peaks);
     }
 
     //Check if each peak has a rise time
@@ -302,83 +564,136 @@ void LidarDriver::peak_calculations(PulseData &pulse, std::vector<Peak*> &peaks,
  * @param prod_calc the code of the calculation to use
  * @param prod_peaks the code of the peaks to use
  * @param prod_var the code the variable to use
+ * @param x_offset column of the dataset the volume's first column is written to
+ * @param y_offset row of the dataset the volume's last row is written to
  */
 void LidarDriver::produce_product(LidarVolume &fitted_data,
-        GDALDataset *gdal_ds, int prod_calc, int prod_peaks, int prod_var)
+        GDALDataset *gdal_ds, int prod_calc, int prod_peaks, int prod_var,
+        int x_offset, int y_offset)
 {
-    CPLErr retval;
-    
-    //indexes
-    int x, y;
-    //place to hold the elevations
-    float *pixel_values = (float *) calloc(fitted_data.x_idx_extent,
-                                           sizeof(float));
-    float avg = 0 ;
-    float dev = 0;
+    ProductEngine engine;
+    engine.add_product(prod_calc, prod_peaks, prod_var);
+    RasterWriter writer(gdal_ds);
+    std::vector<RasterWriter*> writers(1, &writer);
+    produce_products(fitted_data, engine, writers, x_offset, y_offset);
+}
 
-    spdlog::debug("Entering write image loop. In {} : {}", __FILE__, __LINE__);
+/**
+ * write every product of an engine to its raster, computing all of them in a
+ * single pass over the peaks of each row
+ * @param fitted_data the populated lidar volume
+ * @param engine the products to compute
+ * @param writers writers of prepared datasets, taking the products of the
+ * engine in order, one to each band
+ * @param x_offset column of the datasets the volume's first column is written
+ * to
+ * @param y_offset row of the datasets the volume's last row is written to
+ * @param num_threads threads computing the products, the products are the
+ * same for any number
+ */
+void LidarDriver::produce_products(LidarVolume &fitted_data,
+        ProductEngine &engine, std::vector<RasterWriter*> &writers,
+        int x_offset, int y_offset, int num_threads)
+{
+    //the rows of the products of each writer
+    std::vector<const float*> band_rows;
+    size_t band_count = 0;
+    for (RasterWriter *writer : writers) {
+        band_count += writer->band_count();
+    }
+    if (band_count != engine.product_count()) {
+        spdlog::error("{} products can not be written to {} bands",
+                engine.product_count(), band_count);
+        return;
+    }
 
+    spdlog::debug("Entering write image loop. In {} : {}", __FILE__, __LINE__);
 
+    //stream over the peaks of each cell in one contiguous array, unless only
+    //their moments were kept
+    if (fitted_data.moments == NULL && !fitted_data.is_finalized()) {
+        fitted_data.finalize();
+    }
 
-    //loop through every pixel position
-    for (y = fitted_data.y_idx_extent - 1; y >= 0; y--) {
-        for (x = 0; x < fitted_data.x_idx_extent; x++) {
-            //get the vector of found peaks at this pixel
-            std::vector<Peak*> *peaks =
-                fitted_data.volume[fitted_data.position(y, x)];
-            //decide what to do with the peak data at this pixel
-            switch (prod_calc) {
-                case 0: //max
-                    pixel_values[x] = get_extreme(peaks, true, prod_peaks,
-                        prod_var);
-                    break;
-                case 1: //min
-                    pixel_values[x] = get_extreme(peaks, false, prod_peaks,
-                        prod_var);
-                    break;
-                case 2: //mean
-                    pixel_values[x] = get_mean( peaks, prod_peaks, prod_var);
-                    break;
-                case 3: //std-dev
-                    avg = get_mean(peaks,prod_peaks,prod_var);
-                    pixel_values[x] = get_deviation(peaks, avg, prod_peaks,
-                        prod_var);
-                    break;
-                case 4: //skewness
-                    avg = get_mean(peaks, prod_peaks, prod_var);
-                    dev = get_deviation(peaks, avg, prod_peaks, prod_var);
-                    pixel_values[x] = get_skewtosis(peaks, avg, dev, prod_peaks,
-                        prod_var, 3);
-                    break;
-                case 5: //kurtosis
-                    avg = get_mean(peaks, prod_peaks, prod_var);
-                    dev = get_deviation(peaks, avg, prod_peaks, prod_var);
-                    pixel_values[x] = get_skewtosis(peaks, avg, dev, prod_peaks,
-                        prod_var, 4);
-                    break;
-                default:
-                    //std::cout << "Product #" << prod_id << " not implemented"
-                    //<< std::endl;
-                    break;
+    //the writers add the rows to the rasters a block at a time
+    auto write_row = [&](int y, const std::vector<const float*> &product_rows){
+        spdlog::trace("In writeImage loop. Writing row: {}. In {} : {}", y,
+                       __FILE__, __LINE__);
+        size_t product = 0;
+        for (RasterWriter *writer : writers) {
+            band_rows.clear();
+            for (int band = 0; band < writer->band_count(); band++) {
+                band_rows.push_back(product_rows[product++]);
             }
+            writer->write_row(y_offset + fitted_data.y_idx_extent - y - 1,
+                    x_offset, fitted_data.x_idx_extent, band_rows.data());
         }
+    };
 
-        spdlog::trace("In writeImage loop. Writing band: {}, {}. In {} : {}", x, y,
-                       __FILE__, __LINE__);
+    //blocks of rows are computed on every thread and written in order
+    if (num_threads > 1) {
+        ProductPipeline pipeline(num_threads);
+        pipeline.run(fitted_data, engine, write_row);
+        return;
+    }
 
-        //add the pixel values to the raster, one column at a time
-        // Refer to http://www.gdal.org/classGDALRasterBand.html
-        retval = gdal_ds->GetRasterBand(1)->RasterIO(GF_Write, 0,
-                fitted_data.y_idx_extent - y - 1, fitted_data.x_idx_extent, 1,
-                pixel_values, fitted_data.x_idx_extent, 1, GDT_Float32, 0, 0,
-                NULL);
-        if (retval != CE_None) {
-            spdlog::error("Error during writing band: 1 ");
+    //loop through every row, filling a row of every product at once
+    std::vector<const float*> product_rows(engine.product_count());
+    for (int y = fitted_data.y_idx_extent - 1; y >= 0; y--) {
+        engine.compute_row(fitted_data, y);
+        for (size_t i = 0; i < product_rows.size(); i++) {
+            product_rows[i] = engine.row(i);
         }
+        write_row(y, product_rows);
     }
+}
 
-    free(pixel_values);
+/**
+ * set up an engine computing every selected product, in the order they were
+ * selected
+ * @param engine an empty engine to add the products to
+ * @param cmdLine command line options holding the selected products
+ */
+void LidarDriver::setup_product_engine(ProductEngine &engine,
+        CmdLine &cmdLine)
+{
+    for (const int& prod : cmdLine.selected_products) {
+        engine.add_product(cmdLine.get_calculation_code(prod),
+                cmdLine.get_peaks_code(prod), cmdLine.get_variable_code(prod));
+    }
+}
 
+/**
+ * write every selected product of a tiled lidar volume, one tile at a time,
+ * so only one tile of peaks is in memory while writing
+ * @param fitted_data the populated, tiled lidar volume
+ * @param writers writers of prepared datasets, taking the selected products
+ * in order, one to each band
+ * @param cmdLine command line options holding the selected products
+ * @return false if the peaks of a tile could not be read back
+ */
+bool LidarDriver::produce_tiled_products(LidarVolume &fitted_data,
+        std::vector<RasterWriter*> &writers, CmdLine &cmdLine)
+{
+    int tile_x, tile_y;
+    ProductEngine engine;
+    setup_product_engine(engine, cmdLine);
+    for (size_t tile = 0; tile < fitted_data.tiles->tile_count(); tile++) {
+        LidarVolume tile_volume;
+        if (!fitted_data.load_tile(tile, tile_volume, &tile_x, &tile_y)) {
+            tile_volume.deallocateMemory();
+            return false;
+        }
+        //Rows of the volume are written bottom up. Tiles are counted from
+        //the top row, so each starts on the first row of a block of the
+        //products and its rows are written as whole blocks
+        int y_offset = fitted_data.y_idx_extent - tile_y
+            - tile_volume.y_idx_extent;
+        produce_products(tile_volume, engine, writers, tile_x, y_offset,
+                cmdLine.num_threads);
+        tile_volume.deallocateMemory();
+    }
+    return true;
 }
 
 
@@ -413,13 +728,16 @@ void LidarDriver::geo_orient_gdal(LidarVolume &fitted_data,
     //  adfGeoTransform[3] /* top left y */
     //  adfGeoTransform[4] /* 0 */
     //  adfGeoTransform[5] /* n-s pixel resolution (negative value) */
+    //The first row of the image is the last row of the volume, whose top
+    //edge is a whole number of cells above bb_y_min
     double transform[6];
     transform[0] = fitted_data.bb_x_min;
-    transform[1] = 1;
+    transform[1] = fitted_data.resolution;
     transform[2] = 0;
-    transform[3] = fitted_data.bb_y_max;
+    transform[3] = fitted_data.bb_y_min
+        + fitted_data.y_idx_extent * fitted_data.resolution;
     transform[4] = 0;
-    transform[5] = -1;  //Always -1
+    transform[5] = -fitted_data.resolution;
 
     OGRSpatialReference oSRS;
     char *pszSRS_WKT = NULL;
@@ -465,39 +783,59 @@ float LidarDriver::get_extreme_diff(std::vector<Peak*> *peaks,
 }
 
 
+namespace {
+
+//Peak filters of the statistics below, for both peaks and peak records
+inline bool is_first_peak(const Peak *peak){
+    return peak->position_in_wave == 1;
+}
+
+inline bool is_first_peak(const PeakRecord &peak){
+    return peak.flags & PEAK_RECORD_FIRST;
+}
+
+inline bool is_last_peak(const Peak *peak){
+    return peak->is_final_peak;
+}
+
+inline bool is_last_peak(const PeakRecord &peak){
+    return peak.flags & PEAK_RECORD_LAST;
+}
+
+inline float peak_value(LidarDriver &driver, Peak *peak, char peak_property){
+    return driver.get_peak_property(peak, peak_property);
+}
+
+inline float peak_value(LidarDriver &driver, const PeakRecord &peak,
+        char peak_property){
+    return driver.get_peak_property(peak, peak_property);
+}
+
 /**
- * get the extreme (max/min) value from a set of peaks, specify the property
- * and peak position (first, last, all)
- * @param peaks the set of peaks to process
- * @param max_flag flag to indicate max (true = max, false = min)
- * @param peak_pos specify if first, last, or all peaks should be included in
- * calculation (0=first, 1=last, 2=all)
- * @param peak_property the property of the peak to analyze (amplitude, width,
- * z-activation, etc..)
- * @return the extreme property value of the set of peaks with the specified 
- * filter
+ * The statistics of LidarDriver over any range of peaks, see get_extreme,
+ * get_mean, get_deviation and get_skewtosis
  */
-float LidarDriver::get_extreme(std::vector<Peak*> *peaks, bool max_flag,
-    int peak_pos, char peak_property){
+template <typename Iter>
+float extreme_of(LidarDriver &driver, Iter first, Iter last, bool max_flag,
+        int peak_pos, char peak_property){
     float max_val = NO_DATA;
     float min_val = MAX_ELEV;
     float cur_val = 0;
     bool no_countable_peaks = true;
-    if(peaks==NULL || peaks->empty()){
+    if(first == last){
         return NO_DATA;
     }
-    for (std::vector<Peak*>::iterator it = peaks->begin();
-            it != peaks->end(); ++it) {
+    for (Iter it = first; it != last; ++it) {
         //check what type of returns to evaluate
         switch (peak_pos){
             case 0: //first
-                if((*it)->position_in_wave!=1){
+                if(!is_first_peak(*it)){
                     continue;
                 }
                 no_countable_peaks = false;
                 break;
             case 1: //last
-                if(!(*it)->is_final_peak){
+                if(!is_last_peak(*it)){
                     continue;
                 }
                 no_countable_peaks = false;
@@ -509,7 +847,7 @@ float LidarDriver::get_extreme(std::vector<Peak*> *peaks, bool max_flag,
                 break;
         }
         //get current value to evaluate
-        cur_val = get_peak_property(*it,peak_property);
+        cur_val = peak_value(driver, *it, peak_property);
         //check if max or min we want
         if (max_flag) {
             if (cur_val > max_val) {
@@ -526,41 +864,28 @@ float LidarDriver::get_extreme(std::vector<Peak*> *peaks, bool max_flag,
     }else{
         return max_flag ? max_val : min_val;
     }
-
 }
 
-/**
- * get the average (mean) value from a set of peaks, specify the property
- * and peak position (first, last, all)
- * @param peaks the set of peaks to process
- * @param peak_pos specify if first, last, or all peaks should be included in
- * calculation (0=first, 1=last, 2=all)
- * @param peak_property the property of the peak to analyze (amplitude, width,
- * z-activation, etc..)
- * @return the mean property value of the set of peaks with the specified
- * filter
- */
-float LidarDriver::get_mean(std::vector<Peak*> *peaks, int peak_pos,
-                            char peak_property)
-{
+template <typename Iter>
+float mean_of(LidarDriver &driver, Iter first, Iter last, int peak_pos,
+        char peak_property){
     double val_sum  = 0;
     int val_count = 0;
     bool no_countable_peaks = true;
-    if(peaks==NULL || peaks->empty()){
+    if(first == last){
         return NO_DATA;
     }
-    for (std::vector<Peak*>::iterator it = peaks->begin();
-            it != peaks->end(); ++it) {
+    for (Iter it = first; it != last; ++it) {
         //check what type of returns to evaluate
         switch (peak_pos){
             case 0: //first
-                if((*it)->position_in_wave!=1){
+                if(!is_first_peak(*it)){
                     continue;
                 }
                 no_countable_peaks = false;
                 break;
             case 1: //last
-                if(!(*it)->is_final_peak){
+                if(!is_last_peak(*it)){
                     continue;
                 }
                 no_countable_peaks = false;
@@ -571,7 +896,7 @@ float LidarDriver::get_mean(std::vector<Peak*> *peaks, int peak_pos,
             default:
                 break;
         }
-        val_sum += get_peak_property(*it,peak_property);
+        val_sum += peak_value(driver, *it, peak_property);
         val_count ++;
     }
     if(no_countable_peaks){
@@ -579,9 +904,159 @@ float LidarDriver::get_mean(std::vector<Peak*> *peaks, int peak_pos,
     }else{
         return val_sum/val_count;
     }
+}
+
+template <typename Iter>
+double deviation_of(LidarDriver &driver, Iter first, Iter last, double avg,
+        int peak_pos, char peak_property){
+    double E=0;
+    float cur_val=0;
+    int peak_count = 0;
+    if(first == last){
+        return NO_DATA;
+    }
+    for (Iter it = first; it != last; ++it) {
+        cur_val = peak_value(driver, *it, peak_property);
+        switch(peak_pos) {
+            case 0: //first
+                if (is_first_peak(*it)) {
+                    peak_count++;
+                    E += pow(static_cast<double>(cur_val) - avg, 2);
+                }
+                break;
+            case 1: //last
+                if (is_last_peak(*it)) {
+                    peak_count++;
+                    E += pow(static_cast<double>(cur_val) - avg, 2);
+                }
+                break;
+            case 2: //all
+                peak_count++;
+                E += pow(static_cast<double>(cur_val) - avg, 2);
+        }
+    }
+    //No applicable data
+    if (peak_count == 0){
+        return NO_DATA;
+    }
+    double inverse = 1.0 / static_cast<double>(peak_count-1);
+    inverse = sqrt(inverse * E);
+    return std::isfinite(inverse) ? inverse : NO_DATA;
+}
+
+template <typename Iter>
+double skewtosis_of(LidarDriver &driver, Iter first, Iter last, double avg,
+        double dev, int peak_pos, char peak_property, int power){
+    double G=0;
+    double cur_val = 0;
+    int peak_count = 0;
+    if(first == last || dev == NO_DATA){
+        return NO_DATA;
+    }
+    //All data points were exactly the same so return normal distribution
+    if(dev == 0){
+        return 0;
+    }
+    for (Iter it = first; it != last; ++it) {
+        cur_val = peak_value(driver, *it, peak_property);
+        switch (peak_pos){
+            case 0: //first peaks
+                if (is_first_peak(*it)) {
+                    peak_count++;
+                    G += CellMoments::power_of(
+                            static_cast<double>(cur_val) - avg, power);
+                }
+                break;
+            case 1: //last peaks
+                if (is_last_peak(*it)) {
+                    peak_count++;
+                    G += CellMoments::power_of(
+                            static_cast<double>(cur_val) - avg, power);
+                }
+                break;
+            case 2: //all peaks
+                G += CellMoments::power_of(
+                        static_cast<double>(cur_val) - avg, power);
+                peak_count ++;
+                break;
+            default:
+                break;
+        }
+
+    }
+    //No applicable data
+    if (peak_count == 0){
+        return NO_DATA;
+    }
+    double inverse = 1.0 / static_cast<double>(peak_count-1);
+    inverse = (inverse * G) / CellMoments::power_of(dev, power);
+    return std::isfinite(inverse) ? inverse : NO_DATA;
+}
 
 }
 
+/**
+ * get the extreme (max/min) value from a set of peaks, specify the property
+ * and peak position (first, last, all)
+ * @param peaks the set of peaks to process
+ * @param max_flag flag to indicate max (true = max, false = min)
+ * @param peak_pos specify if first, last, or all peaks should be included in
+ * calculation (0=first, 1=last, 2=all)
+ * @param peak_property the property of the peak to analyze (amplitude, width,
+ * z-activation, etc..)
+ * @return the extreme property value of the set of peaks with the specified 
+ * filter
+ */
+float LidarDriver::get_extreme(std::vector<Peak*> *peaks, bool max_flag,
+    int peak_pos, char peak_property){
+    if(peaks==NULL){
+        return NO_DATA;
+    }
+    return extreme_of(*this, peaks->begin(), peaks->end(), max_flag, peak_pos,
+            peak_property);
+}
+
+/**
+ * get_extreme over the peak records of a cell of a finalized LidarVolume
+ * @param first the first record of the cell
+ * @param last one past the last record of the cell
+ */
+float LidarDriver::get_extreme(const PeakRecord *first, const PeakRecord *last,
+        bool max_flag, int peak_pos, char peak_property){
+    return extreme_of(*this, first, last, max_flag, peak_pos, peak_property);
+}
+
+/**
+ * get the average (mean) value from a set of peaks, specify the property
+ * and peak position (first, last, all)
+ * @param peaks the set of peaks to process
+ * @param peak_pos specify if first, last, or all peaks should be included in
+ * calculation (0=first, 1=last, 2=all)
+ * @param peak_property the property of the peak to analyze (amplitude, width,
+ * z-activation, etc..)
+ * @return the mean property value of the set of peaks with the specified
+ * filter
+ */
+float LidarDriver::get_mean(std::vector<Peak*> *peaks, int peak_pos,
+                            char peak_property)
+{
+    if(peaks==NULL){
+        return NO_DATA;
+    }
+    return mean_of(*this, peaks->begin(), peaks->end(), peak_pos,
+            peak_property);
+}
+
+/**
+ * get_mean over the peak records of a cell of a finalized LidarVolume
+ * @param first the first record of the cell
+ * @param last one past the last record of the cell
+ */
+float LidarDriver::get_mean(const PeakRecord *first, const PeakRecord *last,
+        int peak_pos, char peak_property){
+    return mean_of(*this, first, last, peak_pos, peak_property);
+}
+
 /**
  * get the property value from a peak, specify the property
  * @param peak the peak to extract data from
@@ -611,6 +1086,35 @@ float LidarDriver::get_peak_property(Peak *peak, char peak_property)
     return 0;
 }
 
+/**
+ * get the property value from a peak record
+ * @param peak the record to extract data from
+ * @param peak_property the property of the peak to analyze
+ * @return the property value of the peak
+ */
+float LidarDriver::get_peak_property(const PeakRecord &peak,
+        char peak_property)
+{
+    switch (peak_property){
+        case 0: //elevation
+            return peak.elev;
+        case 1: //amplitude
+            return peak.amp;
+        case 2: //pulse width
+            return peak.width;
+        case 3: //rise time
+            return peak.rise_time;
+        case 4: //backscatter coefficient
+            return peak.backscatter;
+        default:
+            break;
+    }
+
+    spdlog::critical("No implemented peak property for identifier {}. Result of"
+            " property request undefined (returning 0)", peak_property);
+    return 0;
+}
+
 /**
  * get the standard deviation value from a set of peaks, specify the property
  * and peak position (first, last, all)
@@ -626,40 +1130,21 @@ float LidarDriver::get_peak_property(Peak *peak, char peak_property)
 double LidarDriver::get_deviation(std::vector<Peak*> *peaks, double avg,
                                   int peak_pos, char peak_property)
 {
-    double E=0;
-    float cur_val=0;
-    int peak_count = 0;
-    if(peaks==NULL || peaks->empty()){
-        return NO_DATA;
-    }
-    for (std::vector<Peak*>::iterator it = peaks->begin();
-            it != peaks->end(); ++it) {
-        cur_val = get_peak_property(*it,peak_property);
-        switch(peak_pos) {
-            case 0: //first
-                if ((*it)->position_in_wave == 1) {
-                    peak_count++;
-                    E += pow(static_cast<double>(cur_val) - avg, 2);
-                }
-                break;
-            case 1: //last
-                if ((*it)->is_final_peak) {
-                    peak_count++;
-                    E += pow(static_cast<double>(cur_val) - avg, 2);
-                }
-                break;
-            case 2: //all
-                peak_count++;
-                E += pow(static_cast<double>(cur_val) - avg, 2);
-        }
-    }
-    //No applicable data
-    if (peak_count == 0){
+    if(peaks==NULL){
         return NO_DATA;
     }
-    double inverse = 1.0 / static_cast<double>(peak_count-1);
-    inverse = sqrt(inverse * E);
-    return std::isfinite(inverse) ? inverse : NO_DATA;
+    return deviation_of(*this, peaks->begin(), peaks->end(), avg, peak_pos,
+            peak_property);
+}
+
+/**
+ * get_deviation over the peak records of a cell of a finalized LidarVolume
+ * @param first the first record of the cell
+ * @param last one past the last record of the cell
+ */
+double LidarDriver::get_deviation(const PeakRecord *first,
+        const PeakRecord *last, double avg, int peak_pos, char peak_property){
+    return deviation_of(*this, first, last, avg, peak_pos, peak_property);
 }
 
 
@@ -682,46 +1167,21 @@ double LidarDriver::get_skewtosis(std::vector<Peak*> *peaks, double avg,
                                   double dev, int peak_pos, char peak_property,
                                   int power)
 {
-    double G=0;
-    double cur_val = 0;
-    int peak_count = 0;
-    if(peaks==NULL || peaks->empty() || dev == NO_DATA){
+    if(peaks==NULL){
         return NO_DATA;
     }
-    //All data points were exactly the same so return normal distribution
-    if(dev == 0){
-        return 0;
-    }
-    for (std::vector<Peak*>::iterator it = peaks->begin();
-            it != peaks->end(); ++it) {
-        cur_val = get_peak_property(*it,peak_property);
-        switch (peak_pos){
-            case 0: //first peaks
-                if ((*it)->position_in_wave == 1) {
-                    peak_count++;
-                    G += pow(static_cast<double>(cur_val) - avg, power);
-                }
-                break;
-            case 1: //last peaks
-                if ((*it)->is_final_peak) {
-                    peak_count++;
-                    G += pow(static_cast<double>(cur_val) - avg, power);
-                }
-                break;
-            case 2: //all peaks
-                G += pow(static_cast<double>(cur_val) - avg, power);
-                peak_count ++;
-                break;
-            default:
-                break;
-        }
+    return skewtosis_of(*this, peaks->begin(), peaks->end(), avg, dev,
+            peak_pos, peak_property, power);
+}
 
-    }
-    //No applicable data
-    if (peak_count == 0){
-        return NO_DATA;
-    }
-    double inverse = 1.0 / static_cast<double>(peak_count-1);
-    inverse = (inverse * G) / pow(dev,power);
-    return std::isfinite(inverse) ? inverse : NO_DATA;
+/**
+ * get_skewtosis over the peak records of a cell of a finalized LidarVolume
+ * @param first the first record of the cell
+ * @param last one past the last record of the cell
+ */
+double LidarDriver::get_skewtosis(const PeakRecord *first,
+        const PeakRecord *last, double avg, double dev, int peak_pos,
+        char peak_property, int power){
+    return skewtosis_of(*this, first, last, avg, dev, peak_pos, peak_property,
+            power);
 }
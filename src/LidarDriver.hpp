@@ -12,34 +12,60 @@
 #include "PulseData.hpp"
 #include "Peak.hpp"
 #include "GaussianFitter.hpp"
+#include "ProductEngine.hpp"
+#include "ProductPipeline.hpp"
+#include "PulsePipeline.hpp"
+#include "RasterWriter.hpp"
+#include "PeakStore.hpp"
 #include <iostream>
 #include <iomanip>
 #include <vector>
 #include "csv_CmdLine.hpp"
 #include "TxtWaveReader.hpp"
 
-const double NO_DATA = -99999;
-const double MAX_ELEV = 99999.99;
-
 class LidarDriver {
     private:
 	pthread_mutex_t mutex;
     public:
 	LidarDriver();
 
-        void calc_product_size(FlightLineData &data, int num_products);
+        void calc_product_size(FlightLineData &data, int num_products,
+                double resolution = 1);
 
         void fit_data(FlightLineData &raw_data, LidarVolume &fitted_data,
                 CmdLine &cmdLine);
+        void fit_data(FlightLineData &raw_data,
+                std::vector<LidarVolume*> &volumes, CmdLine &cmdLine);
+        bool load_peaks(FlightLineData &raw_data, PeakStoreReader &store,
+                std::vector<LidarVolume*> &volumes, CmdLine &cmdLine);
+
+        int fit_pulse(PulseData &pulse, WaveGPSInformation &gps_info,
+                FlightLineData &raw_data, GaussianFitter &fitter,
+                CmdLine &cmdLine, std::vector<Peak*> &peaks);
 
         void peaks_to_string(std::string &str, csv_CmdLine &cmdLine,
                              std::vector<Peak*> &peaks);
 
         void produce_product(LidarVolume &fitted_data, GDALDataset *gdal_ds,
-                int prod_calc, int prod_peaks, int prod_var);
+                int prod_calc, int prod_peaks, int prod_var,
+                int x_offset = 0, int y_offset = 0);
+
+        void produce_products(LidarVolume &fitted_data, ProductEngine &engine,
+                std::vector<RasterWriter*> &writers,
+                int x_offset = 0, int y_offset = 0, int num_threads = 1);
+
+        void setup_product_engine(ProductEngine &engine, CmdLine &cmdLine);
+
+        bool produce_tiled_products(LidarVolume &fitted_data,
+                std::vector<RasterWriter*> &writers, CmdLine &cmdLine);
 
         void setup_lidar_volume(FlightLineData &raw_data,
-                LidarVolume &lidar_volume);
+                LidarVolume &lidar_volume, size_t memory_limit = 0,
+                const std::vector<MomentGroup> *moment_groups = NULL,
+                double resolution = 1, int tile_size = VOLUME_TILE_SIZE);
+        PeakArena* setup_lidar_volumes(FlightLineData &raw_data,
+                std::vector<LidarVolume*> &volumes, CmdLine &cmdLine);
+        void finish_lidar_volumes(std::vector<LidarVolume*> &volumes);
 
         void peak_calculations(PulseData &pulse, std::vector<Peak*> &peaks,
                 GaussianFitter &fitter, CmdLine &cmdLine,
@@ -52,7 +78,13 @@ class LidarDriver {
 
         GDALDataset * setup_gdal_ds(GDALDriver *tiff_driver,
                 std::string filename, std::string band_desc,
-                int x_idx_extent, int y_idx_extent);
+                int x_idx_extent, int y_idx_extent,
+                const RasterOptions &options = RasterOptions());
+        GDALDataset * setup_gdal_ds(GDALDriver *tiff_driver,
+                std::string filename,
+                const std::vector<std::string> &band_descs,
+                int x_idx_extent, int y_idx_extent,
+                const RasterOptions &options = RasterOptions());
 
         void geo_orient_gdal(LidarVolume &fitted_data,
                 GDALDataset *gdal_ds, std::string geog_cs, int utm);
@@ -61,17 +93,27 @@ class LidarDriver {
 
         float get_extreme(std::vector<Peak*> *peaks, bool max_flag,
                 int peak_pos, char peak_property);
+        float get_extreme(const PeakRecord *first, const PeakRecord *last,
+                bool max_flag, int peak_pos, char peak_property);
 
         float get_mean(std::vector<Peak*> *peaks, int peak_pos,
                 char peak_property);
+        float get_mean(const PeakRecord *first, const PeakRecord *last,
+                int peak_pos, char peak_property);
 
         double get_deviation(std::vector<Peak*> *peaks, double avg,
                 int peak_pos, char peak_property);
+        double get_deviation(const PeakRecord *first, const PeakRecord *last,
+                double avg, int peak_pos, char peak_property);
 
         float get_peak_property(Peak *peak, char peak_property);
+        float get_peak_property(const PeakRecord &peak, char peak_property);
 
         double get_skewtosis(std::vector<Peak*> *peaks, double avg, double dev,
                 int peak_pos, char peak_property, int power);
+        double get_skewtosis(const PeakRecord *first, const PeakRecord *last,
+                double avg, double dev, int peak_pos, char peak_property,
+                int power);
 
 };
 
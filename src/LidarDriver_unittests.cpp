@@ -609,6 +609,93 @@ TEST_F(LidarDriverTest, get_kurtosis_all_test)
     }
 }
 
+/******************************************************************************
+ *
+ * The statistics over peak records, as stored by a finalized volume, should
+ * match the statistics over the peaks
+ *
+ ******************************************************************************/
+TEST_F(LidarDriverTest, peak_record_statistics_test)
+{
+    std::vector<std::vector<Peak*>*> inputs = {&typicalPeaks, &risingPeaks,
+        &fallingPeaks, &constantPeaks};
+    for (std::vector<Peak*> *peaks : inputs) {
+        std::vector<PeakRecord> records;
+        for (Peak *peak : *peaks) {
+            records.push_back(PeakTiles::make_record(*peak, 0));
+        }
+        const PeakRecord *first = records.data();
+        const PeakRecord *last = records.data() + records.size();
+        for (int pos = 0; pos < 3; pos++) {
+            for (char var : vars) {
+                EXPECT_EQ(driver1.get_extreme(peaks, true, pos, var),
+                        driver1.get_extreme(first, last, true, pos, var));
+                EXPECT_EQ(driver1.get_extreme(peaks, false, pos, var),
+                        driver1.get_extreme(first, last, false, pos, var));
+                float mean = driver1.get_mean(peaks, pos, var);
+                EXPECT_EQ(mean, driver1.get_mean(first, last, pos, var));
+                double dev = driver1.get_deviation(peaks, mean, pos, var);
+                EXPECT_EQ(dev, driver1.get_deviation(first, last, mean, pos,
+                            var));
+                EXPECT_EQ(driver1.get_skewtosis(peaks, mean, dev, pos, var, 3),
+                        driver1.get_skewtosis(first, last, mean, dev, pos, var,
+                            3));
+            }
+        }
+    }
+    EXPECT_EQ(NO_DATA, driver1.get_mean(NULL, NULL, 2, 0));
+}
+
+//Test that every product computed in one sweep matches computing it alone
+TEST_F(LidarDriverTest, product_engine_test)
+{
+    std::vector<std::vector<Peak*>*> inputs = {&typicalPeaks, &risingPeaks,
+        &fallingPeaks, &constantPeaks};
+    ProductEngine engine;
+    for (int pos = 0; pos < 3; pos++) {
+        for (char var : vars) {
+            for (int calc = 0; calc < 6; calc++) {
+                engine.add_product(calc, pos, var);
+            }
+        }
+    }
+    for (std::vector<Peak*> *peaks : inputs) {
+        //A volume of a single cell holding the peaks
+        LidarVolume volume;
+        volume.setBoundingBox(0, 0, 0, 0, 0, 1);
+        volume.allocateMemory();
+        for (Peak *peak : *peaks) {
+            Peak *copy = volume.peak_arena.allocate();
+            *copy = *peak;
+            copy->x_activation = 0;
+            copy->y_activation = 0;
+            volume.insert_peak(copy);
+        }
+        volume.finalize();
+        engine.compute_row(volume, 0);
+
+        size_t product = 0;
+        for (int pos = 0; pos < 3; pos++) {
+            for (char var : vars) {
+                float mean = driver1.get_mean(peaks, pos, var);
+                float dev = driver1.get_deviation(peaks, mean, pos, var);
+                float expected[] = {
+                    driver1.get_extreme(peaks, true, pos, var),
+                    driver1.get_extreme(peaks, false, pos, var),
+                    mean, dev,
+                    (float) driver1.get_skewtosis(peaks, mean, dev, pos, var,
+                            3),
+                    (float) driver1.get_skewtosis(peaks, mean, dev, pos, var,
+                            4)};
+                for (int calc = 0; calc < 6; calc++) {
+                    EXPECT_EQ(expected[calc], engine.row(product++)[0]);
+                }
+            }
+        }
+        volume.deallocateMemory();
+    }
+}
+
 /******************************************************************************
  *
  * Test 4 *lot of redundancies with FlightLineData_unittests in this test
@@ -737,3 +824,89 @@ TEST_F(LidarDriverTest, add_peaks_to_volume_test)
     EXPECT_EQ(peaks.at(0)->z_activation, lidarVolume.volume[5]->
             at(0)->z_activation);
 }
+
+
+/******************************************************************************
+ *
+ * Test 6
+ *
+ ******************************************************************************/
+TEST_F(LidarDriverTest, fit_data_threaded_test)
+{
+    std::string filename = "etc/140823_183115_1_clipped_test.pls";
+
+    CmdLine serialCmd;
+    FlightLineData serialFld;
+    LidarVolume serialVolume;
+    EXPECT_NO_THROW(serialFld.setFlightLineData(filename));
+    EXPECT_NO_THROW(driver1.fit_data(serialFld, serialVolume, serialCmd));
+
+    CmdLine threadedCmd;
+    threadedCmd.num_threads = 4;
+    FlightLineData threadedFld;
+    LidarVolume threadedVolume;
+    EXPECT_NO_THROW(threadedFld.setFlightLineData(filename));
+    EXPECT_NO_THROW(driver1.fit_data(threadedFld, threadedVolume,
+                threadedCmd));
+
+    // Every cell should hold the same peaks, in the same order
+    ASSERT_EQ(serialVolume.x_idx_extent, threadedVolume.x_idx_extent);
+    ASSERT_EQ(serialVolume.y_idx_extent, threadedVolume.y_idx_extent);
+    for (int y = 0; y < serialVolume.y_idx_extent; y++) {
+        for (int x = 0; x < serialVolume.x_idx_extent; x++) {
+            std::vector<Peak*> *serialCell =
+                serialVolume.volume[serialVolume.position(y, x)];
+            std::vector<Peak*> *threadedCell =
+                threadedVolume.volume[threadedVolume.position(y, x)];
+            if (serialCell == NULL) {
+                EXPECT_TRUE(threadedCell == NULL);
+                continue;
+            }
+            ASSERT_TRUE(threadedCell != NULL);
+            ASSERT_EQ(serialCell->size(), threadedCell->size());
+            for (size_t k = 0; k < serialCell->size(); k++) {
+                EXPECT_EQ(serialCell->at(k)->amp, threadedCell->at(k)->amp);
+                EXPECT_EQ(serialCell->at(k)->fwhm, threadedCell->at(k)->fwhm);
+                EXPECT_EQ(serialCell->at(k)->z_activation,
+                        threadedCell->at(k)->z_activation);
+                EXPECT_EQ(serialCell->at(k)->rise_time,
+                        threadedCell->at(k)->rise_time);
+            }
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Test 7
+ *
+ ******************************************************************************/
+//Peaks dropped while fitting, here for being outside a window, are handed
+//back to the arena, so it only holds the peaks the volume keeps
+TEST_F(LidarDriverTest, fit_data_releases_dropped_peaks_test)
+{
+    std::string filename = "etc/140823_183115_1_clipped_test.pls";
+
+    for (int threads : {1, 4}) {
+        CmdLine cmd;
+        cmd.num_threads = threads;
+        FlightLineData fld;
+        LidarVolume volume;
+        ASSERT_NO_THROW(fld.setFlightLineData(filename));
+        double x_mid = (fld.bb_x_min + fld.bb_x_max) / 2;
+        ASSERT_TRUE(fld.setWindow(fld.bb_x_min, fld.bb_y_min, x_mid,
+                    fld.bb_y_max));
+        EXPECT_NO_THROW(driver1.fit_data(fld, volume, cmd));
+
+        size_t kept = 0;
+        for (int y = 0; y < volume.y_idx_extent; y++) {
+            for (int x = 0; x < volume.x_idx_extent; x++) {
+                std::vector<Peak*> *cell = volume.volume[volume.position(y, x)];
+                kept += cell != NULL ? cell->size() : 0;
+            }
+        }
+        EXPECT_GT(kept, 0u);
+        EXPECT_EQ(kept, volume.peak_arena.size()) << threads << " threads";
+    }
+}
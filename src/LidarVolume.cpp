@@ -27,11 +27,22 @@ LidarVolume::LidarVolume(){
 
     x_idx_extent = 0;
     y_idx_extent = 0;
+    resolution = 1;
+
+    volume = NULL;
+    tiles = NULL;
+    moments = NULL;
 }
 
+/**
+ * Set the bounding box and size the volume to cover it with cells of a given
+ * size, so the memory and time taken go with the number of cells
+ * @param resolution the width and height of a cell
+ */
 void LidarVolume::setBoundingBox(double ld_xMin, double ld_xMax,
         double ld_yMin, double ld_yMax,
-        double ld_zMin, double ld_zMax){
+        double ld_zMin, double ld_zMax, double resolution){
+    this->resolution = resolution;
     max_z = ld_zMax;
     min_z = ld_zMin;
 
@@ -45,8 +56,8 @@ void LidarVolume::setBoundingBox(double ld_xMin, double ld_xMax,
     bb_x_idx_min = 0;
     bb_y_idx_min = 0;
     bb_z_idx_min = 0;
-    bb_x_idx_max = (int) (ceil(bb_x_max)) - (floor(bb_x_min));
-    bb_y_idx_max = (int) (ceil(bb_y_max)) - (floor(bb_y_min));
+    bb_x_idx_max = (int) ((ceil(bb_x_max) - floor(bb_x_min)) / resolution);
+    bb_y_idx_max = (int) ((ceil(bb_y_max) - floor(bb_y_min)) / resolution);
     bb_z_idx_max = (int) (ceil(bb_z_max)) - (floor(bb_z_min));
 
     x_idx_extent = bb_x_idx_max - bb_x_idx_min + 1;
@@ -60,8 +71,8 @@ void LidarVolume::setBoundingBox(double ld_xMin, double ld_xMax,
 void LidarVolume::allocateMemory(){
     // we are going to allocate a 2D array of space that will hold peak
     // information (we don't know how many per volume)
-    unsigned int size = x_idx_extent*y_idx_extent;  //To prevent overflow during
-                                                    //calloc
+    size_t size = (size_t)x_idx_extent*y_idx_extent;  //To prevent overflow
+                                                      //during malloc
     int x_idx,y_idx;
     volume = (std::vector<Peak*>**) malloc (sizeof(std::vector<Peak*>*)*size);
     if(volume==NULL){
@@ -76,10 +87,124 @@ void LidarVolume::allocateMemory(){
     }
 }
 
+/**
+ * Keep the peaks in tiles instead of one array of the whole bounding box, so
+ * only the tiles being filled stay in memory. Call after setBoundingBox and
+ * instead of allocateMemory. insert_peak then keeps a copy of what the
+ * products need, the peak itself is no longer needed once inserted.
+ * @param memory_limit bytes of peaks kept in memory before tiles are spilled
+ * to disk
+ * @param tile_size number of cells along each side of a tile
+ */
+void LidarVolume::enableTiling(size_t memory_limit, int tile_size){
+    delete tiles;
+    tiles = new PeakTiles(x_idx_extent, y_idx_extent, memory_limit, tile_size);
+}
+
+/**
+ * Keep only the running moments of each cell instead of its peaks. Call after
+ * setBoundingBox and instead of allocateMemory. insert_peak then folds each
+ * peak into the moments of its cell, the peak itself is no longer needed once
+ * inserted, and only the products of these moment groups can be made.
+ * @param groups the moment groups to keep, see ProductEngine::moment_groups
+ */
+void LidarVolume::enableStreaming(const std::vector<MomentGroup> &groups){
+    delete moments;
+    moments = new CellMoments((size_t)x_idx_extent * y_idx_extent, groups);
+}
+
+/**
+ * Load the peaks of one tile into a finalized volume of its own, covering just
+ * the tile
+ * @param tile the tile to load, less than tiles->tile_count()
+ * @param tile_volume volume to load into, free it with deallocateMemory
+ * @param x_idx set to the column of the tile's first cell in this volume
+ * @param y_idx set to the row of the tile's first cell in this volume
+ * @return false if the tile could not be read
+ */
+bool LidarVolume::load_tile(size_t tile, LidarVolume &tile_volume, int *x_idx,
+        int *y_idx){
+    int width, height;
+    std::vector<PeakRecord> records;
+    tiles->tile_bounds(tile, x_idx, y_idx, &width, &height);
+    if (!tiles->read_tile(tile, records)) {
+        return false;
+    }
+    tiles->release_tile(tile);
+
+    tile_volume.x_idx_extent = width;
+    tile_volume.y_idx_extent = height;
+    tile_volume.resolution = resolution;
+    //Counting sort the records by cell, keeping the order within a cell
+    int tile_size = tiles->tile_size();
+    std::vector<size_t> &offsets = tile_volume.cell_offsets;
+    offsets.assign((size_t)width * height + 1, 0);
+    for (PeakRecord &record : records) {
+        record.cell = (record.cell / tile_size) * width
+            + record.cell % tile_size;
+        offsets[record.cell + 1]++;
+    }
+    for (size_t p = 1; p < offsets.size(); p++) {
+        offsets[p] += offsets[p - 1];
+    }
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    tile_volume.cell_peaks.resize(records.size());
+    tile_volume.row_x_min.assign(height, width);
+    tile_volume.row_x_max.assign(height, -1);
+    for (const PeakRecord &record : records) {
+        tile_volume.cell_peaks[next[record.cell]++] = record;
+        tile_volume.mark_occupied(record.cell % width, record.cell / width);
+    }
+    return true;
+}
+
+/**
+ * Move the peaks of every cell into one array ordered by cell, so products
+ * can stream over them. The peak arena is freed and no more peaks can be
+ * inserted.
+ */
+void LidarVolume::finalize(){
+    size_t cells = (size_t)x_idx_extent * y_idx_extent;
+    cell_offsets.assign(cells + 1, 0);
+    cell_peaks.clear();
+    if (volume == NULL) {
+        return;
+    }
+    for (size_t p = 0; p < cells; p++) {
+        cell_offsets[p + 1] = cell_offsets[p]
+            + (volume[p] != NULL ? volume[p]->size() : 0);
+    }
+    cell_peaks.reserve(cell_offsets[cells]);
+    for (size_t p = 0; p < cells; p++) {
+        if (volume[p] == NULL) {
+            continue;
+        }
+        for (Peak *peak : *volume[p]) {
+            cell_peaks.push_back(PeakTiles::make_record(*peak, 0));
+        }
+        delete volume[p];
+    }
+    free(volume);
+    volume = NULL;
+    peak_arena = PeakArena();
+}
+
 /**
  * clean up and deallocate resources
  */
 void LidarVolume::deallocateMemory(){
+    delete tiles;
+    tiles = NULL;
+    delete moments;
+    moments = NULL;
+    peak_arena = PeakArena();
+    std::vector<PeakRecord>().swap(cell_peaks);
+    std::vector<size_t>().swap(cell_offsets);
+    std::vector<int>().swap(row_x_min);
+    std::vector<int>().swap(row_x_max);
+    if(volume == NULL){
+        return;
+    }
     int x_idx,y_idx;
     for(y_idx=0;y_idx<y_idx_extent;y_idx++){
         for(x_idx=0;x_idx<x_idx_extent;x_idx++){
@@ -94,14 +219,47 @@ void LidarVolume::deallocateMemory(){
 }
 
 
+/**
+ * Find the columns of a row that may hold peaks, every column if no peak has
+ * been inserted
+ * @param y the row
+ * @param x_min set to the first column of the row holding a peak
+ * @param x_max set to the last column of the row holding a peak
+ * @return false if no cell of the row holds a peak
+ */
+bool LidarVolume::occupied_columns(int y, int *x_min, int *x_max) const{
+    if (row_x_min.empty()) {
+        *x_min = 0;
+        *x_max = x_idx_extent - 1;
+        return x_idx_extent > 0;
+    }
+    *x_min = row_x_min[y];
+    *x_max = row_x_max[y];
+    return *x_min <= *x_max;
+}
+
+/**
+ * Widen the columns of a row holding peaks to take in a cell
+ * @param x the column of the cell
+ * @param y the row of the cell
+ */
+void LidarVolume::mark_occupied(int x, int y){
+    if (x < row_x_min[y]) {
+        row_x_min[y] = x;
+    }
+    if (x > row_x_max[y]) {
+        row_x_max[y] = x;
+    }
+}
+
 /**
  *
  * @param i most contiguous
  * @param j least contiguous
  * @return
  */
-int LidarVolume::position(int i, int j){
-    return j + (i* x_idx_extent);
+size_t LidarVolume::position(int i, int j){
+    return j + ((size_t)i * x_idx_extent);
 }
 
 /**
@@ -113,11 +271,24 @@ void LidarVolume::insert_peak(Peak* peak){
     unsigned int y_idx = gps_to_voxel_y(peak->y_activation);
 
     // make sure we are in our bounding box
-    if((long int)x_idx > x_idx_extent || (long int)y_idx > y_idx_extent){
+    if((long int)x_idx >= x_idx_extent || (long int)y_idx >= y_idx_extent){
         spdlog::error("ERROR: Invalid peak ignored");
         return;
     }
-    unsigned long int p = position(y_idx,x_idx);
+    if(row_x_min.empty()){
+        row_x_min.assign(y_idx_extent, x_idx_extent);
+        row_x_max.assign(y_idx_extent, -1);
+    }
+    mark_occupied(x_idx, y_idx);
+    if(tiles != NULL){
+        tiles->insert(x_idx, y_idx, *peak);
+        return;
+    }
+    if(moments != NULL){
+        moments->add(position(y_idx,x_idx), PeakTiles::make_record(*peak, 0));
+        return;
+    }
+    size_t p = position(y_idx,x_idx);
 
     if(volume[p] == NULL){
         volume[p] = new std::vector<Peak*>();
@@ -134,7 +305,7 @@ void LidarVolume::insert_peak(Peak* peak){
  */
 //TODO: Why ints? do we risk overflow/underflow?
 int LidarVolume::gps_to_voxel_x(double x){
-    int voxel_x = (int)(x - bb_x_min);
+    int voxel_x = (int)((x - bb_x_min) / resolution);
     return voxel_x;
 }
 
@@ -147,7 +318,7 @@ int LidarVolume::gps_to_voxel_x(double x){
  */
 //TODO: Why ints? do we risk overflow/underflow?
 int LidarVolume::gps_to_voxel_y(double y){
-    int voxel_y = (int)(y - bb_y_min);
+    int voxel_y = (int)((y - bb_y_min) / resolution);
     return voxel_y;
 }
 
@@ -5,7 +5,10 @@
 #ifndef LIDARVOLUME_HPP_
 #define LIDARVOLUME_HPP_
 #include <vector>
+#include "CellMoments.hpp"
 #include "Peak.hpp"
+#include "PeakArena.hpp"
+#include "PeakTiles.hpp"
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -44,18 +47,61 @@ class LidarVolume{
         int x_idx_extent;
         int y_idx_extent;
 
+        //Width and height of a cell, in the units of the bounding box
+        double resolution;
+
         std::vector<Peak*>** volume;
 
+        //Owns the peaks fitted into the volume, freed all at once by finalize
+        //or deallocateMemory. Peaks inserted from elsewhere stay owned by
+        //the caller.
+        PeakArena peak_arena;
+
+        //Peaks of a tiled volume, NULL unless enableTiling was called
+        PeakTiles* tiles;
+
+        //Running moments of every cell, NULL unless enableStreaming was
+        //called, in which case no peaks are kept
+        CellMoments* moments;
+
+        //Peaks of every cell in one array, ordered by cell, once finalize has
+        //been called. The peaks of cell p are cell_peaks[cell_offsets[p]] up
+        //to cell_peaks[cell_offsets[p + 1]].
+        std::vector<PeakRecord> cell_peaks;
+        std::vector<size_t> cell_offsets;
+
+        //First and last column of each row holding a peak, a row without
+        //any has its first column past its last. Empty until a peak is
+        //inserted or a tile is loaded.
+        std::vector<int> row_x_min;
+        std::vector<int> row_x_max;
+
         LidarVolume();
 
         //Read and store the mins and maxes from the header, calculate and store
         //the i, j,k values and the extents
         void setBoundingBox(double ld_xMin, double ld_xMax, double ld_yMin,
-                double ld_yMax, double ld_zMin, double ld_zMax);
+                double ld_yMax, double ld_zMin, double ld_zMax,
+                double resolution = 1);
         void insert_peak(Peak* peak);
         void allocateMemory();
         void deallocateMemory();
-        int position(int i, int j);
+        void finalize();
+        bool is_finalized() const { return !cell_offsets.empty(); }
+        const PeakRecord* peaks_begin(size_t cell) const {
+            return cell_peaks.data() + cell_offsets[cell];
+        }
+        const PeakRecord* peaks_end(size_t cell) const {
+            return cell_peaks.data() + cell_offsets[cell + 1];
+        }
+        void enableTiling(size_t memory_limit,
+                int tile_size = VOLUME_TILE_SIZE);
+        void enableStreaming(const std::vector<MomentGroup> &groups);
+        bool load_tile(size_t tile, LidarVolume &tile_volume, int *x_idx,
+                int *y_idx);
+        bool occupied_columns(int y, int *x_min, int *x_max) const;
+        void mark_occupied(int x, int y);
+        size_t position(int i, int j);
         int gps_to_voxel_x(double x);
         int gps_to_voxel_y(double y);
 
@@ -140,3 +140,157 @@ TEST_F(LidarVolumeTest, add_invalid_peak_to_volume_test){
     EXPECT_NO_THROW(lidarVolume.insert_peak(&peaks.at(0)));
 
 }
+
+
+/******************************************************************************
+ *
+ * Test that a tiled volume gives back its peaks one tile at a time
+ *
+ ******************************************************************************/
+TEST_F(LidarVolumeTest, tiled_volume_test){
+    LidarVolume lidarVolume;
+    lidarVolume.setBoundingBox(0, 9, 0, 9, 0, 1);
+    //Only room for two peaks in memory, in 4x4 tiles
+    lidarVolume.enableTiling(2 * sizeof(PeakRecord), 4);
+    ASSERT_EQ(9u, lidarVolume.tiles->tile_count());
+
+    for (int i = 0; i < 10; i++) {
+        Peak *peak = lidarVolume.peak_arena.allocate();
+        peak->x_activation = i + 0.5;
+        peak->y_activation = 9.5 - i;
+        peak->z_activation = i;
+        peak->position_in_wave = 1;
+        peak->is_final_peak = i == 9;
+        lidarVolume.insert_peak(peak);
+    }
+
+    int peak_count = 0;
+    for (size_t tile = 0; tile < lidarVolume.tiles->tile_count(); tile++) {
+        LidarVolume tile_volume;
+        int x_idx, y_idx;
+        ASSERT_TRUE(lidarVolume.load_tile(tile, tile_volume, &x_idx, &y_idx));
+        ASSERT_TRUE(tile_volume.is_finalized());
+        //Each row of a tile holds at most the one cell on the diagonal
+        for (int y = 0; y < tile_volume.y_idx_extent; y++) {
+            int x_min, x_max;
+            int diagonal = 9 - (y_idx + y) - x_idx;
+            bool occupied = diagonal >= 0 &&
+                diagonal < tile_volume.x_idx_extent;
+            ASSERT_EQ(occupied,
+                    tile_volume.occupied_columns(y, &x_min, &x_max));
+            if (occupied) {
+                EXPECT_EQ(diagonal, x_min);
+                EXPECT_EQ(diagonal, x_max);
+            }
+        }
+        for (int y = 0; y < tile_volume.y_idx_extent; y++) {
+            for (int x = 0; x < tile_volume.x_idx_extent; x++) {
+                size_t cell = tile_volume.position(y, x);
+                const PeakRecord *first = tile_volume.peaks_begin(cell);
+                const PeakRecord *last = tile_volume.peaks_end(cell);
+                if (first == last) {
+                    continue;
+                }
+                ASSERT_EQ(1, last - first);
+                //Peaks lie on the diagonal from the top left corner
+                EXPECT_EQ(x_idx + x, 9 - (y_idx + y));
+                EXPECT_EQ(x_idx + x, first->elev);
+                EXPECT_EQ(x_idx + x == 9,
+                        (first->flags & PEAK_RECORD_LAST) != 0);
+                peak_count++;
+            }
+        }
+        tile_volume.deallocateMemory();
+    }
+    EXPECT_EQ(10, peak_count);
+    lidarVolume.deallocateMemory();
+}
+
+
+/******************************************************************************
+ *
+ * Test that finalize keeps the peaks of each cell together and in order
+ *
+ ******************************************************************************/
+TEST_F(LidarVolumeTest, finalize_test){
+    LidarVolume lidarVolume;
+    lidarVolume.setBoundingBox(0, 2, 0, 1, 0, 1);
+    lidarVolume.allocateMemory();
+    ASSERT_EQ(3, lidarVolume.x_idx_extent);
+    ASSERT_EQ(2, lidarVolume.y_idx_extent);
+
+    //Three peaks in cell (1, 2) and one in (0, 0), interleaved
+    for (int i = 0; i < 4; i++) {
+        Peak *peak = lidarVolume.peak_arena.allocate();
+        peak->x_activation = i == 2 ? 0.5 : 2.5;
+        peak->y_activation = i == 2 ? 0.5 : 1.5;
+        peak->amp = i;
+        peak->position_in_wave = i + 1;
+        peak->is_final_peak = i == 3;
+        lidarVolume.insert_peak(peak);
+    }
+    int x_min, x_max;
+    ASSERT_TRUE(lidarVolume.occupied_columns(0, &x_min, &x_max));
+    EXPECT_EQ(0, x_min);
+    EXPECT_EQ(0, x_max);
+    ASSERT_TRUE(lidarVolume.occupied_columns(1, &x_min, &x_max));
+    EXPECT_EQ(2, x_min);
+    EXPECT_EQ(2, x_max);
+    lidarVolume.finalize();
+    ASSERT_TRUE(lidarVolume.is_finalized());
+    EXPECT_EQ(NULL, lidarVolume.volume);
+    ASSERT_EQ(4u, lidarVolume.cell_peaks.size());
+
+    const PeakRecord *first = lidarVolume.peaks_begin(lidarVolume.position(0, 0));
+    ASSERT_EQ(1, lidarVolume.peaks_end(lidarVolume.position(0, 0)) - first);
+    EXPECT_EQ(2, first->amp);
+
+    first = lidarVolume.peaks_begin(lidarVolume.position(1, 2));
+    ASSERT_EQ(3, lidarVolume.peaks_end(lidarVolume.position(1, 2)) - first);
+    EXPECT_EQ(0, first[0].amp);
+    EXPECT_EQ(PEAK_RECORD_FIRST, first[0].flags);
+    EXPECT_EQ(1, first[1].amp);
+    EXPECT_EQ(3, first[2].amp);
+    EXPECT_EQ(PEAK_RECORD_LAST, first[2].flags);
+
+    for (int cell : {1, 2, 3, 4}) {
+        EXPECT_EQ(lidarVolume.peaks_begin(cell), lidarVolume.peaks_end(cell));
+    }
+    lidarVolume.deallocateMemory();
+}
+
+
+/******************************************************************************
+ *
+ * Test that a coarser resolution sizes and bins the volume by cells of that
+ * size
+ *
+ ******************************************************************************/
+TEST_F(LidarVolumeTest, resolution_test){
+    LidarVolume lidarVolume;
+    lidarVolume.setBoundingBox(0.5, 20.5, 0, 9.2, 0, 1, 5);
+    EXPECT_EQ(5, lidarVolume.x_idx_extent);
+    EXPECT_EQ(3, lidarVolume.y_idx_extent);
+    EXPECT_EQ(0, lidarVolume.gps_to_voxel_x(4.9));
+    EXPECT_EQ(1, lidarVolume.gps_to_voxel_x(5.5));
+    EXPECT_EQ(4, lidarVolume.gps_to_voxel_x(20.5));
+    EXPECT_EQ(1, lidarVolume.gps_to_voxel_y(9.2));
+    lidarVolume.allocateMemory();
+
+    double corners[][2] = {{0.5, 0}, {5.4, 4.9}, {20.5, 9.2}};
+    for (auto &corner : corners) {
+        Peak *peak = lidarVolume.peak_arena.allocate();
+        peak->x_activation = corner[0];
+        peak->y_activation = corner[1];
+        peak->z_activation = 0;
+        peak->position_in_wave = 1;
+        peak->is_final_peak = true;
+        lidarVolume.insert_peak(peak);
+    }
+    lidarVolume.finalize();
+    EXPECT_EQ(2, lidarVolume.peaks_end(0) - lidarVolume.peaks_begin(0));
+    size_t corner = lidarVolume.position(1, 4);
+    EXPECT_EQ(1, lidarVolume.peaks_end(corner) -
+            lidarVolume.peaks_begin(corner));
+    lidarVolume.deallocateMemory();
+}
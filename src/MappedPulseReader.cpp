@@ -0,0 +1,370 @@
+// File name: MappedPulseReader.cpp
+// Created on: 18-October-2026
+
+#include "MappedPulseReader.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+
+//Size of the header at the start of a wvs file, a 16 byte signature, the
+//compression and 40 reserved bytes
+static const size_t WVS_HEADER_SIZE = 60;
+static const char WVS_SIGNATURE[] = "PulseWavesWaves";
+
+//Offsets of the fields of a pulse record (pulse format 0)
+static const size_t PULSE_T = 0;
+static const size_t PULSE_OFFSET_TO_WAVES = 8;
+static const size_t PULSE_ANCHOR = 16;
+static const size_t PULSE_TARGET = 28;
+static const size_t PULSE_FIRST_RETURNING_SAMPLE = 40;
+static const size_t PULSE_LAST_RETURNING_SAMPLE = 42;
+static const size_t PULSE_DESCRIPTOR = 44;
+static const size_t PULSE_INTENSITY = 46;
+static const size_t PULSE_RECORD_SIZE = 48;
+
+/**
+ * Copy a little endian value out of the mapping, which need not be aligned
+ * @param src where the value starts
+ * @return the value
+ */
+template <typename T>
+static T load(const uint8_t *src){
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+MappedFile::MappedFile(){
+    bytes = NULL;
+    length = 0;
+}
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+/**
+ * Map a whole file read only
+ * @param fileName the file to map
+ * @return false if the file could not be opened or mapped
+ */
+bool MappedFile::open(const std::string &fileName){
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //The mapping keeps the file alive, the descriptor is not needed anymore
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    bytes = static_cast<const uint8_t*>(mapping);
+    length = info.st_size;
+    return true;
+}
+
+/**
+ * Unmap the file, if one is mapped
+ */
+void MappedFile::close(){
+    if (bytes != NULL) {
+        munmap(const_cast<uint8_t*>(bytes), length);
+        bytes = NULL;
+        length = 0;
+    }
+}
+
+/**
+ * Tell the kernel the file will be read front to back, so it reads ahead
+ * aggressively and drops pages once they are behind us
+ */
+void MappedFile::advise_sequential(){
+    //Advice values are not flags, only one is given per call
+    if (bytes != NULL && madvise(const_cast<uint8_t*>(bytes), length,
+                MADV_SEQUENTIAL) != 0) {
+        spdlog::debug("madvise(MADV_SEQUENTIAL) failed: {}",
+                std::strerror(errno));
+    }
+}
+
+/**
+ * The wvs file that goes with a pls file, the same name with a wvs extension
+ * @param plsFileName path to the pls file
+ * @return path to the wvs file
+ */
+std::string MappedPulseReader::wvs_file_name(const std::string &plsFileName){
+    size_t dot = plsFileName.find_last_of('.');
+    if (dot == std::string::npos
+            || plsFileName.find_first_of('/', dot) != std::string::npos) {
+        return plsFileName + ".wvs";
+    }
+    return plsFileName.substr(0, dot) + ".wvs";
+}
+
+/**
+ * Map the pls and wvs files
+ * @param plsFileName path to the pls file
+ * @param wvsFileName path to the wvs file
+ * @param layout how the pulses are laid out, read from the pls header
+ * @return false if either file could not be mapped or is not in a format the
+ * mapped reader supports
+ */
+bool MappedPulseReader::open(const std::string &plsFileName,
+        const std::string &wvsFileName, const MappedPulseLayout &layout){
+    this->layout = layout;
+    if (layout.pulse_size < PULSE_RECORD_SIZE) {
+        spdlog::error("Pulse records of {} bytes are not supported",
+                layout.pulse_size);
+        return false;
+    }
+    for (const MappedDescriptor &descriptor : layout.descriptors) {
+        for (const MappedSampling &sampling : descriptor.samplings) {
+            if ((sampling.bits_per_sample != 8 && sampling.bits_per_sample != 16)
+                    || sampling.bits_for_duration_from_anchor % 8
+                    || sampling.bits_for_duration_from_anchor > 32
+                    || sampling.bits_for_number_of_segments % 8
+                    || sampling.bits_for_number_of_segments > 16
+                    || sampling.bits_for_number_of_samples % 8
+                    || sampling.bits_for_number_of_samples > 16) {
+                spdlog::error("Samplings with {} bits per sample are not "
+                        "supported", sampling.bits_per_sample);
+                return false;
+            }
+        }
+    }
+    if (!pls.open(plsFileName)) {
+        spdlog::error("Unable to map {}", plsFileName);
+        return false;
+    }
+    if (!wvs.open(wvsFileName)) {
+        spdlog::error("Unable to map {}", wvsFileName);
+        close();
+        return false;
+    }
+    if (wvs.size() < WVS_HEADER_SIZE
+            || std::memcmp(wvs.data(), WVS_SIGNATURE, sizeof(WVS_SIGNATURE))) {
+        spdlog::error("{} is not a wvs file", wvsFileName);
+        close();
+        return false;
+    }
+    if (load<uint32_t>(wvs.data() + 16) != 0) {
+        spdlog::error("{} is compressed", wvsFileName);
+        close();
+        return false;
+    }
+    if (layout.offset_to_pulse_data < 0 || layout.number_of_pulses < 0
+            || layout.offset_to_pulse_data + layout.number_of_pulses
+            * (int64_t)layout.pulse_size > (int64_t)pls.size()) {
+        spdlog::error("{} is shorter than its header says", plsFileName);
+        close();
+        return false;
+    }
+    pls.advise_sequential();
+    wvs.advise_sequential();
+    return true;
+}
+
+/**
+ * Unmap both files
+ */
+void MappedPulseReader::close(){
+    pls.close();
+    wvs.close();
+}
+
+/**
+ * Decode a pulse straight from the mapped files. The wave vectors of pd are
+ * overwritten, reusing the memory they already hold.
+ * @param index the pulse to read, 0 is the first pulse in the file
+ * @param pd where to put the outgoing and returning waves
+ * @param gps_info where to put the position of the pulse
+ * @return false if the pulse could not be decoded
+ */
+bool MappedPulseReader::read_pulse(int64_t index, PulseData *pd,
+        WaveGPSInformation *gps_info){
+    pd->outgoingIdx.clear();
+    pd->outgoingWave.clear();
+    pd->returningIdx.clear();
+    pd->returningWave.clear();
+
+    if (index < 0 || index >= layout.number_of_pulses) {
+        return false;
+    }
+    const uint8_t *record = pls.data() + layout.offset_to_pulse_data
+        + index * layout.pulse_size;
+
+    gps_info->gpsTime = load<int64_t>(record + PULSE_T) * layout.t_scale_factor
+        + layout.t_offset;
+
+    gps_info->x_anchor = load<int32_t>(record + PULSE_ANCHOR)
+        * layout.x_scale_factor + layout.x_offset;
+    gps_info->y_anchor = load<int32_t>(record + PULSE_ANCHOR + 4)
+        * layout.y_scale_factor + layout.y_offset;
+    gps_info->z_anchor = load<int32_t>(record + PULSE_ANCHOR + 8)
+        * layout.z_scale_factor + layout.z_offset;
+    gps_info->x_target = load<int32_t>(record + PULSE_TARGET)
+        * layout.x_scale_factor + layout.x_offset;
+    gps_info->y_target = load<int32_t>(record + PULSE_TARGET + 4)
+        * layout.y_scale_factor + layout.y_offset;
+    gps_info->z_target = load<int32_t>(record + PULSE_TARGET + 8)
+        * layout.z_scale_factor + layout.z_offset;
+    //The target is 1000 sampling units away from the anchor
+    gps_info->dx = (gps_info->x_target - gps_info->x_anchor) / 1000;
+    gps_info->dy = (gps_info->y_target - gps_info->y_anchor) / 1000;
+    gps_info->dz = (gps_info->z_target - gps_info->z_anchor) / 1000;
+
+    int16_t first = load<int16_t>(record + PULSE_FIRST_RETURNING_SAMPLE);
+    int16_t last = load<int16_t>(record + PULSE_LAST_RETURNING_SAMPLE);
+    gps_info->x_first = gps_info->x_anchor + first * gps_info->dx;
+    gps_info->y_first = gps_info->y_anchor + first * gps_info->dy;
+    gps_info->z_first = gps_info->z_anchor + first * gps_info->dz;
+    gps_info->x_last = gps_info->x_anchor + last * gps_info->dx;
+    gps_info->y_last = gps_info->y_anchor + last * gps_info->dy;
+    gps_info->z_last = gps_info->z_anchor + last * gps_info->dz;
+
+    //descriptor index : 8, reserved : 4, edge of scan line : 1,
+    //scan direction : 1, mirror facet : 2
+    uint16_t bits = load<uint16_t>(record + PULSE_DESCRIPTOR);
+    size_t descriptor_index = bits & 0xFF;
+    gps_info->edge = (bits >> 12) & 0x1;
+    gps_info->scanDirection = (bits >> 13) & 0x1;
+    gps_info->facet = (bits >> 14) & 0x3;
+    gps_info->intensity = record[PULSE_INTENSITY];
+
+    if (descriptor_index >= layout.descriptors.size()
+            || layout.descriptors[descriptor_index].samplings.empty()) {
+        spdlog::error("Pulse {} uses unknown descriptor {}", index,
+                descriptor_index);
+        return false;
+    }
+
+    int64_t offset = load<int64_t>(record + PULSE_OFFSET_TO_WAVES);
+    if (offset < (int64_t)WVS_HEADER_SIZE || offset >= (int64_t)wvs.size()) {
+        spdlog::error("Pulse {} has waves outside of the wvs file", index);
+        return false;
+    }
+    if (!read_waves(layout.descriptors[descriptor_index], offset, pd)) {
+        spdlog::error("Pulse {} has waves that run past the end of the wvs "
+                "file", index);
+        pd->outgoingIdx.clear();
+        pd->outgoingWave.clear();
+        pd->returningIdx.clear();
+        pd->returningWave.clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Decode the samplings of a pulse, the outgoing wave then the returning one
+ * @param descriptor how the samplings are stored
+ * @param offset where the pulse's waves start in the wvs file
+ * @param pd where to put the waves
+ * @return false if the waves run past the end of the file or are not
+ * an outgoing wave optionally followed by a returning one
+ */
+bool MappedPulseReader::read_waves(const MappedDescriptor &descriptor,
+        size_t offset, PulseData *pd){
+    offset += descriptor.number_of_extra_waves_bytes;
+
+    for (size_t m = 0; m < descriptor.samplings.size() && m < 2; m++) {
+        const MappedSampling &sampling = descriptor.samplings[m];
+        if (sampling.type != (m == 0 ? PULSEWAVES_OUTGOING
+                    : PULSEWAVES_RETURNING)) {
+            spdlog::critical("The first sampling must be an outgoing wave and "
+                    "the second a returning wave!");
+            return false;
+        }
+        std::vector<int> &idx = m == 0 ? pd->outgoingIdx : pd->returningIdx;
+        std::vector<int> &wave = m == 0 ? pd->outgoingWave : pd->returningWave;
+
+        uint32_t segments = sampling.number_of_segments;
+        if (!read_field(&offset, sampling.bits_for_number_of_segments,
+                    &segments)) {
+            return false;
+        }
+
+        double start_time = 0;
+        for (uint32_t j = 0; j < segments; j++) {
+            uint32_t raw_duration = 0;
+            uint32_t samples = sampling.number_of_samples;
+            if (!read_field(&offset, sampling.bits_for_duration_from_anchor,
+                        &raw_duration)
+                    || !read_field(&offset, sampling.bits_for_number_of_samples,
+                        &samples)) {
+                return false;
+            }
+            //Same float arithmetic as WAVESsampling so the indices match
+            double segment_time = (float)(sampling.offset_for_duration_from_anchor
+                + sampling.scale_for_duration_from_anchor * raw_duration);
+            if (j == 0) {
+                start_time = segment_time;
+            }
+
+            size_t bytes_per_sample = sampling.bits_per_sample / 8;
+            if (offset + samples * bytes_per_sample > wvs.size()) {
+                return false;
+            }
+            //Decode straight into the caller's vectors, no per sample calls
+            size_t first = wave.size();
+            idx.resize(first + samples);
+            wave.resize(first + samples);
+            int *idx_out = idx.data() + first;
+            int *wave_out = wave.data() + first;
+            const uint8_t *src = wvs.data() + offset;
+            for (uint32_t k = 0; k < samples; k++) {
+                idx_out[k] = segment_time - start_time;
+                segment_time++;
+            }
+            if (bytes_per_sample == 1) {
+                for (uint32_t k = 0; k < samples; k++) {
+                    wave_out[k] = src[k];
+                }
+            } else {
+                for (uint32_t k = 0; k < samples; k++) {
+                    wave_out[k] = load<uint16_t>(src + 2 * k);
+                }
+            }
+            offset += samples * bytes_per_sample;
+        }
+    }
+    return true;
+}
+
+/**
+ * Read an unsigned field stored in front of a segment
+ * @param offset where the field starts, moved past it
+ * @param bits size of the field, 0 if it is not stored
+ * @param value set to the field, left alone if it is not stored
+ * @return false if the field runs past the end of the wvs file
+ */
+bool MappedPulseReader::read_field(size_t *offset, int bits, uint32_t *value){
+    size_t bytes = bits / 8;
+    if (bytes == 0) {
+        return true;
+    }
+    if (*offset + bytes > wvs.size()) {
+        return false;
+    }
+    const uint8_t *src = wvs.data() + *offset;
+    if (bytes == 1) {
+        *value = src[0];
+    } else if (bytes == 2) {
+        *value = load<uint16_t>(src);
+    } else {
+        *value = load<uint32_t>(src);
+    }
+    *offset += bytes;
+    return true;
+}
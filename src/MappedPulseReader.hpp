@@ -0,0 +1,91 @@
+// File name: MappedPulseReader.hpp
+// Created on: 18-October-2026
+
+#ifndef MAPPEDPULSEREADER_HPP_
+#define MAPPEDPULSEREADER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PulseData.hpp"
+#include "WaveGPSInformation.hpp"
+
+//How one sampling of a pulse descriptor is stored in the wvs file
+struct MappedSampling{
+    int type = 0;   //PULSEWAVES_OUTGOING or PULSEWAVES_RETURNING
+    //Sizes in bits of the fields stored in front of each segment, 0 if the
+    //field is not stored and the fixed value below is used instead
+    int bits_for_duration_from_anchor = 0;
+    int bits_for_number_of_segments = 0;
+    int bits_for_number_of_samples = 0;
+    float scale_for_duration_from_anchor = 1;
+    float offset_for_duration_from_anchor = 0;
+    int number_of_segments = 1;
+    int number_of_samples = 0;
+    int bits_per_sample = 8;
+};
+
+//How the waves of the pulses with one descriptor index are stored
+struct MappedDescriptor{
+    int number_of_extra_waves_bytes = 0;
+    std::vector<MappedSampling> samplings;
+};
+
+//What the mapped reader needs to know from the pls header
+struct MappedPulseLayout{
+    int64_t offset_to_pulse_data = 0;
+    int64_t number_of_pulses = 0;
+    size_t pulse_size = 48;
+    double t_scale_factor = 1, t_offset = 0;
+    double x_scale_factor = 1, y_scale_factor = 1, z_scale_factor = 1;
+    double x_offset = 0, y_offset = 0, z_offset = 0;
+    //Indexed by the descriptor index stored in each pulse record
+    std::vector<MappedDescriptor> descriptors;
+};
+
+//A read only memory mapping of a whole file
+class MappedFile{
+
+    public:
+        MappedFile();
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string &fileName);
+        void close();
+        void advise_sequential();
+        const uint8_t* data() const { return bytes; }
+        size_t size() const { return length; }
+
+    private:
+        const uint8_t *bytes;
+        size_t length;
+};
+
+//Reads pulses by decoding the mapped pls and wvs files in place instead of
+//going through PULSEreader. Only uncompressed files are supported.
+class MappedPulseReader{
+
+    public:
+        bool open(const std::string &plsFileName, const std::string &wvsFileName,
+                const MappedPulseLayout &layout);
+        void close();
+        int64_t number_of_pulses() const { return layout.number_of_pulses; }
+        bool read_pulse(int64_t index, PulseData *pd,
+                WaveGPSInformation *gps_info);
+
+        static std::string wvs_file_name(const std::string &plsFileName);
+
+    private:
+        bool read_waves(const MappedDescriptor &descriptor, size_t offset,
+                PulseData *pd);
+        bool read_field(size_t *offset, int bits, uint32_t *value);
+
+        MappedPulseLayout layout;
+        MappedFile pls;
+        MappedFile wvs;
+};
+
+#endif /* MAPPEDPULSEREADER_HPP_ */
@@ -0,0 +1,153 @@
+// File name: MappedPulseReader_unittests.cpp
+// Created on: 18-October-2026
+
+#include "MappedPulseReader.hpp"
+#include "gtest/gtest.h"
+#include <cstring>
+#include <fstream>
+
+class MappedPulseReaderTest : public testing::Test {
+    protected:
+
+        virtual void SetUp(){
+            layout.offset_to_pulse_data = 16;
+            layout.number_of_pulses = 2;
+            layout.x_scale_factor = 0.5;
+            layout.x_offset = 100;
+
+            //Outgoing: one segment of 8 bit samples
+            MappedSampling outgoing;
+            outgoing.type = PULSEWAVES_OUTGOING;
+            outgoing.bits_for_duration_from_anchor = 32;
+            outgoing.bits_for_number_of_samples = 16;
+            //Returning: a stored number of segments of 16 bit samples
+            MappedSampling returning;
+            returning.type = PULSEWAVES_RETURNING;
+            returning.bits_for_duration_from_anchor = 32;
+            returning.bits_for_number_of_segments = 8;
+            returning.bits_for_number_of_samples = 16;
+            returning.bits_per_sample = 16;
+            layout.descriptors.resize(2);
+            layout.descriptors[1].samplings = {outgoing, returning};
+
+            //wvs header, then the waves of both pulses
+            std::string wvs("PulseWavesWaves", 16);
+            wvs.append(44, '\0');
+            wave_offsets[0] = wvs.size();
+            append<uint32_t>(wvs, 2);       //outgoing duration
+            append<uint16_t>(wvs, 3);       //outgoing samples
+            wvs += "\x01\x02\x03";
+            append<uint8_t>(wvs, 2);        //returning segments
+            append<uint32_t>(wvs, 50);
+            append<uint16_t>(wvs, 2);
+            append<uint16_t>(wvs, 300);
+            append<uint16_t>(wvs, 301);
+            append<uint32_t>(wvs, 60);
+            append<uint16_t>(wvs, 1);
+            append<uint16_t>(wvs, 1000);
+            wave_offsets[1] = wvs.size();
+            append<uint32_t>(wvs, 0);
+            append<uint16_t>(wvs, 1);
+            wvs += "\x07";
+            append<uint8_t>(wvs, 0);
+            write_file("do_not_use.wvs", wvs);
+
+            std::string pls(16, '\0');
+            for (int i = 0; i < 2; i++) {
+                append<int64_t>(pls, 1000 + i);             //T
+                append<int64_t>(pls, wave_offsets[i]);
+                append<int32_t>(pls, 10);                   //anchor
+                append<int32_t>(pls, 0);
+                append<int32_t>(pls, 0);
+                append<int32_t>(pls, 2010);                 //target
+                append<int32_t>(pls, 0);
+                append<int32_t>(pls, 0);
+                append<int16_t>(pls, 100);                  //first sample
+                append<int16_t>(pls, 200);                  //last sample
+                append<uint16_t>(pls, 1 | (1 << 12));       //descriptor, edge
+                append<uint8_t>(pls, 42);                   //intensity
+                append<uint8_t>(pls, 0);
+            }
+            write_file("do_not_use.pls", pls);
+        }
+
+        void TearDown(){
+            std::remove("do_not_use.pls");
+            std::remove("do_not_use.wvs");
+        }
+
+        template <typename T>
+        static void append(std::string &bytes, T value){
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        static void write_file(std::string filename, const std::string &bytes){
+            std::ofstream file(filename, std::ios::binary);
+            file.write(bytes.data(), bytes.size());
+        }
+
+        MappedPulseLayout layout;
+        size_t wave_offsets[2];
+};
+
+//Tests that both pulses are decoded, including multi segment waves
+TEST_F(MappedPulseReaderTest, readsPulses){
+    MappedPulseReader reader;
+    ASSERT_TRUE(reader.open("do_not_use.pls", "do_not_use.wvs", layout));
+    ASSERT_EQ(2, reader.number_of_pulses());
+
+    PulseData pd;
+    WaveGPSInformation gps;
+    ASSERT_TRUE(reader.read_pulse(0, &pd, &gps));
+    EXPECT_EQ(std::vector<int>({0, 1, 2}), pd.outgoingIdx);
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), pd.outgoingWave);
+    EXPECT_EQ(std::vector<int>({0, 1, 10}), pd.returningIdx);
+    EXPECT_EQ(std::vector<int>({300, 301, 1000}), pd.returningWave);
+
+    EXPECT_EQ(1000, gps.gpsTime);
+    EXPECT_EQ(105, gps.x_anchor);
+    EXPECT_EQ(1105, gps.x_target);
+    EXPECT_EQ(1, gps.dx);
+    EXPECT_EQ(205, gps.x_first);
+    EXPECT_EQ(305, gps.x_last);
+    EXPECT_EQ(1, gps.edge);
+    EXPECT_EQ(42, gps.intensity);
+
+    ASSERT_TRUE(reader.read_pulse(1, &pd, &gps));
+    EXPECT_EQ(std::vector<int>({7}), pd.outgoingWave);
+    EXPECT_TRUE(pd.returningWave.empty());
+    EXPECT_EQ(1001, gps.gpsTime);
+
+    EXPECT_FALSE(reader.read_pulse(2, &pd, &gps));
+}
+
+//Tests that waves running past the end of the wvs file are rejected
+TEST_F(MappedPulseReaderTest, truncatedWaves){
+    layout.descriptors[1].samplings[0].bits_per_sample = 16;
+    layout.descriptors[1].samplings[0].number_of_samples = 0;
+    MappedPulseReader reader;
+    ASSERT_TRUE(reader.open("do_not_use.pls", "do_not_use.wvs", layout));
+
+    //Pulse 1 is the last thing in the file, with 16 bit samples it is a
+    //byte short
+    PulseData pd;
+    WaveGPSInformation gps;
+    EXPECT_FALSE(reader.read_pulse(1, &pd, &gps));
+    EXPECT_TRUE(pd.outgoingWave.empty());
+}
+
+//Tests that files shorter than the header says are not opened
+TEST_F(MappedPulseReaderTest, invalidFiles){
+    MappedPulseReader reader;
+    layout.number_of_pulses = 3;
+    EXPECT_FALSE(reader.open("do_not_use.pls", "do_not_use.wvs", layout));
+    layout.number_of_pulses = 2;
+    EXPECT_FALSE(reader.open("do_not_use.pls", "no_such_file.wvs", layout));
+    EXPECT_FALSE(reader.open("do_not_use.wvs", "do_not_use.pls", layout));
+}
+
+//Tests that the wvs file is found next to the pls file
+TEST_F(MappedPulseReaderTest, wvsFileName){
+    EXPECT_EQ("../etc/test.wvs", MappedPulseReader::wvs_file_name("../etc/test.pls"));
+    EXPECT_EQ("./dir.d/test.wvs", MappedPulseReader::wvs_file_name("./dir.d/test"));
+}
@@ -0,0 +1,141 @@
+// File name: OverviewBuilder.cpp
+// Created on: 18-October-2026
+
+#include "OverviewBuilder.hpp"
+#include <algorithm>
+#include <cmath>
+#include "CellMoments.hpp"
+
+/**
+ * @param width the number of columns of the product
+ * @param height the number of rows of the product
+ * @param level_count the number of overviews, each half the size of the one
+ * before it
+ */
+OverviewBuilder::OverviewBuilder(int width, int height, int level_count){
+    Level level;
+    level.width = width;
+    level.height = height;
+    levels.push_back(level);
+    for (int i = 0; i < level_count; i++) {
+        level.width = (level.width + 1) / 2;
+        level.height = (level.height + 1) / 2;
+        levels.push_back(level);
+    }
+}
+
+/**
+ * Add rows of the product to its overviews
+ * @param first_row the row of the product of the first row
+ * @param rows the number of rows
+ * @param x_offset the column of the product of the first value of each row
+ * @param width the number of values of each row
+ * @param values the rows, width values apart
+ */
+void OverviewBuilder::add_rows(int first_row, int rows, int x_offset,
+        int width, const float *values){
+    if (levels.size() < 2) {
+        return;
+    }
+    std::vector<double> sums(width);
+    std::vector<uint32_t> counts(width);
+    for (int row = 0; row < rows; row++) {
+        const float *row_values = values + (size_t)row * width;
+        for (int x = 0; x < width; x++) {
+            bool has_data = row_values[x] != (float) NO_DATA &&
+                std::isfinite(row_values[x]);
+            sums[x] = has_data ? row_values[x] : 0;
+            counts[x] = has_data ? 1 : 0;
+        }
+        add(1, first_row + row, x_offset, width, sums.data(), counts.data());
+    }
+}
+
+/**
+ * Finish every row still waiting on pixels, as if the pixels not added had no
+ * data
+ */
+void OverviewBuilder::finish(){
+    //Finishing a row adds it to the level above, so go up a level at a time
+    for (size_t level = 1; level < levels.size(); level++) {
+        std::map<int, PendingRow> &pending = levels[level].pending;
+        while (!pending.empty()) {
+            finish_row(level, pending.begin()->first, pending.begin()->second);
+            pending.erase(pending.begin());
+        }
+    }
+}
+
+/**
+ * @param width the number of columns of a product
+ * @param height the number of rows of a product
+ * @param tile_size the size of the tiles of the product
+ * @return the number of overviews halving the product until it fits in a
+ * single tile
+ */
+int OverviewBuilder::count_levels(int width, int height, int tile_size){
+    int level_count = 0;
+    while (width > tile_size || height > tile_size) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        level_count++;
+    }
+    return level_count;
+}
+
+/**
+ * Add part of a row of the level below to a level
+ * @param level the level being added to
+ * @param child_row the row of the level below
+ * @param x_offset the column of the level below of the first pixel
+ * @param width the number of pixels
+ * @param sums the sum of the product under each pixel
+ * @param counts the number of pixels of the product with data under each
+ * pixel
+ */
+void OverviewBuilder::add(int level, int child_row, int x_offset, int width,
+        const double *sums, const uint32_t *counts){
+    Level &child = levels[level - 1];
+    int row = child_row / 2;
+    PendingRow &pending = levels[level].pending[row];
+    if (pending.sums.empty()) {
+        pending.sums.assign(levels[level].width, 0);
+        pending.counts.assign(levels[level].width, 0);
+        pending.added = 0;
+    }
+    for (int x = 0; x < width; x++) {
+        pending.sums[(x_offset + x) / 2] += sums[x];
+        pending.counts[(x_offset + x) / 2] += counts[x];
+    }
+    pending.added += width;
+
+    //The last row of an odd sized level is the only one under its row above
+    size_t child_rows = std::min(2, child.height - 2 * row);
+    if (pending.added >= child_rows * child.width) {
+        finish_row(level, row, pending);
+        levels[level].pending.erase(row);
+    }
+}
+
+/**
+ * Store a row of a level whose pixels have all been added and add it to the
+ * level above
+ * @param level the level of the row
+ * @param row the row of the level
+ * @param pending the sums and counts of the row
+ */
+void OverviewBuilder::finish_row(int level, int row, PendingRow &pending){
+    OverviewRow finished;
+    finished.level = level;
+    finished.row = row;
+    finished.values.resize(pending.sums.size());
+    for (size_t x = 0; x < pending.sums.size(); x++) {
+        finished.values[x] = pending.counts[x] == 0 ? NO_DATA :
+            pending.sums[x] / pending.counts[x];
+    }
+    done.push_back(finished);
+    if (level + 1 < (int)levels.size()) {
+        add(level + 1, row, 0, pending.sums.size(), pending.sums.data(),
+                pending.counts.data());
+    }
+}
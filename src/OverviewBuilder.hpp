@@ -0,0 +1,67 @@
+// File name: OverviewBuilder.hpp
+// Created on: 18-October-2026
+
+#ifndef OVERVIEWBUILDER_HPP_
+#define OVERVIEWBUILDER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+//A finished row of an overview, level 1 being half the size of the product
+struct OverviewRow{
+    int level;
+    int row;
+    std::vector<float> values;
+};
+
+/**
+ * Builds the overviews of a product from its rows as they are produced, so
+ * no pass is made over the written product to create them. Each pixel of a
+ * level is the mean of the pixels of the product it covers that have data,
+ * or NO_DATA if none of them do, the same as averaging the 2x2 pixels of the
+ * level below weighted by how many pixels of the product each one holds.
+ * Only the rows of each level still waiting on pixels are kept in memory.
+ * Rows may be added in any order and in windows of any width; a row of a
+ * level is finished once every pixel under it has been added.
+ */
+class OverviewBuilder{
+
+    public:
+        OverviewBuilder(int width, int height, int level_count);
+
+        void add_rows(int first_row, int rows, int x_offset, int width,
+                const float *values);
+        void finish();
+        std::vector<OverviewRow>& finished_rows(){ return done; }
+        int level_count() const { return (int)levels.size() - 1; }
+        int level_width(int level) const { return levels[level].width; }
+        int level_height(int level) const { return levels[level].height; }
+
+        static int count_levels(int width, int height, int tile_size);
+
+    private:
+        //The sums and counts of the pixels of the product under each pixel
+        //of a row, and how many pixels of the level below have been added
+        struct PendingRow{
+            std::vector<double> sums;
+            std::vector<uint32_t> counts;
+            size_t added;
+        };
+        struct Level{
+            int width;
+            int height;
+            std::map<int, PendingRow> pending;
+        };
+
+        //levels[0] is the product itself, only its size is used
+        std::vector<Level> levels;
+        std::vector<OverviewRow> done;
+
+        void add(int level, int child_row, int x_offset, int width,
+                const double *sums, const uint32_t *counts);
+        void finish_row(int level, int row, PendingRow &pending);
+};
+
+#endif /* OVERVIEWBUILDER_HPP_ */
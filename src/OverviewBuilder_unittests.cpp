@@ -0,0 +1,73 @@
+// File name: OverviewBuilder_unittests.cpp
+// Created on: 18-October-2026
+
+#include "OverviewBuilder.hpp"
+#include "CellMoments.hpp"
+#include "gtest/gtest.h"
+
+//Tests the number of overviews of a product
+TEST(OverviewBuilderTest, countLevels){
+    EXPECT_EQ(0, OverviewBuilder::count_levels(256, 100, 256));
+    EXPECT_EQ(1, OverviewBuilder::count_levels(257, 100, 256));
+    EXPECT_EQ(3, OverviewBuilder::count_levels(100, 2000, 256));
+
+    OverviewBuilder builder(5, 3, 2);
+    EXPECT_EQ(2, builder.level_count());
+    EXPECT_EQ(3, builder.level_width(1));
+    EXPECT_EQ(2, builder.level_height(1));
+    EXPECT_EQ(2, builder.level_width(2));
+    EXPECT_EQ(1, builder.level_height(2));
+}
+
+//Tests that each row of an overview is finished once the rows under it are
+//added
+TEST(OverviewBuilderTest, meanOfPixels){
+    OverviewBuilder builder(4, 4, 2);
+    float rows[4][4] = {{1, 3, 5, 7},
+                        {1, 3, 5, 7},
+                        {2, 2, NO_DATA, 8},
+                        {2, 2, NO_DATA, NO_DATA}};
+    builder.add_rows(0, 1, 0, 4, rows[0]);
+    EXPECT_TRUE(builder.finished_rows().empty());
+    builder.add_rows(1, 1, 0, 4, rows[1]);
+    ASSERT_EQ(1u, builder.finished_rows().size());
+    OverviewRow &first = builder.finished_rows()[0];
+    EXPECT_EQ(1, first.level);
+    EXPECT_EQ(0, first.row);
+    ASSERT_EQ(2u, first.values.size());
+    EXPECT_EQ(2, first.values[0]);
+    EXPECT_EQ(6, first.values[1]);
+
+    builder.finished_rows().clear();
+    builder.add_rows(2, 2, 0, 4, rows[2]);
+    ASSERT_EQ(2u, builder.finished_rows().size());
+    EXPECT_EQ(2, builder.finished_rows()[0].values[0]);
+    EXPECT_EQ(8, builder.finished_rows()[0].values[1]);
+    //The top level is the mean of every pixel with data, not of the level
+    //below
+    EXPECT_EQ(2, builder.finished_rows()[1].level);
+    EXPECT_FLOAT_EQ(48 / 13.0, builder.finished_rows()[1].values[0]);
+}
+
+//Tests rows added out of order, in windows, to a product of odd size
+TEST(OverviewBuilderTest, windowsAndOddSize){
+    OverviewBuilder builder(3, 3, 1);
+    float left[] = {4, 4};
+    float right[] = {NO_DATA};
+    builder.add_rows(2, 1, 0, 2, left);
+    builder.add_rows(2, 1, 2, 1, right);
+    ASSERT_EQ(1u, builder.finished_rows().size());
+    EXPECT_EQ(1, builder.finished_rows()[0].row);
+    EXPECT_EQ(4, builder.finished_rows()[0].values[0]);
+    EXPECT_EQ(NO_DATA, builder.finished_rows()[0].values[1]);
+
+    //Rows never added are left without data
+    builder.finished_rows().clear();
+    float top[] = {1, 2, 3};
+    builder.add_rows(0, 1, 0, 3, top);
+    EXPECT_TRUE(builder.finished_rows().empty());
+    builder.finish();
+    ASSERT_EQ(1u, builder.finished_rows().size());
+    EXPECT_EQ(1.5, builder.finished_rows()[0].values[0]);
+    EXPECT_EQ(3, builder.finished_rows()[0].values[1]);
+}
@@ -0,0 +1,122 @@
+// File name: PeakArena.cpp
+// Created on: 18-October-2026
+
+#include "PeakArena.hpp"
+
+PeakArena::PeakArena(){
+    next = PEAK_ARENA_BLOCK_SIZE;
+    live = 0;
+}
+
+PeakArena::PeakArena(PeakArena &&other){
+    next = PEAK_ARENA_BLOCK_SIZE;
+    live = 0;
+    *this = std::move(other);
+}
+
+PeakArena& PeakArena::operator=(PeakArena &&other){
+    if (this != &other) {
+        blocks = std::move(other.blocks);
+        released = std::move(other.released);
+        next = other.next;
+        live = other.live;
+        other.blocks.clear();
+        other.released.clear();
+        other.next = PEAK_ARENA_BLOCK_SIZE;
+        other.live = 0;
+    }
+    return *this;
+}
+
+PeakArena::PeakArena(const PeakArena &){
+    next = PEAK_ARENA_BLOCK_SIZE;
+    live = 0;
+}
+
+PeakArena& PeakArena::operator=(const PeakArena &other){
+    if (this != &other) {
+        blocks.clear();
+        released.clear();
+        next = PEAK_ARENA_BLOCK_SIZE;
+        live = 0;
+    }
+    return *this;
+}
+
+/**
+ * @return a default constructed peak owned by this arena
+ */
+Peak* PeakArena::allocate(){
+    Peak *peak;
+    if (!released.empty()) {
+        peak = released.back();
+        released.pop_back();
+    } else {
+        if (next == PEAK_ARENA_BLOCK_SIZE) {
+            blocks.emplace_back(new Peak[PEAK_ARENA_BLOCK_SIZE]);
+            next = 0;
+        }
+        peak = &blocks.back()[next++];
+    }
+    *peak = Peak();
+    live++;
+    return peak;
+}
+
+/**
+ * Hand back a peak that is no longer needed, so the next allocation reuses it
+ * @param peak a peak allocated by this arena
+ */
+void PeakArena::release(Peak *peak){
+    released.push_back(peak);
+    live--;
+}
+
+/**
+ * Take ownership of every peak of another arena, which is left empty. The
+ * peaks keep their addresses.
+ * @param other the arena to take the peaks of
+ */
+void PeakArena::adopt(PeakArena &other){
+    if (&other == this || other.blocks.empty()) {
+        return;
+    }
+    if (blocks.empty()) {
+        *this = std::move(other);
+        return;
+    }
+    //Only one partly used block can be allocated from, keep allocating from
+    //whichever of the two has more room left. The peaks not handed out of
+    //the other one are lost until this arena is cleared.
+    std::unique_ptr<Peak[]> current = std::move(blocks.back());
+    blocks.pop_back();
+    blocks.insert(blocks.end(),
+            std::make_move_iterator(other.blocks.begin()),
+            std::make_move_iterator(other.blocks.end()));
+    if (other.next < next) {
+        blocks.insert(blocks.end() - 1, std::move(current));
+        next = other.next;
+    } else {
+        blocks.push_back(std::move(current));
+    }
+    released.insert(released.end(), other.released.begin(),
+            other.released.end());
+    live += other.live;
+    other.blocks.clear();
+    other.released.clear();
+    other.next = PEAK_ARENA_BLOCK_SIZE;
+    other.live = 0;
+}
+
+/**
+ * Free every peak of the arena at once. The first block is kept for reuse, so
+ * an arena cleared after every pulse never goes back to the allocator.
+ */
+void PeakArena::clear(){
+    if (blocks.size() > 1) {
+        blocks.erase(blocks.begin() + 1, blocks.end());
+    }
+    released.clear();
+    next = blocks.empty() ? PEAK_ARENA_BLOCK_SIZE : 0;
+    live = 0;
+}
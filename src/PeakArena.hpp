@@ -0,0 +1,49 @@
+// File name: PeakArena.hpp
+// Created on: 18-October-2026
+
+#ifndef PEAKARENA_HPP_
+#define PEAKARENA_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "Peak.hpp"
+
+// Number of peaks allocated at a time by an arena
+#define PEAK_ARENA_BLOCK_SIZE 1024
+
+/**
+ * Owns peaks allocated in blocks, so a peak costs a pointer bump instead of a
+ * call to new and every peak is freed at once when the arena is cleared or
+ * destroyed. Peaks from an arena must never be deleted. An arena is not
+ * thread safe, each thread allocates from its own and hands finished arenas
+ * to their new owner with adopt.
+ */
+class PeakArena{
+
+    public:
+        PeakArena();
+        PeakArena(PeakArena &&other);
+        PeakArena& operator=(PeakArena &&other);
+        //Copies start out empty, peaks are never shared between arenas
+        PeakArena(const PeakArena &other);
+        PeakArena& operator=(const PeakArena &other);
+
+        Peak* allocate();
+        void release(Peak *peak);
+        void adopt(PeakArena &other);
+        void clear();
+
+        size_t size() const { return live; }
+        size_t capacity() const { return blocks.size() * PEAK_ARENA_BLOCK_SIZE; }
+
+    private:
+        std::vector<std::unique_ptr<Peak[]>> blocks;
+        //Peaks handed back with release, reused before the current block
+        std::vector<Peak*> released;
+        //Next unused peak of the last block
+        size_t next;
+        size_t live;
+};
+
+#endif /* PEAKARENA_HPP_ */
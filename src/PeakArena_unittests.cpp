@@ -0,0 +1,91 @@
+// File name: PeakArena_unittests.cpp
+// Created on: 18-October-2026
+
+#include "PeakArena.hpp"
+#include "gtest/gtest.h"
+#include <set>
+
+//Tests that peaks are default constructed and released peaks are reused
+TEST(PeakArenaTest, allocateAndRelease){
+    PeakArena arena;
+    Peak *first = arena.allocate();
+    first->amp = 10;
+    Peak *second = arena.allocate();
+    EXPECT_NE(first, second);
+    EXPECT_EQ(2u, arena.size());
+
+    arena.release(first);
+    EXPECT_EQ(1u, arena.size());
+    Peak *reused = arena.allocate();
+    EXPECT_EQ(first, reused);
+    EXPECT_EQ(0, reused->amp);
+    EXPECT_EQ(-1, reused->rise_time);
+}
+
+//Tests that peaks spanning several blocks stay put and clearing keeps a block
+TEST(PeakArenaTest, blocksAndClear){
+    PeakArena arena;
+    std::set<Peak*> peaks;
+    for (int i = 0; i < 3 * PEAK_ARENA_BLOCK_SIZE; i++) {
+        Peak *peak = arena.allocate();
+        peak->location = i;
+        peaks.insert(peak);
+    }
+    EXPECT_EQ(3u * PEAK_ARENA_BLOCK_SIZE, peaks.size());
+    EXPECT_EQ(3u * PEAK_ARENA_BLOCK_SIZE, arena.capacity());
+
+    arena.clear();
+    EXPECT_EQ(0u, arena.size());
+    EXPECT_EQ((size_t)PEAK_ARENA_BLOCK_SIZE, arena.capacity());
+    EXPECT_EQ(1u, peaks.count(arena.allocate()));
+}
+
+//Tests that adopted peaks keep their addresses and values
+TEST(PeakArenaTest, adopt){
+    PeakArena owner;
+    Peak *own = owner.allocate();
+    own->amp = 1;
+
+    PeakArena worker;
+    std::vector<Peak*> found;
+    for (int i = 0; i < PEAK_ARENA_BLOCK_SIZE + 5; i++) {
+        found.push_back(worker.allocate());
+        found.back()->amp = i;
+    }
+    owner.adopt(worker);
+    EXPECT_EQ(0u, worker.size());
+    EXPECT_EQ(0u, worker.capacity());
+    EXPECT_EQ(PEAK_ARENA_BLOCK_SIZE + 6u, owner.size());
+    for (int i = 0; i < PEAK_ARENA_BLOCK_SIZE + 5; i++) {
+        EXPECT_EQ(i, found[i]->amp);
+    }
+
+    //The owner carries on from its own block
+    Peak *next = owner.allocate();
+    EXPECT_EQ(own + 1, next);
+
+    //Copies and moved from arenas are empty
+    PeakArena copy(owner);
+    EXPECT_EQ(0u, copy.size());
+    PeakArena moved(std::move(owner));
+    EXPECT_EQ(0u, owner.size());
+    EXPECT_EQ(PEAK_ARENA_BLOCK_SIZE + 7u, moved.size());
+    EXPECT_EQ(1, own->amp);
+}
+
+//Tests that adopting keeps allocating from the block with the most room
+TEST(PeakArenaTest, adoptKeepsEmptierBlock){
+    PeakArena owner;
+    for (int i = 0; i < PEAK_ARENA_BLOCK_SIZE - 1; i++) {
+        owner.allocate();
+    }
+
+    PeakArena worker;
+    Peak *found = worker.allocate();
+    owner.adopt(worker);
+    EXPECT_EQ(2 * PEAK_ARENA_BLOCK_SIZE + 0u, owner.capacity());
+
+    //The worker's block had more room, the owner carries on from it
+    EXPECT_EQ(found + 1, owner.allocate());
+    EXPECT_EQ(PEAK_ARENA_BLOCK_SIZE + 1u, owner.size());
+}
@@ -0,0 +1,580 @@
+// File name: PeakStore.cpp
+// Created on: 18-October-2026
+
+#include "PeakStore.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "spdlog/spdlog.h"
+
+namespace {
+
+//Starts and ends every store
+const char STORE_MAGIC[8] = {'L', 'I', 'D', 'P', 'E', 'A', 'K', 'S'};
+
+//Flags of the header
+const uint32_t STORE_GAUSSIAN = 1;
+const uint32_t STORE_BACKSCATTER = 2;
+
+//Bytes taken by a value of each column
+const size_t COLUMN_BYTES[PEAK_COLUMN_COUNT] = {
+    8, 8, 8, 8, 8, 8,   //coordinates
+    8, 8, 8,            //amp, location, fwhm
+    4, 4,               //rise_time, backscatter
+    4, 4,               //triggering amp and location
+    2, 1                //position in wave and final peak
+};
+
+//Bytes of an entry of the index, a PeakStoreChunk
+const uint64_t INDEX_ENTRY_BYTES = 4 + 4 + 8 + 8;
+
+//Bytes of the chunk count, index offset and magic ending a store
+const int64_t TRAILER_BYTES = 8 + 8 + sizeof(STORE_MAGIC);
+
+template <typename T>
+void put(char *out, T value){
+    std::memcpy(out, &value, sizeof(T));
+}
+
+template <typename T>
+T get(const char *in){
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    return value;
+}
+
+/**
+ * @param column the column to write
+ * @param peak the peak to take the value from
+ * @param out where the COLUMN_BYTES[column] bytes of the value are written
+ */
+void encode(int column, const Peak &peak, char *out){
+    switch (column) {
+        case PEAK_COLUMN_X_ACTIVATION: put<double>(out, peak.x_activation);
+                                       break;
+        case PEAK_COLUMN_Y_ACTIVATION: put<double>(out, peak.y_activation);
+                                       break;
+        case PEAK_COLUMN_Z_ACTIVATION: put<double>(out, peak.z_activation);
+                                       break;
+        case PEAK_COLUMN_X: put<double>(out, peak.x); break;
+        case PEAK_COLUMN_Y: put<double>(out, peak.y); break;
+        case PEAK_COLUMN_Z: put<double>(out, peak.z); break;
+        case PEAK_COLUMN_AMP: put<double>(out, peak.amp); break;
+        case PEAK_COLUMN_LOCATION: put<double>(out, peak.location); break;
+        case PEAK_COLUMN_FWHM: put<double>(out, peak.fwhm); break;
+        case PEAK_COLUMN_RISE_TIME: put<float>(out, peak.rise_time); break;
+        case PEAK_COLUMN_BACKSCATTER:
+            put<float>(out, peak.backscatter_coefficient);
+            break;
+        case PEAK_COLUMN_TRIGGERING_AMP:
+            put<int32_t>(out, peak.triggering_amp);
+            break;
+        case PEAK_COLUMN_TRIGGERING_LOCATION:
+            put<int32_t>(out, peak.triggering_location);
+            break;
+        case PEAK_COLUMN_POSITION:
+            put<uint16_t>(out, std::min(std::max(peak.position_in_wave, 0),
+                        0xffff));
+            break;
+        case PEAK_COLUMN_FINAL: put<uint8_t>(out, peak.is_final_peak); break;
+    }
+}
+
+/**
+ * @param column the column read
+ * @param in the COLUMN_BYTES[column] bytes of the value
+ * @param peak the peak to set the value of
+ */
+void decode(int column, const char *in, Peak &peak){
+    switch (column) {
+        case PEAK_COLUMN_X_ACTIVATION: peak.x_activation = get<double>(in);
+                                       break;
+        case PEAK_COLUMN_Y_ACTIVATION: peak.y_activation = get<double>(in);
+                                       break;
+        case PEAK_COLUMN_Z_ACTIVATION: peak.z_activation = get<double>(in);
+                                       break;
+        case PEAK_COLUMN_X: peak.x = get<double>(in); break;
+        case PEAK_COLUMN_Y: peak.y = get<double>(in); break;
+        case PEAK_COLUMN_Z: peak.z = get<double>(in); break;
+        case PEAK_COLUMN_AMP: peak.amp = get<double>(in); break;
+        case PEAK_COLUMN_LOCATION: peak.location = get<double>(in); break;
+        case PEAK_COLUMN_FWHM: peak.fwhm = get<double>(in); break;
+        case PEAK_COLUMN_RISE_TIME: peak.rise_time = get<float>(in); break;
+        case PEAK_COLUMN_BACKSCATTER:
+            peak.backscatter_coefficient = get<float>(in);
+            break;
+        case PEAK_COLUMN_TRIGGERING_AMP:
+            peak.triggering_amp = get<int32_t>(in);
+            break;
+        case PEAK_COLUMN_TRIGGERING_LOCATION:
+            peak.triggering_location = get<int32_t>(in);
+            break;
+        case PEAK_COLUMN_POSITION:
+            peak.position_in_wave = get<uint16_t>(in);
+            break;
+        case PEAK_COLUMN_FINAL: peak.is_final_peak = get<uint8_t>(in) != 0;
+                                break;
+    }
+}
+
+/**
+ * @param value a coordinate
+ * @param origin the coordinate the squares are counted from
+ * @param tile_size the width of a square
+ * @return the square the coordinate is in
+ */
+int32_t tile_of(double value, double origin, double tile_size){
+    double tile = std::floor((value - origin) / tile_size);
+    return (int32_t)std::min(std::max(tile, -2147483648.0), 2147483647.0);
+}
+
+}
+
+/****************************************************************************
+ *
+ * PeakStoreWriter
+ *
+ ****************************************************************************/
+
+/**
+ * @param memory_limit bytes of peaks buffered before the tiles least
+ * recently added to are written out
+ */
+PeakStoreWriter::PeakStoreWriter(size_t memory_limit){
+    file = NULL;
+    this->memory_limit = std::max<size_t>(memory_limit, 1);
+    buffered_bytes = 0;
+    buffered_peaks = 0;
+    peaks_written = 0;
+    appends = 0;
+    file_size = 0;
+    failed = false;
+}
+
+PeakStoreWriter::~PeakStoreWriter(){
+    if (file != NULL) {
+        close();
+    }
+}
+
+/**
+ * Create a store and write its header
+ * @param filename the file to write, replaced if it exists
+ * @param info the flight line the peaks are fitted from
+ * @return false if the file could not be written
+ */
+bool PeakStoreWriter::open(const std::string &filename,
+        const PeakStoreInfo &info){
+    this->filename = filename;
+    this->info = info;
+    failed = false;
+    buffered_bytes = 0;
+    buffered_peaks = 0;
+    peaks_written = 0;
+    file_size = 0;
+    if (!(this->info.tile_size > 0)) {
+        this->info.tile_size = PEAK_STORE_TILE_SIZE;
+    }
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL) {
+        spdlog::error("Unable to create peak store {}", filename);
+        return false;
+    }
+    uint32_t version = PEAK_STORE_VERSION;
+    uint32_t column_count = PEAK_COLUMN_COUNT;
+    uint32_t flags = (info.gaussian ? STORE_GAUSSIAN : 0)
+        | (info.backscatter ? STORE_BACKSCATTER : 0);
+    int32_t utm = info.utm;
+    double bounds[] = {info.bb_x_min, info.bb_x_max, info.bb_y_min,
+        info.bb_y_max, info.bb_z_min, info.bb_z_max, this->info.tile_size};
+    uint32_t geog_cs_length = info.geog_cs.size();
+    if (!write(STORE_MAGIC, sizeof(STORE_MAGIC))
+            || !write(&version, sizeof(version))
+            || !write(&column_count, sizeof(column_count))
+            || !write(&flags, sizeof(flags))
+            || !write(&utm, sizeof(utm))
+            || !write(bounds, sizeof(bounds))
+            || !write(&geog_cs_length, sizeof(geog_cs_length))
+            || !write(info.geog_cs.data(), geog_cs_length)) {
+        spdlog::error("Unable to write to peak store {}", filename);
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Add the peaks of a pulse to the tiles their activation points are in. The
+ * peaks are not kept, so the caller is free to delete them afterwards.
+ * @param peaks the peaks to add
+ * @param peak_count the number of peaks of the vector to add
+ */
+void PeakStoreWriter::append(const std::vector<Peak*> &peaks,
+        size_t peak_count){
+    if (file == NULL || failed) {
+        return;
+    }
+    appends++;
+    for (size_t i = 0; i < peak_count && i < peaks.size(); i++) {
+        const Peak &peak = *peaks[i];
+        Tile &tile = tiles[std::make_pair(
+                tile_of(peak.y_activation, info.bb_y_min, info.tile_size),
+                tile_of(peak.x_activation, info.bb_x_min, info.tile_size))];
+        for (int c = 0; c < PEAK_COLUMN_COUNT; c++) {
+            std::vector<char> &column = tile.columns[c];
+            column.resize(column.size() + COLUMN_BYTES[c]);
+            encode(c, peak, &column[column.size() - COLUMN_BYTES[c]]);
+            buffered_bytes += COLUMN_BYTES[c];
+        }
+        tile.count++;
+        tile.last_used = appends;
+        buffered_peaks++;
+    }
+    if (buffered_bytes > memory_limit) {
+        flush_least_recent();
+    }
+}
+
+/**
+ * Write out every tile still buffered and the index of the chunks, then close
+ * the file
+ * @return false if any part of the store could not be written, it is left
+ * without an index so it will not be opened
+ */
+bool PeakStoreWriter::close(){
+    if (file == NULL) {
+        return false;
+    }
+    for (TileMap::iterator tile = tiles.begin(); tile != tiles.end()
+            && !failed; ) {
+        if (!flush(tile++)) {
+            failed = true;
+        }
+    }
+    int64_t index_offset = file_size;
+    uint64_t chunk_count = chunks.size();
+    if (!failed) {
+        for (const PeakStoreChunk &chunk : chunks) {
+            if (!write(&chunk.tile_x, sizeof(chunk.tile_x))
+                    || !write(&chunk.tile_y, sizeof(chunk.tile_y))
+                    || !write(&chunk.offset, sizeof(chunk.offset))
+                    || !write(&chunk.count, sizeof(chunk.count))) {
+                failed = true;
+                break;
+            }
+        }
+    }
+    failed = failed || !write(&chunk_count, sizeof(chunk_count))
+        || !write(&index_offset, sizeof(index_offset))
+        || !write(STORE_MAGIC, sizeof(STORE_MAGIC));
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+    file = NULL;
+    tiles.clear();
+    chunks.clear();
+    buffered_bytes = 0;
+    if (failed) {
+        spdlog::error("Unable to write to peak store {}", filename);
+        return false;
+    }
+    spdlog::info("Wrote {} peaks to {}", peaks_written, filename);
+    return true;
+}
+
+/**
+ * @param data the bytes to append to the file
+ * @param bytes the number of bytes
+ * @return false if they could not be written
+ */
+bool PeakStoreWriter::write(const void *data, size_t bytes){
+    if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes) {
+        return false;
+    }
+    file_size += bytes;
+    return true;
+}
+
+/**
+ * Write a tile's buffered peaks as a chunk, one column after the other, and
+ * drop the tile
+ * @param tile the tile to write
+ * @return false if the chunk could not be written
+ */
+bool PeakStoreWriter::flush(TileMap::iterator tile){
+    Tile &t = tile->second;
+    PeakStoreChunk chunk;
+    chunk.tile_y = tile->first.first;
+    chunk.tile_x = tile->first.second;
+    chunk.offset = file_size;
+    chunk.count = t.count;
+    for (int c = 0; c < PEAK_COLUMN_COUNT; c++) {
+        if (!write(t.columns[c].data(), t.columns[c].size())) {
+            return false;
+        }
+        buffered_bytes -= t.columns[c].size();
+    }
+    chunks.push_back(chunk);
+    buffered_peaks -= t.count;
+    peaks_written += t.count;
+    tiles.erase(tile);
+    return true;
+}
+
+/**
+ * Write out the tiles added to least recently until half of the memory limit
+ * is used, so chunks are written in large batches
+ */
+void PeakStoreWriter::flush_least_recent(){
+    std::vector<TileMap::iterator> buffered;
+    for (TileMap::iterator tile = tiles.begin(); tile != tiles.end(); ++tile) {
+        buffered.push_back(tile);
+    }
+    std::sort(buffered.begin(), buffered.end(),
+            [](TileMap::iterator a, TileMap::iterator b) {
+                return a->second.last_used < b->second.last_used;
+            });
+    for (TileMap::iterator tile : buffered) {
+        if (buffered_bytes <= memory_limit / 2) {
+            break;
+        }
+        if (!flush(tile)) {
+            spdlog::error("Unable to write to peak store {}, no more peaks "
+                    "will be added to it", filename);
+            failed = true;
+            tiles.clear();
+            buffered_bytes = 0;
+            buffered_peaks = 0;
+            return;
+        }
+    }
+    spdlog::debug("Wrote peaks to {}, {} MB in total", filename,
+            file_size / (1024 * 1024));
+}
+
+/****************************************************************************
+ *
+ * PeakStoreReader
+ *
+ ****************************************************************************/
+
+PeakStoreReader::PeakStoreReader(){
+    file = NULL;
+    origin_x = 0;
+    origin_y = 0;
+    total_peaks = 0;
+    use_window = false;
+    window_x_min = window_y_min = window_x_max = window_y_max = 0;
+}
+
+PeakStoreReader::~PeakStoreReader(){
+    close();
+}
+
+/**
+ * Open a store and read its header and index
+ * @param filename the store to read
+ * @return false if the file is not a complete store of this version
+ */
+bool PeakStoreReader::open(const std::string &filename){
+    close();
+    this->filename = filename;
+    file = fopen(filename.c_str(), "rb");
+    if (file == NULL) {
+        spdlog::error("Unable to open peak store {}", filename);
+        return false;
+    }
+
+    char magic[sizeof(STORE_MAGIC)];
+    uint32_t version, column_count, flags, geog_cs_length;
+    int32_t utm;
+    double bounds[7];
+    bool valid = fread(magic, sizeof(magic), 1, file) == 1
+        && std::memcmp(magic, STORE_MAGIC, sizeof(magic)) == 0
+        && fread(&version, sizeof(version), 1, file) == 1
+        && fread(&column_count, sizeof(column_count), 1, file) == 1
+        && version == PEAK_STORE_VERSION && column_count == PEAK_COLUMN_COUNT
+        && fread(&flags, sizeof(flags), 1, file) == 1
+        && fread(&utm, sizeof(utm), 1, file) == 1
+        && fread(bounds, sizeof(bounds), 1, file) == 1
+        && fread(&geog_cs_length, sizeof(geog_cs_length), 1, file) == 1
+        && geog_cs_length < (1u << 20);
+    if (valid) {
+        store_info.geog_cs.resize(geog_cs_length);
+        valid = geog_cs_length == 0 || fread(&store_info.geog_cs[0],
+                geog_cs_length, 1, file) == 1;
+    }
+    int64_t header_bytes = valid ? ftello(file) : 0;
+
+    //The index is found from the end of the file
+    uint64_t chunk_count = 0;
+    int64_t index_offset = 0;
+    int64_t file_size = 0;
+    valid = valid && fseeko(file, 0, SEEK_END) == 0
+        && (file_size = ftello(file)) >= header_bytes + TRAILER_BYTES
+        && fseeko(file, file_size - TRAILER_BYTES, SEEK_SET) == 0
+        && fread(&chunk_count, sizeof(chunk_count), 1, file) == 1
+        && fread(&index_offset, sizeof(index_offset), 1, file) == 1
+        && fread(magic, sizeof(magic), 1, file) == 1
+        && std::memcmp(magic, STORE_MAGIC, sizeof(magic)) == 0
+        && index_offset >= header_bytes
+        && (uint64_t)(file_size - TRAILER_BYTES - index_offset)
+            == chunk_count * INDEX_ENTRY_BYTES
+        && fseeko(file, index_offset, SEEK_SET) == 0;
+    size_t peak_bytes = 0;
+    for (size_t c = 0; c < PEAK_COLUMN_COUNT; c++) {
+        peak_bytes += COLUMN_BYTES[c];
+    }
+    for (uint64_t i = 0; valid && i < chunk_count; i++) {
+        PeakStoreChunk chunk;
+        valid = fread(&chunk.tile_x, sizeof(chunk.tile_x), 1, file) == 1
+            && fread(&chunk.tile_y, sizeof(chunk.tile_y), 1, file) == 1
+            && fread(&chunk.offset, sizeof(chunk.offset), 1, file) == 1
+            && fread(&chunk.count, sizeof(chunk.count), 1, file) == 1
+            && chunk.offset >= header_bytes
+            && chunk.count <= (uint64_t)(index_offset - chunk.offset)
+                / peak_bytes;
+        chunks.push_back(chunk);
+        total_peaks += chunk.count;
+    }
+    if (!valid) {
+        spdlog::error("{} is not a complete peak store of version {}",
+                filename, PEAK_STORE_VERSION);
+        close();
+        return false;
+    }
+
+    store_info.gaussian = (flags & STORE_GAUSSIAN) != 0;
+    store_info.backscatter = (flags & STORE_BACKSCATTER) != 0;
+    store_info.utm = utm;
+    store_info.bb_x_min = bounds[0];
+    store_info.bb_x_max = bounds[1];
+    store_info.bb_y_min = bounds[2];
+    store_info.bb_y_max = bounds[3];
+    store_info.bb_z_min = bounds[4];
+    store_info.bb_z_max = bounds[5];
+    store_info.tile_size = bounds[6] > 0 ? bounds[6] : PEAK_STORE_TILE_SIZE;
+    origin_x = store_info.bb_x_min;
+    origin_y = store_info.bb_y_min;
+    spdlog::info("Peak store {} holds {} peaks in {} chunks", filename,
+            total_peaks, chunks.size());
+    return true;
+}
+
+/**
+ * Close the store, forgetting its index and any window
+ */
+void PeakStoreReader::close(){
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+    store_info = PeakStoreInfo();
+    chunks.clear();
+    total_peaks = 0;
+    use_window = false;
+}
+
+/**
+ * Only read the peaks whose activation point is inside a window, shrinking
+ * the bounding box of the store to it
+ * @param x_min the west edge of the window
+ * @param y_min the south edge of the window
+ * @param x_max the east edge of the window
+ * @param y_max the north edge of the window
+ * @return false if the window is outside the store
+ */
+bool PeakStoreReader::setWindow(double x_min, double y_min, double x_max,
+        double y_max){
+    if (x_min > store_info.bb_x_max || x_max < store_info.bb_x_min
+            || y_min > store_info.bb_y_max || y_max < store_info.bb_y_min) {
+        spdlog::error("Window {},{} - {},{} is outside of the peak store",
+                x_min, y_min, x_max, y_max);
+        return false;
+    }
+    use_window = true;
+    window_x_min = x_min;
+    window_y_min = y_min;
+    window_x_max = x_max;
+    window_y_max = y_max;
+    store_info.bb_x_min = std::max(store_info.bb_x_min, x_min);
+    store_info.bb_y_min = std::max(store_info.bb_y_min, y_min);
+    store_info.bb_x_max = std::min(store_info.bb_x_max, x_max);
+    store_info.bb_y_max = std::min(store_info.bb_y_max, y_max);
+    return true;
+}
+
+/**
+ * Read the peaks of a chunk, in the order they were added. Chunks outside
+ * the window are skipped without being read.
+ * @param chunk the chunk to read, less than chunk_count()
+ * @param arena the arena the peaks are allocated from
+ * @param peaks filled with the peaks read
+ * @param columns bit 1 << c is set for every PeakColumn c to read, the others
+ * are left as a new Peak has them
+ * @return false if the chunk could not be read
+ */
+bool PeakStoreReader::read_chunk(size_t chunk, PeakArena &arena,
+        std::vector<Peak*> &peaks, uint32_t columns){
+    peaks.clear();
+    const PeakStoreChunk &c = chunks[chunk];
+    if (use_window) {
+        if (!chunk_in_window(c)) {
+            return true;
+        }
+        columns |= (1u << PEAK_COLUMN_X_ACTIVATION)
+            | (1u << PEAK_COLUMN_Y_ACTIVATION);
+    }
+    peaks.reserve(c.count);
+    for (uint64_t i = 0; i < c.count; i++) {
+        peaks.push_back(arena.allocate());
+    }
+    int64_t offset = c.offset;
+    for (int col = 0; col < PEAK_COLUMN_COUNT; col++) {
+        size_t bytes = c.count * COLUMN_BYTES[col];
+        if (columns & (1u << col)) {
+            column.resize(bytes);
+            if (fseeko(file, offset, SEEK_SET) != 0
+                    || fread(column.data(), 1, bytes, file) != bytes) {
+                spdlog::error("Unable to read chunk {} of {}", chunk,
+                        filename);
+                for (Peak *peak : peaks) {
+                    arena.release(peak);
+                }
+                peaks.clear();
+                return false;
+            }
+            for (uint64_t i = 0; i < c.count; i++) {
+                decode(col, &column[i * COLUMN_BYTES[col]], *peaks[i]);
+            }
+        }
+        offset += bytes;
+    }
+    if (use_window) {
+        size_t kept = 0;
+        for (Peak *peak : peaks) {
+            if (peak->x_activation >= window_x_min
+                    && peak->x_activation <= window_x_max
+                    && peak->y_activation >= window_y_min
+                    && peak->y_activation <= window_y_max) {
+                peaks[kept++] = peak;
+            } else {
+                arena.release(peak);
+            }
+        }
+        peaks.resize(kept);
+    }
+    return true;
+}
+
+/**
+ * @param chunk a chunk of the store
+ * @return true if the square of the chunk overlaps the window
+ */
+bool PeakStoreReader::chunk_in_window(const PeakStoreChunk &chunk) const{
+    double x = origin_x + chunk.tile_x * store_info.tile_size;
+    double y = origin_y + chunk.tile_y * store_info.tile_size;
+    return x <= window_x_max && x + store_info.tile_size >= window_x_min
+        && y <= window_y_max && y + store_info.tile_size >= window_y_min;
+}
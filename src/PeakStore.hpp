@@ -0,0 +1,177 @@
+// File name: PeakStore.hpp
+// Created on: 18-October-2026
+
+#ifndef PEAKSTORE_HPP_
+#define PEAKSTORE_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Peak.hpp"
+#include "PeakArena.hpp"
+
+// Extension of a peak store, accepted as input in place of a .pls file
+#define PEAK_STORE_EXTENSION ".peaks"
+
+// Version of the file layout, bumped whenever the columns change
+#define PEAK_STORE_VERSION 2
+
+// Width and height of the square of a flight line kept in a chunk, in the
+// units of the flight line
+#define PEAK_STORE_TILE_SIZE 256.0
+
+// Default number of bytes of peaks buffered before tiles are written out
+#define PEAK_STORE_BUFFER_SIZE (64 * 1024 * 1024)
+
+//The properties of a peak kept in a store, each as a column of its own
+enum PeakColumn{
+    PEAK_COLUMN_X_ACTIVATION,       //double
+    PEAK_COLUMN_Y_ACTIVATION,       //double
+    PEAK_COLUMN_Z_ACTIVATION,       //double
+    PEAK_COLUMN_X,                  //double
+    PEAK_COLUMN_Y,                  //double
+    PEAK_COLUMN_Z,                  //double
+    PEAK_COLUMN_AMP,                //double
+    PEAK_COLUMN_LOCATION,           //double
+    PEAK_COLUMN_FWHM,               //double
+    PEAK_COLUMN_RISE_TIME,          //float
+    PEAK_COLUMN_BACKSCATTER,        //float
+    PEAK_COLUMN_TRIGGERING_AMP,     //int32
+    PEAK_COLUMN_TRIGGERING_LOCATION,//int32
+    PEAK_COLUMN_POSITION,           //uint16, position_in_wave
+    PEAK_COLUMN_FINAL,              //uint8, is_final_peak
+    PEAK_COLUMN_COUNT
+};
+
+// Masks of the columns to read back
+#define PEAK_STORE_ALL_COLUMNS ((1u << PEAK_COLUMN_COUNT) - 1)
+#define PEAK_STORE_PRODUCT_COLUMNS ((1u << PEAK_COLUMN_X_ACTIVATION) \
+        | (1u << PEAK_COLUMN_Y_ACTIVATION) | (1u << PEAK_COLUMN_Z_ACTIVATION) \
+        | (1u << PEAK_COLUMN_AMP) | (1u << PEAK_COLUMN_FWHM) \
+        | (1u << PEAK_COLUMN_RISE_TIME) | (1u << PEAK_COLUMN_BACKSCATTER) \
+        | (1u << PEAK_COLUMN_POSITION) | (1u << PEAK_COLUMN_FINAL))
+
+//What a store knows about the flight line its peaks were fitted from
+struct PeakStoreInfo{
+    double bb_x_min = 0;
+    double bb_x_max = 0;
+    double bb_y_min = 0;
+    double bb_y_max = 0;
+    double bb_z_min = 0;
+    double bb_z_max = 0;
+    int utm = 0;
+    std::string geog_cs;
+    bool gaussian = true;       //Fitted with gaussian fitting, otherwise
+                                //first differencing
+    bool backscatter = false;   //Backscatter coefficients were calculated
+    double tile_size = PEAK_STORE_TILE_SIZE;
+};
+
+//Where the peaks of a square of the flight line are in a store, the entries
+//of the index at the end of the file
+struct PeakStoreChunk{
+    int32_t tile_x;     //Column of the square, counted from bb_x_min
+    int32_t tile_y;     //Row of the square, counted from bb_y_min
+    int64_t offset;     //Offset of the first column of the chunk
+    uint64_t count;     //Number of peaks in the chunk
+};
+
+/**
+ * Writes fitted peaks to a peak store, so products can be made again
+ * without fitting the waveforms. Peaks are gathered by the square of the
+ * flight line their activation point is in and each square is written as a
+ * chunk holding every column of its peaks one after the other, followed by
+ * an index of the chunks at the end of the file. Once more than the memory
+ * limit is buffered, the squares least recently added to are written out
+ * early, so a square may have more than one chunk.
+ *
+ * Values are written in the byte order of the machine. The properties
+ * csv-driver writes are kept as doubles, so csv made from a store matches csv
+ * made by fitting. The rise time and backscatter coefficient are only made
+ * into products, and are kept as floats, the same as products are computed
+ * from.
+ */
+class PeakStoreWriter{
+
+    public:
+        PeakStoreWriter(size_t memory_limit = PEAK_STORE_BUFFER_SIZE);
+        ~PeakStoreWriter();
+        PeakStoreWriter(const PeakStoreWriter&) = delete;
+        PeakStoreWriter& operator=(const PeakStoreWriter&) = delete;
+
+        bool open(const std::string &filename, const PeakStoreInfo &info);
+        void append(const std::vector<Peak*> &peaks, size_t peak_count);
+        bool close();
+        bool is_open() const { return file != NULL; }
+        uint64_t peak_count() const { return peaks_written + buffered_peaks; }
+
+    private:
+        struct Tile{
+            std::vector<char> columns[PEAK_COLUMN_COUNT];
+            uint64_t count = 0;
+            uint64_t last_used = 0;
+        };
+        //Tiles by row, then column
+        typedef std::map<std::pair<int32_t, int32_t>, Tile> TileMap;
+
+        bool write(const void *data, size_t bytes);
+        bool flush(TileMap::iterator tile);
+        void flush_least_recent();
+
+        std::string filename;
+        FILE *file;
+        PeakStoreInfo info;
+        size_t memory_limit;
+        size_t buffered_bytes;
+        uint64_t buffered_peaks;
+        uint64_t peaks_written;
+        uint64_t appends;
+        int64_t file_size;
+        bool failed;
+        TileMap tiles;
+        std::vector<PeakStoreChunk> chunks;
+};
+
+/**
+ * Reads back the peaks of a store written by PeakStoreWriter a chunk at a
+ * time, reading only the columns asked for.
+ */
+class PeakStoreReader{
+
+    public:
+        PeakStoreReader();
+        ~PeakStoreReader();
+        PeakStoreReader(const PeakStoreReader&) = delete;
+        PeakStoreReader& operator=(const PeakStoreReader&) = delete;
+
+        bool open(const std::string &filename);
+        void close();
+        bool setWindow(double x_min, double y_min, double x_max, double y_max);
+        const PeakStoreInfo& info() const { return store_info; }
+        size_t chunk_count() const { return chunks.size(); }
+        uint64_t peak_count() const { return total_peaks; }
+        bool read_chunk(size_t chunk, PeakArena &arena,
+                std::vector<Peak*> &peaks,
+                uint32_t columns = PEAK_STORE_ALL_COLUMNS);
+
+    private:
+        bool chunk_in_window(const PeakStoreChunk &chunk) const;
+
+        std::string filename;
+        FILE *file;
+        PeakStoreInfo store_info;
+        //Corner the squares are counted from, bb_x_min and bb_y_min before
+        //any window is set
+        double origin_x, origin_y;
+        std::vector<PeakStoreChunk> chunks;
+        uint64_t total_peaks;
+        std::vector<char> column;
+        //Area of interest set by setWindow
+        bool use_window;
+        double window_x_min, window_y_min, window_x_max, window_y_max;
+};
+
+#endif /* PEAKSTORE_HPP_ */
@@ -0,0 +1,211 @@
+// File name: PeakStore_unittests.cpp
+// Created on: 18-October-2026
+
+#include "PeakStore.hpp"
+#include <cstdio>
+#include <unistd.h>
+#include "gtest/gtest.h"
+
+class PeakStoreTest : public testing::Test {
+    protected:
+        const char *filename = "peak_store_test.peaks";
+        PeakArena arena;
+        PeakStoreInfo info;
+
+        void SetUp(){
+            info.bb_x_min = 1000;
+            info.bb_x_max = 1100;
+            info.bb_y_min = 2000;
+            info.bb_y_max = 2050;
+            info.bb_z_min = 5;
+            info.bb_z_max = 60;
+            info.utm = 11;
+            info.geog_cs = "NAD83";
+            info.gaussian = false;
+            info.backscatter = true;
+            info.tile_size = 20;
+        }
+
+        void TearDown(){
+            std::remove(filename);
+        }
+
+        //Peak i of a 20 x 10 grid of points 5 units apart
+        Peak* make_peak(int i){
+            Peak *peak = arena.allocate();
+            peak->x_activation = 1000.25 + (i % 20) * 5;
+            peak->y_activation = 2000.5 + (i / 20 % 10) * 5;
+            peak->z_activation = 10 + i / 8.0;
+            peak->x = peak->x_activation + 1;
+            peak->y = peak->y_activation + 2;
+            peak->z = peak->z_activation + 3;
+            peak->amp = 100 + i;
+            peak->location = i / 4.0;
+            peak->fwhm = 3 + i % 7;
+            peak->rise_time = 1.5;
+            peak->backscatter_coefficient = 0.25 * i;
+            peak->triggering_amp = i % 50;
+            peak->triggering_location = 2 * i;
+            peak->position_in_wave = i % 3 + 1;
+            peak->is_final_peak = i % 3 == 2;
+            return peak;
+        }
+
+        //Writes count peaks, a pulse of three at a time
+        void write_store(int count, size_t memory_limit){
+            PeakStoreWriter writer(memory_limit);
+            ASSERT_TRUE(writer.open(filename, info));
+            std::vector<Peak*> pulse;
+            for (int i = 0; i < count; i++) {
+                pulse.push_back(make_peak(i));
+                if (pulse.size() == 3 || i == count - 1) {
+                    writer.append(pulse, pulse.size());
+                    pulse.clear();
+                }
+            }
+            EXPECT_EQ((uint64_t)count, writer.peak_count());
+            ASSERT_TRUE(writer.close());
+            arena.clear();
+        }
+
+        //Every peak of a store, in the order they are read
+        std::vector<Peak> read_store(PeakStoreReader &reader,
+                uint32_t columns = PEAK_STORE_ALL_COLUMNS){
+            std::vector<Peak> read;
+            std::vector<Peak*> peaks;
+            for (size_t c = 0; c < reader.chunk_count(); c++) {
+                EXPECT_TRUE(reader.read_chunk(c, arena, peaks, columns));
+                for (Peak *peak : peaks) {
+                    read.push_back(*peak);
+                }
+                arena.clear();
+            }
+            return read;
+        }
+};
+
+//Tests that the flight line and every column of every peak are read back
+TEST_F(PeakStoreTest, roundTrip){
+    write_store(200, PEAK_STORE_BUFFER_SIZE);
+
+    PeakStoreReader reader;
+    ASSERT_TRUE(reader.open(filename));
+    EXPECT_EQ(1000, reader.info().bb_x_min);
+    EXPECT_EQ(2050, reader.info().bb_y_max);
+    EXPECT_EQ(60, reader.info().bb_z_max);
+    EXPECT_EQ(11, reader.info().utm);
+    EXPECT_EQ("NAD83", reader.info().geog_cs);
+    EXPECT_FALSE(reader.info().gaussian);
+    EXPECT_TRUE(reader.info().backscatter);
+    EXPECT_EQ(200u, reader.peak_count());
+    //One chunk for each 20 x 20 square
+    EXPECT_EQ(15u, reader.chunk_count());
+
+    std::vector<Peak> read = read_store(reader);
+    ASSERT_EQ(200u, read.size());
+    std::vector<bool> seen(200, false);
+    for (const Peak &peak : read) {
+        int i = peak.triggering_location / 2;
+        ASSERT_FALSE(seen[i]);
+        seen[i] = true;
+        Peak *expected = make_peak(i);
+        EXPECT_EQ(expected->x_activation, peak.x_activation);
+        EXPECT_EQ(expected->y_activation, peak.y_activation);
+        EXPECT_EQ(expected->z_activation, peak.z_activation);
+        EXPECT_EQ(expected->x, peak.x);
+        EXPECT_EQ(expected->y, peak.y);
+        EXPECT_EQ(expected->z, peak.z);
+        EXPECT_EQ(expected->amp, peak.amp);
+        EXPECT_EQ(expected->location, peak.location);
+        EXPECT_EQ(expected->fwhm, peak.fwhm);
+        EXPECT_EQ((float)expected->rise_time, peak.rise_time);
+        EXPECT_EQ((float)expected->backscatter_coefficient,
+                peak.backscatter_coefficient);
+        EXPECT_EQ(expected->triggering_amp, peak.triggering_amp);
+        EXPECT_EQ(expected->position_in_wave, peak.position_in_wave);
+        EXPECT_EQ(expected->is_final_peak, peak.is_final_peak);
+    }
+}
+
+//Tests that squares written early keep their peaks in the order added
+TEST_F(PeakStoreTest, smallBuffer){
+    //Room for about ten peaks at a time
+    write_store(600, 10 * 80);
+
+    PeakStoreReader reader;
+    ASSERT_TRUE(reader.open(filename));
+    EXPECT_EQ(600u, reader.peak_count());
+    EXPECT_GT(reader.chunk_count(), 15u);
+
+    std::vector<Peak> read = read_store(reader);
+    ASSERT_EQ(600u, read.size());
+    //Peaks of the same point come back in the order they were added
+    std::vector<int> last(200, -1);
+    for (const Peak &peak : read) {
+        int i = peak.triggering_location / 2;
+        EXPECT_GT(i, last[i % 200]);
+        last[i % 200] = i;
+    }
+}
+
+//Tests reading only some columns, and only the peaks inside a window
+TEST_F(PeakStoreTest, columnsAndWindow){
+    write_store(200, PEAK_STORE_BUFFER_SIZE);
+
+    PeakStoreReader reader;
+    ASSERT_TRUE(reader.open(filename));
+    std::vector<Peak> read = read_store(reader, PEAK_STORE_PRODUCT_COLUMNS);
+    ASSERT_EQ(200u, read.size());
+    for (const Peak &peak : read) {
+        EXPECT_EQ(0, peak.triggering_location);
+        EXPECT_EQ(0, peak.x);
+        EXPECT_GT(peak.amp, 0);
+    }
+
+    EXPECT_FALSE(reader.setWindow(0, 0, 10, 10));
+    ASSERT_TRUE(reader.setWindow(1010, 2010, 1030, 2020));
+    EXPECT_EQ(1010, reader.info().bb_x_min);
+    EXPECT_EQ(2020, reader.info().bb_y_max);
+    read = read_store(reader, 1u << PEAK_COLUMN_AMP);
+    //Columns 2 to 5 of rows 2 to 3
+    ASSERT_EQ(8u, read.size());
+    for (const Peak &peak : read) {
+        EXPECT_GE(peak.x_activation, 1010);
+        EXPECT_LE(peak.x_activation, 1030);
+        EXPECT_GE(peak.y_activation, 2010);
+        EXPECT_LE(peak.y_activation, 2020);
+        EXPECT_GT(peak.amp, 0);
+    }
+}
+
+//Tests that a file cut short, or not a store at all, is not opened
+TEST_F(PeakStoreTest, incompleteStore){
+    PeakStoreReader reader;
+    EXPECT_FALSE(reader.open(filename));
+
+    {
+        PeakStoreWriter writer;
+        ASSERT_TRUE(writer.open(filename, info));
+        std::vector<Peak*> pulse(1, make_peak(0));
+        writer.append(pulse, 1);
+        //Closed, with its index, when the writer is destroyed
+    }
+    EXPECT_TRUE(reader.open(filename));
+
+    //Missing the end of its index
+    FILE *file = fopen(filename, "rb");
+    ASSERT_TRUE(file != NULL);
+    ASSERT_EQ(0, fseek(file, 0, SEEK_END));
+    long size = ftell(file);
+    fclose(file);
+    ASSERT_EQ(0, truncate(filename, size - 1));
+    EXPECT_FALSE(reader.open(filename));
+
+    file = fopen(filename, "r+b");
+    ASSERT_TRUE(file != NULL);
+    ASSERT_EQ(0, fseek(file, 0, SEEK_SET));
+    fputc('X', file);
+    fclose(file);
+    EXPECT_FALSE(reader.open(filename));
+    EXPECT_EQ(0u, reader.chunk_count());
+}
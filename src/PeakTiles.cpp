@@ -0,0 +1,218 @@
+// File name: PeakTiles.cpp
+// Created on: 18-October-2026
+
+#include "PeakTiles.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+
+/**
+ * @param x_extent number of cells across the volume
+ * @param y_extent number of cells down the volume
+ * @param memory_limit bytes of records kept in memory before tiles are spilled
+ * @param tile_size number of cells along each side of a tile
+ */
+PeakTiles::PeakTiles(int x_extent, int y_extent, size_t memory_limit,
+        int tile_size){
+    this->x_extent = x_extent;
+    this->y_extent = y_extent;
+    tile_cells = tile_size;
+    tiles_across = (x_extent + tile_size - 1) / tile_size;
+    int tiles_down = (y_extent + tile_size - 1) / tile_size;
+    tiles.resize((size_t)tiles_across * tiles_down);
+    max_resident_records = std::max<size_t>(memory_limit / sizeof(PeakRecord),
+            1);
+    resident_records = 0;
+    inserts = 0;
+    spill_file = NULL;
+    spill_size = 0;
+    spill_failed = false;
+}
+
+PeakTiles::~PeakTiles(){
+    if (spill_file != NULL) {
+        fclose(spill_file);
+    }
+}
+
+/**
+ * Copy what the products need from a peak
+ * @param peak the peak to copy
+ * @param cell the cell of the record
+ * @return the record of the peak
+ */
+PeakRecord PeakTiles::make_record(const Peak &peak, uint32_t cell){
+    PeakRecord record;
+    record.elev = peak.z_activation;
+    record.amp = peak.amp;
+    record.width = peak.fwhm;
+    record.rise_time = peak.rise_time;
+    record.backscatter = peak.backscatter_coefficient;
+    record.cell = cell;
+    record.flags = (peak.position_in_wave == 1 ? PEAK_RECORD_FIRST : 0)
+        | (peak.is_final_peak ? PEAK_RECORD_LAST : 0);
+    return record;
+}
+
+/**
+ * Add a peak to the tile its cell is in
+ * @param x_idx column of the peak's cell in the volume
+ * @param y_idx row of the peak's cell in the volume
+ * @param peak the peak to add, not kept
+ */
+void PeakTiles::insert(int x_idx, int y_idx, const Peak &peak){
+    int tile_row = (y_extent - 1 - y_idx) / tile_cells;
+    int tile_y = std::max(y_extent - (tile_row + 1) * tile_cells, 0);
+    Tile &tile = tiles[(size_t)tile_row * tiles_across + x_idx / tile_cells];
+    tile.records.push_back(make_record(peak,
+                (y_idx - tile_y) * tile_cells + x_idx % tile_cells));
+    tile.last_used = ++inserts;
+
+    if (++resident_records > max_resident_records && !spill_failed) {
+        spill_least_recent();
+    }
+}
+
+/**
+ * Where a tile is in the volume. Rows of tiles are counted down from the top
+ * row of the volume, the first row of the products, so with the tile size of
+ * the products each tile covers whole blocks of them. Tiles on the east and
+ * south edges may be smaller than the tile size.
+ * @param tile the tile
+ * @param x set to the column of the tile's first cell
+ * @param y set to the row of the tile's first cell
+ * @param width set to the number of cells across the tile
+ * @param height set to the number of cells down the tile
+ */
+void PeakTiles::tile_bounds(size_t tile, int *x, int *y, int *width,
+        int *height) const{
+    int tile_row = tile / tiles_across;
+    *x = (tile % tiles_across) * tile_cells;
+    *y = std::max(y_extent - (tile_row + 1) * tile_cells, 0);
+    *width = std::min(tile_cells, x_extent - *x);
+    *height = y_extent - tile_row * tile_cells - *y;
+}
+
+/**
+ * Collect every record of a tile, both spilled and still in memory, in the
+ * order they were inserted
+ * @param tile the tile to read
+ * @param records filled with the tile's records
+ * @return false if the spilled records could not be read back
+ */
+bool PeakTiles::read_tile(size_t tile, std::vector<PeakRecord> &records){
+    Tile &t = tiles[tile];
+    size_t count = t.records.size();
+    for (auto &chunk : t.chunks) {
+        count += chunk.second;
+    }
+    records.clear();
+    records.reserve(count);
+    for (auto &chunk : t.chunks) {
+        size_t first = records.size();
+        records.resize(first + chunk.second);
+        if (fseeko(spill_file, chunk.first, SEEK_SET) != 0
+                || fread(records.data() + first, sizeof(PeakRecord),
+                    chunk.second, spill_file) != chunk.second) {
+            spdlog::error("Unable to read spilled peaks of tile {}", tile);
+            return false;
+        }
+    }
+    records.insert(records.end(), t.records.begin(), t.records.end());
+    return true;
+}
+
+/**
+ * Free the memory of a tile that is no longer needed
+ * @param tile the tile to free
+ */
+void PeakTiles::release_tile(size_t tile){
+    Tile &t = tiles[tile];
+    resident_records -= t.records.size();
+    std::vector<PeakRecord>().swap(t.records);
+    t.chunks.clear();
+}
+
+/**
+ * @return bytes of records held in memory
+ */
+size_t PeakTiles::resident_bytes() const{
+    return resident_records * sizeof(PeakRecord);
+}
+
+/**
+ * Create the spill file in $TMPDIR, or /tmp. It is unlinked straight away so
+ * it goes away with the process.
+ * @return false if the file could not be created
+ */
+bool PeakTiles::open_spill_file(){
+    const char *dir = getenv("TMPDIR");
+    std::string name = std::string(dir != NULL ? dir : "/tmp")
+        + "/lidar_peaks_XXXXXX";
+    int fd = mkstemp(&name[0]);
+    if (fd < 0) {
+        spdlog::error("Unable to create a spill file in {}", name);
+        return false;
+    }
+    unlink(name.c_str());
+    spill_file = fdopen(fd, "w+b");
+    if (spill_file == NULL) {
+        ::close(fd);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Append a tile's in memory records to the spill file
+ * @param tile the tile to spill
+ * @return false if the records could not be written, they are kept in memory
+ */
+bool PeakTiles::spill(Tile &tile){
+    if (fseeko(spill_file, spill_size, SEEK_SET) != 0
+            || fwrite(tile.records.data(), sizeof(PeakRecord),
+                tile.records.size(), spill_file) != tile.records.size()) {
+        return false;
+    }
+    tile.chunks.push_back({spill_size, tile.records.size()});
+    spill_size += tile.records.size() * sizeof(PeakRecord);
+    resident_records -= tile.records.size();
+    std::vector<PeakRecord>().swap(tile.records);
+    return true;
+}
+
+/**
+ * Spill the tiles added to least recently until half of the memory limit is
+ * used, so spills happen in large batches
+ */
+void PeakTiles::spill_least_recent(){
+    if (spill_file == NULL && !open_spill_file()) {
+        spill_failed = true;
+        return;
+    }
+    std::vector<Tile*> resident;
+    for (Tile &tile : tiles) {
+        if (!tile.records.empty()) {
+            resident.push_back(&tile);
+        }
+    }
+    std::sort(resident.begin(), resident.end(), [](Tile *a, Tile *b) {
+            return a->last_used < b->last_used;
+    });
+    for (Tile *tile : resident) {
+        if (resident_records <= max_resident_records / 2) {
+            break;
+        }
+        if (!spill(*tile)) {
+            spdlog::error("Unable to write to the spill file, keeping every "
+                    "peak in memory");
+            spill_failed = true;
+            return;
+        }
+    }
+    fflush(spill_file);
+    spdlog::debug("Spilled peaks to disk, {} MB spilled in total",
+            spill_size / (1024 * 1024));
+}
@@ -0,0 +1,87 @@
+// File name: PeakTiles.hpp
+// Created on: 18-October-2026
+
+#ifndef PEAKTILES_HPP_
+#define PEAKTILES_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "Peak.hpp"
+
+// Number of cells along each side of a tile
+#define VOLUME_TILE_SIZE 256
+
+// Flags of a PeakRecord
+#define PEAK_RECORD_FIRST 1
+#define PEAK_RECORD_LAST 2
+
+//The parts of a peak the products are made from, stored as the floats the
+//products are computed from
+struct PeakRecord{
+    float elev;
+    float amp;
+    float width;
+    float rise_time;
+    float backscatter;
+    uint32_t cell;  //Cell within its tile, y * tile width + x, unused once
+                    //in the store of a LidarVolume
+    uint32_t flags; //PEAK_RECORD_FIRST if the first peak of its wave,
+                    //PEAK_RECORD_LAST if the last
+};
+
+/**
+ * Peaks of a volume kept as compact records in square tiles, laid out from the
+ * top row of the volume down like the blocks of the products. Once the records
+ * held in memory go over a limit, the tiles that were least recently added to
+ * are appended to an anonymous spill file and dropped from memory. A flight
+ * line is swept in order, so these are usually tiles that are complete.
+ */
+class PeakTiles{
+
+    public:
+        PeakTiles(int x_extent, int y_extent, size_t memory_limit,
+                int tile_size = VOLUME_TILE_SIZE);
+        ~PeakTiles();
+        PeakTiles(const PeakTiles&) = delete;
+        PeakTiles& operator=(const PeakTiles&) = delete;
+
+        static PeakRecord make_record(const Peak &peak, uint32_t cell);
+
+        void insert(int x_idx, int y_idx, const Peak &peak);
+        size_t tile_count() const { return tiles.size(); }
+        int tile_size() const { return tile_cells; }
+        void tile_bounds(size_t tile, int *x, int *y, int *width,
+                int *height) const;
+        bool read_tile(size_t tile, std::vector<PeakRecord> &records);
+        void release_tile(size_t tile);
+
+        size_t resident_bytes() const;
+        size_t spilled_bytes() const { return spill_size; }
+
+    private:
+        struct Tile{
+            std::vector<PeakRecord> records;
+            //{offset, record count} of every run of records spilled
+            std::vector<std::pair<int64_t, size_t>> chunks;
+            uint64_t last_used = 0;
+        };
+
+        bool open_spill_file();
+        bool spill(Tile &tile);
+        void spill_least_recent();
+
+        int x_extent;
+        int y_extent;
+        int tile_cells;
+        int tiles_across;
+        size_t max_resident_records;
+        size_t resident_records;
+        uint64_t inserts;
+        std::vector<Tile> tiles;
+        FILE *spill_file;
+        int64_t spill_size;
+        bool spill_failed;
+};
+
+#endif /* PEAKTILES_HPP_ */
@@ -0,0 +1,104 @@
+// File name: PeakTiles_unittests.cpp
+// Created on: 18-October-2026
+
+#include "PeakTiles.hpp"
+#include "gtest/gtest.h"
+
+class PeakTilesTest : public testing::Test {
+    protected:
+
+        static Peak make_peak(double elev, int position, bool last){
+            Peak peak;
+            peak.z_activation = elev;
+            peak.amp = elev + 1;
+            peak.fwhm = elev + 2;
+            peak.rise_time = elev + 3;
+            peak.backscatter_coefficient = elev + 4;
+            peak.position_in_wave = position;
+            peak.is_final_peak = last;
+            return peak;
+        }
+};
+
+//Tests that tiles are laid out from the top row down, with the tiles on the
+//edges cut to the volume
+TEST_F(PeakTilesTest, tileBounds){
+    PeakTiles tiles(600, 300, 1024 * 1024);
+    ASSERT_EQ(6u, tiles.tile_count());
+
+    int x, y, width, height;
+    tiles.tile_bounds(0, &x, &y, &width, &height);
+    EXPECT_EQ(0, x);
+    EXPECT_EQ(44, y);
+    EXPECT_EQ(256, width);
+    EXPECT_EQ(256, height);
+    tiles.tile_bounds(2, &x, &y, &width, &height);
+    EXPECT_EQ(512, x);
+    EXPECT_EQ(44, y);
+    EXPECT_EQ(88, width);
+    EXPECT_EQ(256, height);
+    tiles.tile_bounds(4, &x, &y, &width, &height);
+    EXPECT_EQ(256, x);
+    EXPECT_EQ(0, y);
+    EXPECT_EQ(256, width);
+    EXPECT_EQ(44, height);
+}
+
+//Tests that a peak's cell is counted from the first row of its tile
+TEST_F(PeakTilesTest, cellsFromTopRow){
+    //Tiles of the top four rows, then of the bottom row
+    PeakTiles tiles(4, 5, 1024 * 1024, 4);
+    ASSERT_EQ(2u, tiles.tile_count());
+    tiles.insert(2, 1, make_peak(1, 1, true));
+    tiles.insert(3, 0, make_peak(2, 1, true));
+
+    std::vector<PeakRecord> records;
+    ASSERT_TRUE(tiles.read_tile(0, records));
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ(1, records[0].elev);
+    EXPECT_EQ(0u * 4 + 2, records[0].cell);
+    ASSERT_TRUE(tiles.read_tile(1, records));
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ(2, records[0].elev);
+    EXPECT_EQ(0u * 4 + 3, records[0].cell);
+}
+
+//Tests that peaks are read back in order once their tiles have been spilled
+TEST_F(PeakTilesTest, spillAndReadBack){
+    //Room for four records, in 4x4 tiles of an 8x8 volume
+    PeakTiles tiles(8, 8, 4 * sizeof(PeakRecord), 4);
+    ASSERT_EQ(4u, tiles.tile_count());
+
+    for (int i = 0; i < 10; i++) {
+        tiles.insert(i % 4, 1, make_peak(i, i % 2 ? 2 : 1, i % 3 == 0));
+        tiles.insert(5, 6, make_peak(100 + i, 1, true));
+    }
+    EXPECT_GT(tiles.spilled_bytes(), 0u);
+    EXPECT_LE(tiles.resident_bytes(), 4 * sizeof(PeakRecord));
+
+    std::vector<PeakRecord> records;
+    ASSERT_TRUE(tiles.read_tile(2, records));
+    ASSERT_EQ(10u, records.size());
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(i, records[i].elev);
+        EXPECT_EQ(i + 1, records[i].amp);
+        EXPECT_EQ(i + 2, records[i].width);
+        EXPECT_EQ(i + 3, records[i].rise_time);
+        EXPECT_EQ(i + 4, records[i].backscatter);
+        EXPECT_EQ((uint32_t)(4 + i % 4), records[i].cell);
+        EXPECT_EQ((i % 2 ? 0u : PEAK_RECORD_FIRST)
+                | (i % 3 == 0 ? PEAK_RECORD_LAST : 0u), records[i].flags);
+    }
+
+    ASSERT_TRUE(tiles.read_tile(1, records));
+    ASSERT_EQ(10u, records.size());
+    EXPECT_EQ(109, records[9].elev);
+    EXPECT_EQ(2u * 4 + 1, records[9].cell);
+
+    ASSERT_TRUE(tiles.read_tile(0, records));
+    EXPECT_TRUE(records.empty());
+
+    tiles.release_tile(2);
+    ASSERT_TRUE(tiles.read_tile(2, records));
+    EXPECT_TRUE(records.empty());
+}
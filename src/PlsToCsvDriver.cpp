@@ -40,22 +40,43 @@ int main (int argc, char *argv[]) {
 
     // Initialize data input per CmdLine specification
     
-    // ingest the raw flight data into an object
-    if (rawData.setFlightLineData(plsFileName)) {
+    // ingest the raw flight data into an object, or open the peaks already
+    // fitted from it
+    PeakStoreReader peakStore;
+    if (cmdLineArgs.is_peak_store) {
+        if (!peakStore.open(plsFileName)) {
+            return 1;
+        }
+        // The files are named after how the peaks were fitted
+        cmdLineArgs.useGaussianFitting = peakStore.info().gaussian;
+    } else if (rawData.setFlightLineData(plsFileName, cmdLineArgs.use_mmap)) {
         return 1;
     }
 
-    std::vector<Peak*> peaks = helper.fit_data_csv(rawData, cmdLineArgs);
+    // Open one csv file per product and stream the peaks to them
+    CsvWriter writer(cmdLineArgs.buffer_size * 1024);
     for(int product : cmdLineArgs.selected_products){
-        std::string property = helper.getPeaksProperty(peaks, product);
         std::string fileName = cmdLineArgs.get_output_filename(product);
-        if(!helper.writeLinesToFile(fileName, {property})){
+        if(!writer.add_product(product, fileName)){
             spdlog::error("Failed to write to file {}", fileName);
         }
     }
 
+    if (cmdLineArgs.is_peak_store) {
+        if (!helper.write_peak_store(peakStore, writer)) {
+            spdlog::error("Failed to read the peak store {}", plsFileName);
+        }
+    } else {
+        helper.fit_data_csv(rawData, cmdLineArgs, writer);
+    }
+    if(!writer.close()){
+        spdlog::error("Failed to write all csv files");
+    }
+
     // Free memory
-    rawData.closeFlightLineData();
+    if (!cmdLineArgs.is_peak_store) {
+        rawData.closeFlightLineData();
+    }
 
     // Get end time
     Clock::time_point t2 = Clock::now();
@@ -11,16 +11,23 @@
 #include "Peak.hpp"
 #include "GaussianFitter.hpp"
 #include "csv_CmdLine.hpp"
+#include "PulsePipeline.hpp"
+#include "CsvWriter.hpp"
+#include "PeakStore.hpp"
 
 class PlsToCsvHelper {
     public:
 
-        std::vector<Peak*> fit_data_csv(FlightLineData &raw_data,
-                          csv_CmdLine &cmdLine);
+        void fit_data_csv(FlightLineData &raw_data, csv_CmdLine &cmdLine,
+                          CsvWriter &writer);
 
-        std::string getPeaksProperty(const std::vector<Peak*>& peaks, int productID);
+        void fit_pulse_csv(PulseData &pulseData, WaveGPSInformation &gps_info,
+                FlightLineData &raw_data, GaussianFitter &fitter,
+                csv_CmdLine &cmdLine, std::vector<Peak*> &peaks);
 
-        bool writeLinesToFile(std::string filename, std::vector<std::string> lines);
+        void write_peaks(CsvWriter &writer, std::vector<Peak*> &peaks);
+
+        bool write_peak_store(PeakStoreReader &store, CsvWriter &writer);
 };
 
 #endif
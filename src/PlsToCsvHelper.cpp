@@ -9,84 +9,127 @@
  * Fits the raw data using either gaussian or first difference fitting,
  * and sends each wave of peaks to be written to a CSV file.
  * @param raw_data reference to FlightLineData object that holds raw data
- * @param strings a place where peak to_string calls will be stored
- * @param csv_CmdLine object that knows what data we want from peaks
+ * @param csv_CmdLine object that knows what data we want from peaks and
+ * how many threads to fit with
+ * @param writer the csv files to stream the peaks to, in the order the
+ * pulses were read
  */
-std::vector<Peak*> PlsToCsvHelper::fit_data_csv(FlightLineData &raw_data, csv_CmdLine &cmdLine) 
+void PlsToCsvHelper::fit_data_csv(FlightLineData &raw_data,
+        csv_CmdLine &cmdLine, CsvWriter &writer)
 {
     PulseData pulseData;
     GaussianFitter fitter;
     fitter.noise_level = cmdLine.noise_level;
+    fitter.fitter_engine = cmdLine.fitter_engine;
     std::vector<Peak*> peaks;
-    std::vector<Peak*> results;
+    //Peaks only live until they are written
+    PeakArena pulse_peaks;
+
+    if (cmdLine.num_threads > 1) {
+        spdlog::info("Fitting with {} threads", cmdLine.num_threads);
+        PulsePipeline pipeline(cmdLine.num_threads);
+        pipeline.run(raw_data, fitter,
+                [&](PulseRecord &record, GaussianFitter &worker_fitter,
+                    std::vector<Peak*> &pulse_peaks) {
+                    fit_pulse_csv(record.pulse, record.gps_info, raw_data,
+                            worker_fitter, cmdLine, pulse_peaks);
+                },
+                [&](PulseRecord &, std::vector<Peak*> &pulse_peaks) {
+                    write_peaks(writer, pulse_peaks);
+                });
+    }
 
     //parse each pulse
     while (raw_data.hasNextPulse()) {
-        peaks.clear();
-
         raw_data.getNextPulse(&pulseData);
 
-        //Skip all the empty returning waveforms
-        if (pulseData.returningIdx.empty()){
-            continue;
-        }
+        fitter.peak_arena = &pulse_peaks;
+        fit_pulse_csv(pulseData, raw_data.current_wave_gps_info, raw_data,
+                fitter, cmdLine, peaks);
 
-        try {
-            // Smooth the data and test result
-            fitter.smoothing_expt(&pulseData.returningWave);
-
-            // Check parameter for using gaussian fitting or first differencing
-            if (cmdLine.useGaussianFitting) {
-                fitter.find_peaks(&peaks, pulseData.returningWave,
-                        pulseData.returningIdx, 200);
-            } else {
-                fitter.guess_peaks(&peaks, pulseData.returningWave,
-                        pulseData.returningIdx);
-            }
+        write_peaks(writer, peaks);
+        pulse_peaks.clear();
+    }
+}
 
-            // for each peak - find the activation point
-            //               - calculate x,y,z
-            raw_data.calc_xyz_activation(&peaks);
+/**
+ * Streams a pulse's peaks to the csv files. The peaks are freed with the
+ * arena they were fitted into.
+ * @param writer the csv files to write to
+ * @param peaks the peaks of one pulse, emptied once written
+ */
+void PlsToCsvHelper::write_peaks(CsvWriter &writer, std::vector<Peak*> &peaks)
+{
+    writer.append(peaks);
+    peaks.clear();
+}
 
-            // for each peak we will call to_string and append them together
-            results.insert(results.end(), peaks.begin(), peaks.end());
-        } catch (const std::exception& e) {
-            spdlog::error("Error processing data: {}", e.what());
+/**
+ * Streams the peaks of a peak store to the csv files instead of fitting
+ * them. The peaks are written a chunk of the store at a time, so they are
+ * grouped by where they are rather than in the order the pulses were read:
+ * square by square, by row then column, and in pulse order within a square.
+ * The values written are the same as when the pulses are fitted.
+ * @param store an open peak store
+ * @param writer the csv files to stream the peaks to
+ * @return false if the store could not be read
+ */
+bool PlsToCsvHelper::write_peak_store(PeakStoreReader &store,
+        CsvWriter &writer)
+{
+    PeakArena chunk_peaks;
+    std::vector<Peak*> peaks;
+    for (size_t chunk = 0; chunk < store.chunk_count(); chunk++) {
+        if (!store.read_chunk(chunk, chunk_peaks, peaks)) {
+            return false;
         }
+        write_peaks(writer, peaks);
+        chunk_peaks.clear();
     }
-  return results; 
+    return true;
 }
 
-std::string PlsToCsvHelper::getPeaksProperty(const std::vector<Peak*>& peaks, int productID){
-    std::string results;
-    for(const Peak* peak: peaks){
-        std::string temp;
-        peak->to_string(temp,{productID});
-        results+=temp;
-        results+=",";           
-    }
-    
-    //this statement deletes the extra comma
-    //at the end of the file
-    if(!results.empty()){
-        results.erase(results.end() -1);
+/**
+ * Fits a single pulse and finds the activation point of every peak found.
+ * Safe to call from several threads at once as long as each thread uses its
+ * own fitter.
+ * @param pulseData the pulse to fit, its returning wave is smoothed in place
+ * @param gps_info gps information read along with the pulse
+ * @param raw_data the flight line the pulse was read from
+ * @param fitter the fitter to use for smoothing and fitting
+ * @param cmdLine object that knows which fitting type to use
+ * @param peaks where the found peaks are stored, left empty on failure
+ */
+void PlsToCsvHelper::fit_pulse_csv(PulseData &pulseData,
+        WaveGPSInformation &gps_info, FlightLineData &raw_data,
+        GaussianFitter &fitter, csv_CmdLine &cmdLine,
+        std::vector<Peak*> &peaks)
+{
+    peaks.clear();
+
+    //Skip all the empty returning waveforms
+    if (pulseData.returningIdx.empty()){
+        return;
     }
 
-    return results;
-}
+    try {
+        // Smooth the data and test result
+        fitter.smoothing_expt(&pulseData.returningWave);
 
-bool PlsToCsvHelper::writeLinesToFile(std::string filename, std::vector<std::string> lines) {
-    std::ofstream file (filename);
-    if (file.is_open()) {
-        for(std::string line: lines){
-            file << line;
-            file << '\n';
+        // Check parameter for using gaussian fitting or first differencing
+        if (cmdLine.useGaussianFitting) {
+            fitter.find_peaks(&peaks, pulseData.returningWave,
+                    pulseData.returningIdx, 200);
+        } else {
+            fitter.guess_peaks(&peaks, pulseData.returningWave,
+                    pulseData.returningIdx);
         }
-    } else {
-        //File could not be opened
-        return false;
+
+        // for each peak - find the activation point
+        //               - calculate x,y,z
+        raw_data.calc_xyz_activation(&peaks, gps_info, fitter.owning_arena());
+    } catch (const std::exception& e) {
+        spdlog::error("Error processing data: {}", e.what());
+        fitter.release_peaks(peaks);
     }
-    return true;
 }
-
-
@@ -0,0 +1,187 @@
+// File name: PlsToCsvHelper_unittests.cpp
+// Created on: 18-October-2026
+
+#include "PlsToCsvHeader.hpp"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+class PlsToCsvHelperTest : public testing::Test {
+    protected:
+        const std::string pls_file = "etc/140823_183115_1_clipped_test.pls";
+        const char *store_file = "do_not_use_helper.peaks";
+        //Every product with one value per peak, then the activation point
+        const std::vector<int> products = {1, 2, 3, 4, 5, 6, 7, 9};
+        //Names of the runs whose csv files are written
+        const std::vector<std::string> runs = {"fitted", "stored", "serial",
+            "threaded"};
+
+        PlsToCsvHelper helper;
+        csv_CmdLine cmd;
+
+        void TearDown(){
+            std::remove(store_file);
+            for (const std::string &run : runs) {
+                for (int product : products) {
+                    std::remove(csv_file(run, product).c_str());
+                }
+            }
+        }
+
+        static std::string csv_file(const std::string &run, int product){
+            return "do_not_use_" + run + "_" + std::to_string(product)
+                + ".csv";
+        }
+
+        void open_writer(CsvWriter &writer, const std::string &run){
+            for (int product : products) {
+                ASSERT_TRUE(writer.add_product(product,
+                            csv_file(run, product)));
+            }
+        }
+
+        //The whole of a product's csv file
+        static std::string read_file(const std::string &name){
+            std::ifstream file(name, std::ios::binary);
+            std::stringstream contents;
+            contents << file.rdbuf();
+            return contents.str();
+        }
+
+        //Fit the whole flight line into csv files named after the run
+        void fit_run(const std::string &run, int num_threads){
+            FlightLineData raw_data;
+            ASSERT_EQ(0, raw_data.setFlightLineData(pls_file));
+            CsvWriter writer;
+            open_writer(writer, run);
+            cmd.num_threads = num_threads;
+            helper.fit_data_csv(raw_data, cmd, writer);
+            ASSERT_TRUE(writer.close());
+            raw_data.closeFlightLineData();
+        }
+
+        //The values of a product's csv file, in the order written
+        static std::vector<std::string> read_values(const std::string &name){
+            std::ifstream file(name);
+            std::string line;
+            std::getline(file, line);
+            std::vector<std::string> values;
+            std::stringstream fields(line);
+            std::string value;
+            while (std::getline(fields, value, ',')) {
+                value.erase(0, value.find_first_not_of(' '));
+                values.push_back(value);
+            }
+            return values;
+        }
+
+        //Row k holds every product of peak k, the three values of the
+        //activation point last
+        std::vector<std::vector<std::string>> read_rows(
+                const std::string &run){
+            std::vector<std::vector<std::string>> rows;
+            for (int product : products) {
+                std::vector<std::string> values =
+                    read_values(csv_file(run, product));
+                size_t per_peak = product == 9 ? 3 : 1;
+                if (rows.empty()) {
+                    rows.resize(values.size() / per_peak);
+                }
+                EXPECT_EQ(rows.size() * per_peak, values.size());
+                for (size_t i = 0; i < values.size(); i++) {
+                    if (i / per_peak < rows.size()) {
+                        rows[i / per_peak].push_back(values[i]);
+                    }
+                }
+            }
+            return rows;
+        }
+};
+
+//Tests that csv made from a peak store has the same values as csv made by
+//fitting, with the rows grouped by the chunks of the store
+TEST_F(PlsToCsvHelperTest, peakStoreMatchesFitting){
+    FlightLineData fitted_data;
+    ASSERT_EQ(0, fitted_data.setFlightLineData(pls_file));
+    CsvWriter fitted;
+    open_writer(fitted, "fitted");
+    helper.fit_data_csv(fitted_data, cmd, fitted);
+    ASSERT_TRUE(fitted.close());
+    fitted_data.closeFlightLineData();
+
+    //Fit the same pulses into a store, noting the square of every peak
+    FlightLineData raw_data;
+    ASSERT_EQ(0, raw_data.setFlightLineData(pls_file));
+    PeakStoreInfo info;
+    info.bb_x_min = raw_data.bb_x_min;
+    info.bb_x_max = raw_data.bb_x_max;
+    info.bb_y_min = raw_data.bb_y_min;
+    info.bb_y_max = raw_data.bb_y_max;
+    //A few squares across the clipped flight line
+    info.tile_size = 1;
+    PeakStoreWriter writer;
+    ASSERT_TRUE(writer.open(store_file, info));
+    GaussianFitter fitter;
+    fitter.noise_level = cmd.noise_level;
+    fitter.fitter_engine = cmd.fitter_engine;
+    PeakArena pulse_peaks;
+    fitter.peak_arena = &pulse_peaks;
+    PulseData pulse;
+    std::vector<Peak*> peaks;
+    std::vector<std::pair<int, int>> squares;
+    while (raw_data.hasNextPulse()) {
+        raw_data.getNextPulse(&pulse);
+        helper.fit_pulse_csv(pulse, raw_data.current_wave_gps_info, raw_data,
+                fitter, cmd, peaks);
+        writer.append(peaks, peaks.size());
+        for (Peak *peak : peaks) {
+            squares.push_back(std::make_pair(
+                (int)std::floor(peak->y_activation - info.bb_y_min),
+                (int)std::floor(peak->x_activation - info.bb_x_min)));
+        }
+        pulse_peaks.clear();
+    }
+    ASSERT_TRUE(writer.close());
+    raw_data.closeFlightLineData();
+
+    PeakStoreReader reader;
+    ASSERT_TRUE(reader.open(store_file));
+    EXPECT_GT(reader.chunk_count(), 1u);
+    CsvWriter stored;
+    open_writer(stored, "stored");
+    ASSERT_TRUE(helper.write_peak_store(reader, stored));
+    ASSERT_TRUE(stored.close());
+
+    std::vector<std::vector<std::string>> fitted_rows = read_rows("fitted");
+    std::vector<std::vector<std::string>> stored_rows = read_rows("stored");
+    ASSERT_GT(fitted_rows.size(), 0u);
+    ASSERT_EQ(squares.size(), fitted_rows.size());
+    ASSERT_EQ(fitted_rows.size(), stored_rows.size());
+
+    //Squares come out by row then column, each in the order pulses were
+    //read
+    std::vector<size_t> order(squares.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return squares[a] < squares[b]; });
+    for (size_t i = 0; i < order.size(); i++) {
+        EXPECT_EQ(fitted_rows[order[i]], stored_rows[i]) << "row " << i;
+    }
+}
+
+//Tests that fitting on several threads writes the same csv files, byte for
+//byte, as fitting on one
+TEST_F(PlsToCsvHelperTest, fit_data_threaded_test){
+    ASSERT_NO_FATAL_FAILURE(fit_run("serial", 1));
+    ASSERT_NO_FATAL_FAILURE(fit_run("threaded", 4));
+    for (int product : products) {
+        std::string serial = read_file(csv_file("serial", product));
+        ASSERT_FALSE(serial.empty()) << "product " << product;
+        EXPECT_TRUE(serial == read_file(csv_file("threaded", product)))
+            << "product " << product;
+    }
+}
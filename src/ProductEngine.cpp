@@ -0,0 +1,345 @@
+// File name: ProductEngine.cpp
+// Created on: 18-October-2026
+
+#include "ProductEngine.hpp"
+#include <algorithm>
+
+ProductEngine::ProductEngine(){
+}
+
+/**
+ * Add a product to compute, sharing the moments of any product already added
+ * with the same peaks and variable
+ * @param prod_calc the code of the calculation to use
+ * @param prod_peaks the code of the peaks to use
+ * @param prod_var the code the variable to use
+ * @return the index of the product, for row
+ */
+size_t ProductEngine::add_product(int prod_calc, int prod_peaks, int prod_var){
+    Product product;
+    product.calc = prod_calc;
+    for (product.group = 0; product.group < groups.size(); product.group++) {
+        if (groups[product.group].peaks == prod_peaks &&
+                groups[product.group].var == prod_var) {
+            break;
+        }
+    }
+    if (product.group == groups.size()) {
+        MomentGroup group;
+        group.peaks = prod_peaks;
+        group.var = prod_var;
+        group.power = 0;
+        group.quantiles = false;
+        groups.push_back(group);
+        kernels.push_back(NULL);
+        sketch_kernels.push_back(NULL);
+        moments.push_back(Moments());
+    }
+    //std-dev is 3, skewness 4 and kurtosis 5
+    if (prod_calc >= 3 && prod_calc <= 5 &&
+            groups[product.group].power < prod_calc - 1) {
+        groups[product.group].power = prod_calc - 1;
+    }
+    if (CellMoments::quantile_of(prod_calc) >= 0) {
+        groups[product.group].quantiles = true;
+    }
+    kernels[product.group] = group_kernel(groups[product.group]);
+    sketch_kernels[product.group] = sketch_kernel(groups[product.group]);
+    products.push_back(product);
+    rows.push_back(std::vector<float>());
+    return products.size() - 1;
+}
+
+/**
+ * Compute every product for one row of the volume
+ * @param fitted_data a finalized lidar volume
+ * @param y the row of the volume
+ */
+void ProductEngine::compute_row(LidarVolume &fitted_data, int y){
+    for (size_t i = 0; i < rows.size(); i++) {
+        rows[i].resize(fitted_data.x_idx_extent);
+    }
+    //Where the moments of each group are kept by a streamed volume
+    std::vector<int> group_index;
+    if (fitted_data.moments != NULL) {
+        for (size_t g = 0; g < groups.size(); g++) {
+            group_index.push_back(fitted_data.moments->find_group(
+                        groups[g].peaks, groups[g].var, groups[g].power,
+                        groups[g].quantiles));
+        }
+    }
+    //Cells outside the columns holding peaks all get the values of an empty
+    //cell, without being looked at
+    int x_min, x_max;
+    if (!fitted_data.occupied_columns(y, &x_min, &x_max)) {
+        x_min = fitted_data.x_idx_extent;
+        x_max = x_min - 1;
+    }
+    if (x_min > 0 || x_max < fitted_data.x_idx_extent - 1) {
+        accumulate(NULL, NULL);
+        for (size_t i = 0; i < products.size(); i++) {
+            float empty = product_value(products[i]);
+            std::fill(rows[i].begin(), rows[i].begin() + x_min, empty);
+            std::fill(rows[i].begin() + x_max + 1, rows[i].end(), empty);
+        }
+    }
+    for (int x = x_min; x <= x_max; x++) {
+        size_t cell = fitted_data.position(y, x);
+        if (fitted_data.moments != NULL) {
+            load_moments(*fitted_data.moments, cell, group_index);
+        } else {
+            accumulate(fitted_data.peaks_begin(cell),
+                    fitted_data.peaks_end(cell));
+        }
+        for (size_t i = 0; i < products.size(); i++) {
+            rows[i][x] = product_value(products[i]);
+        }
+    }
+}
+
+/**
+ * Find the moments of every group over the peaks of one cell. The peaks are
+ * walked in the same order, and the sums taken in the same precision, as by
+ * the statistics of LidarDriver, so the products come out the same.
+ * @param first the first peak of the cell
+ * @param last one past the last peak of the cell
+ */
+void ProductEngine::accumulate(const PeakRecord *first,
+        const PeakRecord *last){
+    for (size_t g = 0; g < groups.size(); g++) {
+        kernels[g](first, last, moments[g]);
+        if (sketch_kernels[g] != NULL) {
+            sketch_kernels[g](first, last, moments[g].sketch);
+        }
+    }
+}
+
+/**
+ * Find the moments of a group over the peaks of one cell
+ * @param first the first peak of the cell
+ * @param last one past the last peak of the cell
+ * @param cell set to the moments of the group
+ */
+template <int PROD_PEAKS, int PROD_VAR, int POWER>
+void ProductEngine::accumulate_group(const PeakRecord *first,
+        const PeakRecord *last, Moments &cell){
+    cell.count = 0;
+    cell.max_val = NO_DATA;
+    cell.min_val = MAX_ELEV;
+    cell.sum = 0;
+    cell.sq_sum = 0;
+    cell.cube_sum = 0;
+    cell.quad_sum = 0;
+    for (const PeakRecord *peak = first; peak != last; ++peak) {
+        if (!CellMoments::counts<PROD_PEAKS>(*peak)) {
+            continue;
+        }
+        float cur_val = CellMoments::peak_value<PROD_VAR>(*peak);
+        cell.count++;
+        cell.sum += cur_val;
+        if (cur_val > cell.max_val) {
+            cell.max_val = cur_val;
+        }
+        if (cur_val < cell.min_val) {
+            cell.min_val = cur_val;
+        }
+    }
+    cell.mean = cell.count ? cell.sum / cell.count : NO_DATA;
+    if (POWER == 0) {
+        return;
+    }
+
+    //The central moments need the mean, so take a second pass
+    for (const PeakRecord *peak = first; peak != last; ++peak) {
+        if (!CellMoments::counts<PROD_PEAKS>(*peak)) {
+            continue;
+        }
+        double diff = static_cast<double>(
+                CellMoments::peak_value<PROD_VAR>(*peak)) - cell.mean;
+        double square = diff * diff;
+        cell.sq_sum += square;
+        if (POWER >= 3) {
+            cell.cube_sum += square * diff;
+        }
+        if (POWER >= 4) {
+            cell.quad_sum += square * square;
+        }
+    }
+}
+
+//The kernels of every power of a peak filter and variable
+#define POWER_KERNELS(peaks, var) { \
+    &ProductEngine::accumulate_group<peaks, var, 0>, \
+    &ProductEngine::accumulate_group<peaks, var, 2>, \
+    &ProductEngine::accumulate_group<peaks, var, 3>, \
+    &ProductEngine::accumulate_group<peaks, var, 4>}
+//The kernels of every variable and power of a peak filter
+#define VAR_KERNELS(peaks) { \
+    POWER_KERNELS(peaks, 0), POWER_KERNELS(peaks, 1), \
+    POWER_KERNELS(peaks, 2), POWER_KERNELS(peaks, 3), \
+    POWER_KERNELS(peaks, 4)}
+
+/**
+ * @param group the peak filter, variable and power of a moment group
+ * @return the kernel computing the group
+ */
+ProductEngine::GroupKernel ProductEngine::group_kernel(
+        const MomentGroup &group){
+    //By peak filter, variable, then power of 0, 2, 3 or 4
+    static const GroupKernel table[3][5][4] = {
+        VAR_KERNELS(0), VAR_KERNELS(1), VAR_KERNELS(2)};
+    if (group.peaks < 0 || group.peaks > 2 || group.var < 0 ||
+            group.var > 4) {
+        //A filter no peak passes, as the codes count nothing
+        return &accumulate_group<-1, 0, 0>;
+    }
+    int power = group.power < 2 ? 0 : group.power - 1;
+    return table[group.peaks][group.var][power];
+}
+
+#undef POWER_KERNELS
+#undef VAR_KERNELS
+
+/**
+ * Fill the sketch of a group with the peaks of one cell
+ * @param first the first peak of the cell
+ * @param last one past the last peak of the cell
+ * @param sketch set to the sketch of the values of the group
+ */
+template <int PROD_PEAKS, int PROD_VAR>
+void ProductEngine::sketch_group(const PeakRecord *first,
+        const PeakRecord *last, QuantileSketch &sketch){
+    sketch.clear();
+    for (const PeakRecord *peak = first; peak != last; ++peak) {
+        if (CellMoments::counts<PROD_PEAKS>(*peak)) {
+            sketch.add(CellMoments::peak_value<PROD_VAR>(*peak));
+        }
+    }
+}
+
+//The sketch kernels of every variable of a peak filter
+#define SKETCH_KERNELS(peaks) { \
+    &ProductEngine::sketch_group<peaks, 0>, \
+    &ProductEngine::sketch_group<peaks, 1>, \
+    &ProductEngine::sketch_group<peaks, 2>, \
+    &ProductEngine::sketch_group<peaks, 3>, \
+    &ProductEngine::sketch_group<peaks, 4>}
+
+/**
+ * @param group the peak filter and variable of a moment group
+ * @return the kernel filling the sketch of the group, NULL if it wants no
+ * quantiles
+ */
+ProductEngine::SketchKernel ProductEngine::sketch_kernel(
+        const MomentGroup &group){
+    //By peak filter, then variable
+    static const SketchKernel table[3][5] = {
+        SKETCH_KERNELS(0), SKETCH_KERNELS(1), SKETCH_KERNELS(2)};
+    if (!group.quantiles) {
+        return NULL;
+    }
+    if (group.peaks < 0 || group.peaks > 2 || group.var < 0 ||
+            group.var > 4) {
+        return &sketch_group<-1, 0>;
+    }
+    return table[group.peaks][group.var];
+}
+
+#undef SKETCH_KERNELS
+
+/**
+ * Take the moments of every group from the running moments of a cell
+ * @param cell_moments the running moments of a streamed volume
+ * @param cell the cell of the volume
+ * @param group_index the group of cell_moments of each group, -1 if the
+ * volume did not keep it
+ */
+void ProductEngine::load_moments(const CellMoments &cell_moments, size_t cell,
+        const std::vector<int> &group_index){
+    for (size_t g = 0; g < groups.size(); g++) {
+        Moments &cell_group = moments[g];
+        if (group_index[g] < 0) {
+            cell_group.count = 0;
+            continue;
+        }
+        const double *running = cell_moments.moments(cell, group_index[g]);
+        cell_group.count = running[MOMENT_COUNT];
+        cell_group.mean = running[MOMENT_MEAN];
+        cell_group.max_val = running[MOMENT_MAX];
+        cell_group.min_val = running[MOMENT_MIN];
+        if (groups[g].power >= 2) {
+            cell_group.sq_sum = running[MOMENT_M2];
+        }
+        if (groups[g].power >= 3) {
+            cell_group.cube_sum = running[MOMENT_M3];
+        }
+        if (groups[g].power >= 4) {
+            cell_group.quad_sum = running[MOMENT_M4];
+        }
+        if (groups[g].quantiles) {
+            cell_group.sketch = cell_moments.sketch(cell, group_index[g]);
+        }
+    }
+}
+
+/**
+ * @param cell the moments of a group over one cell
+ * @return the sample standard deviation, NO_DATA if there are not enough
+ * peaks
+ */
+double ProductEngine::deviation(const Moments &cell){
+    if (cell.count == 0) {
+        return NO_DATA;
+    }
+    double inverse = 1.0 / static_cast<double>(cell.count - 1);
+    inverse = sqrt(inverse * cell.sq_sum);
+    return std::isfinite(inverse) ? inverse : NO_DATA;
+}
+
+/**
+ * @param product the product to compute
+ * @return the value of the product for the cell last accumulated
+ */
+float ProductEngine::product_value(const Product &product) const{
+    const Moments &cell = moments[product.group];
+    if (cell.count == 0) {
+        return NO_DATA;
+    }
+    switch (product.calc) {
+        case 0: //max
+            return cell.max_val;
+        case 1: //min
+            return cell.min_val;
+        case 2: //mean
+            return cell.mean;
+        case 3: //std-dev
+            return deviation(cell);
+        case 4: //skewness
+        case 5: //kurtosis
+        {
+            float dev = deviation(cell);
+            if (dev == NO_DATA) {
+                return NO_DATA;
+            }
+            //All data points were exactly the same so return normal
+            //distribution
+            if (dev == 0) {
+                return 0;
+            }
+            int power = product.calc == 4 ? 3 : 4;
+            double inverse = 1.0 / static_cast<double>(cell.count - 1);
+            inverse = (inverse * (power == 3 ? cell.cube_sum : cell.quad_sum))
+                / CellMoments::power_of(dev, power);
+            return std::isfinite(inverse) ? inverse : NO_DATA;
+        }
+        case 6: //median
+        case 7: //10th, 25th, 75th, 90th and 98th percentiles
+        case 8:
+        case 9:
+        case 10:
+        case 11:
+            return cell.sketch.quantile(CellMoments::quantile_of(product.calc));
+        default:
+            return 0;
+    }
+}
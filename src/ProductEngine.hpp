@@ -0,0 +1,91 @@
+// File name: ProductEngine.hpp
+// Created on: 18-October-2026
+
+#ifndef PRODUCTENGINE_HPP_
+#define PRODUCTENGINE_HPP_
+
+#include <vector>
+#include "LidarVolume.hpp"
+#include "CellMoments.hpp"
+#include "PeakTiles.hpp"
+
+/**
+ * Computes any number of products of a finalized LidarVolume in one pass over
+ * the peaks of each row. Products of the same peak filter and variable share
+ * the moments of each cell, so asking for the mean, std-dev, skewness and
+ * kurtosis of a variable walks its peaks twice instead of nine times. Each
+ * group is computed by a kernel compiled for its peak filter, variable and
+ * power, picked once, so nothing is looked up for every peak. The values
+ * match produce_product run once per product. Quantile products of a group
+ * share a QuantileSketch of each cell. A volume that streamed its peaks into
+ * CellMoments is read from those instead.
+ */
+class ProductEngine{
+
+    public:
+        ProductEngine();
+
+        size_t add_product(int prod_calc, int prod_peaks, int prod_var);
+        size_t product_count() const { return products.size(); }
+
+        void compute_row(LidarVolume &fitted_data, int y);
+        //Values of a product for the row last computed, one per column
+        const float* row(size_t product) const {
+            return rows[product].data();
+        }
+
+        const std::vector<MomentGroup>& moment_groups() const {
+            return groups;
+        }
+
+    private:
+        //Moments of a group over the peaks of one cell
+        struct Moments{
+            int count;
+            float max_val;
+            float min_val;
+            double sum;
+            float mean;
+            double sq_sum;   //sums of powers of the distance from the mean
+            double cube_sum;
+            double quad_sum;
+            QuantileSketch sketch; //only filled for groups wanting quantiles
+        };
+
+        struct Product{
+            int calc;
+            size_t group;
+        };
+
+        //Finds the moments of one group over the peaks of a cell
+        typedef void (*GroupKernel)(const PeakRecord *first,
+                const PeakRecord *last, Moments &cell);
+        //Fills the sketch of one group with the peaks of a cell
+        typedef void (*SketchKernel)(const PeakRecord *first,
+                const PeakRecord *last, QuantileSketch &sketch);
+
+        std::vector<Product> products;
+        std::vector<MomentGroup> groups;
+        //The kernel of each group, picked once when the group is added
+        std::vector<GroupKernel> kernels;
+        //The sketch kernel of each group, NULL if it wants no quantiles
+        std::vector<SketchKernel> sketch_kernels;
+        std::vector<Moments> moments;
+        std::vector<std::vector<float>> rows;
+
+        void accumulate(const PeakRecord *first, const PeakRecord *last);
+        template <int PROD_PEAKS, int PROD_VAR, int POWER>
+        static void accumulate_group(const PeakRecord *first,
+                const PeakRecord *last, Moments &cell);
+        static GroupKernel group_kernel(const MomentGroup &group);
+        template <int PROD_PEAKS, int PROD_VAR>
+        static void sketch_group(const PeakRecord *first,
+                const PeakRecord *last, QuantileSketch &sketch);
+        static SketchKernel sketch_kernel(const MomentGroup &group);
+        void load_moments(const CellMoments &cell_moments, size_t cell,
+                const std::vector<int> &group_index);
+        float product_value(const Product &product) const;
+        static double deviation(const Moments &cell);
+};
+
+#endif /* PRODUCTENGINE_HPP_ */
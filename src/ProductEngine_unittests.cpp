@@ -0,0 +1,171 @@
+// File name: ProductEngine_unittests.cpp
+// Created on: 18-October-2026
+
+#include "ProductEngine.hpp"
+#include "gtest/gtest.h"
+
+class ProductEngineTest : public testing::Test {
+    protected:
+        LidarVolume volume;
+
+        void SetUp(){
+            volume.setBoundingBox(0, 2, 0, 0, 0, 1);
+            volume.allocateMemory();
+            add_peaks(volume);
+            volume.finalize();
+        }
+
+        //A row of three cells, the first with four peaks, the second with one
+        //and the last empty
+        static void add_peaks(LidarVolume &volume){
+            float amps[] = {2, 4, 4, 6};
+            for (int i = 0; i < 4; i++) {
+                add_peak(volume, 0, amps[i], 10 + i, i == 0, i == 3);
+            }
+            add_peak(volume, 1, 5, 20, true, true);
+        }
+
+        void TearDown(){
+            volume.deallocateMemory();
+        }
+
+        static void add_peak(LidarVolume &volume, double x, float amp,
+                float elev, bool first, bool last){
+            Peak *peak = volume.peak_arena.allocate();
+            peak->x_activation = x;
+            peak->y_activation = 0;
+            peak->amp = amp;
+            peak->z_activation = elev;
+            peak->position_in_wave = first ? 1 : 2;
+            peak->is_final_peak = last;
+            volume.insert_peak(peak);
+        }
+};
+
+//Tests products of every calculation over all peaks of a row
+TEST_F(ProductEngineTest, allPeaks){
+    ProductEngine engine;
+    for (int calc = 0; calc < 6; calc++) {
+        EXPECT_EQ((size_t) calc, engine.add_product(calc, 2, 1));
+    }
+    ASSERT_EQ(6u, engine.product_count());
+    ASSERT_EQ(3, volume.x_idx_extent);
+    engine.compute_row(volume, 0);
+
+    EXPECT_EQ(6, engine.row(0)[0]);
+    EXPECT_EQ(2, engine.row(1)[0]);
+    EXPECT_EQ(4, engine.row(2)[0]);
+    EXPECT_NEAR(sqrt(8.0 / 3), engine.row(3)[0], 1e-6);
+    EXPECT_NEAR(0, engine.row(4)[0], 1e-6);
+    EXPECT_NEAR(32 / 3.0 / pow(8.0 / 3, 2), engine.row(5)[0], 1e-5);
+
+    //A single peak has a mean but no spread
+    EXPECT_EQ(5, engine.row(0)[1]);
+    EXPECT_EQ(5, engine.row(2)[1]);
+    EXPECT_EQ(NO_DATA, engine.row(3)[1]);
+    EXPECT_EQ(NO_DATA, engine.row(5)[1]);
+
+    for (int calc = 0; calc < 6; calc++) {
+        EXPECT_EQ(NO_DATA, engine.row(calc)[2]);
+    }
+}
+
+//Tests that products of different filters and variables are kept apart
+TEST_F(ProductEngineTest, filtersAndVariables){
+    ProductEngine engine;
+    engine.add_product(2, 0, 0); //mean of first elevations
+    engine.add_product(2, 1, 0); //mean of last elevations
+    engine.add_product(0, 2, 0); //max of all elevations
+    engine.add_product(1, 0, 1); //min of first amplitudes
+    engine.add_product(3, 1, 1); //std-dev of last amplitudes
+    engine.compute_row(volume, 0);
+
+    EXPECT_EQ(10, engine.row(0)[0]);
+    EXPECT_EQ(13, engine.row(1)[0]);
+    EXPECT_EQ(13, engine.row(2)[0]);
+    EXPECT_EQ(2, engine.row(3)[0]);
+    EXPECT_EQ(NO_DATA, engine.row(4)[0]);
+    EXPECT_EQ(20, engine.row(0)[1]);
+    EXPECT_EQ(20, engine.row(1)[1]);
+}
+
+//Tests the quantile products, sharing the group of the moments
+TEST_F(ProductEngineTest, quantiles){
+    ProductEngine engine;
+    engine.add_product(2, 2, 1);
+    for (int calc = 6; calc < 12; calc++) {
+        engine.add_product(calc, 2, 1);
+    }
+    engine.add_product(6, 0, 0); //median of first elevations
+    ASSERT_EQ(2u, engine.moment_groups().size());
+    EXPECT_TRUE(engine.moment_groups()[0].quantiles);
+    engine.compute_row(volume, 0);
+
+    EXPECT_EQ(4, engine.row(0)[0]);
+    EXPECT_EQ(4, engine.row(1)[0]);
+    EXPECT_FLOAT_EQ(2.6, engine.row(2)[0]);
+    EXPECT_FLOAT_EQ(3.5, engine.row(3)[0]);
+    EXPECT_FLOAT_EQ(4.5, engine.row(4)[0]);
+    EXPECT_FLOAT_EQ(5.4, engine.row(5)[0]);
+    EXPECT_FLOAT_EQ(5.88, engine.row(6)[0]);
+    EXPECT_EQ(10, engine.row(7)[0]);
+
+    EXPECT_EQ(5, engine.row(1)[1]);
+    EXPECT_EQ(5, engine.row(6)[1]);
+    for (size_t i = 0; i < engine.product_count(); i++) {
+        EXPECT_EQ(NO_DATA, engine.row(i)[2]);
+    }
+}
+
+//Tests that a volume keeping only running moments makes the same products
+TEST_F(ProductEngineTest, streamedVolume){
+    ProductEngine engine;
+    for (int calc = 0; calc < 12; calc++) {
+        engine.add_product(calc, 2, 1);
+        engine.add_product(calc, 0, 0);
+    }
+    LidarVolume streamed;
+    streamed.setBoundingBox(0, 2, 0, 0, 0, 1);
+    streamed.enableStreaming(engine.moment_groups());
+    add_peaks(streamed);
+    EXPECT_EQ(NULL, streamed.volume);
+
+    std::vector<std::vector<float>> expected;
+    engine.compute_row(volume, 0);
+    for (size_t i = 0; i < engine.product_count(); i++) {
+        expected.push_back(std::vector<float>(engine.row(i),
+                    engine.row(i) + volume.x_idx_extent));
+    }
+    engine.compute_row(streamed, 0);
+    for (size_t i = 0; i < engine.product_count(); i++) {
+        for (int x = 0; x < volume.x_idx_extent; x++) {
+            EXPECT_NEAR(expected[i][x], engine.row(i)[x], 1e-5);
+        }
+    }
+
+    //Moments the volume did not keep have no data
+    ProductEngine other;
+    other.add_product(2, 1, 4);
+    other.compute_row(streamed, 0);
+    EXPECT_EQ(NO_DATA, other.row(0)[0]);
+    streamed.deallocateMemory();
+}
+
+//Tests that a group computes the higher moments asked for after it was
+//added, whatever order its products come in
+TEST_F(ProductEngineTest, powerRaisedLater){
+    ProductEngine rising;
+    ProductEngine falling;
+    for (int calc = 0; calc < 6; calc++) {
+        rising.add_product(calc, 2, 1);
+        falling.add_product(5 - calc, 2, 1);
+    }
+    rising.compute_row(volume, 0);
+    falling.compute_row(volume, 0);
+    for (int calc = 0; calc < 6; calc++) {
+        for (int x = 0; x < volume.x_idx_extent; x++) {
+            EXPECT_EQ(falling.row(5 - calc)[x], rising.row(calc)[x]);
+        }
+    }
+    EXPECT_NE(NO_DATA, rising.row(5)[0]);
+}
@@ -0,0 +1,120 @@
+// File name: ProductPipeline.cpp
+// Created on: 18-October-2026
+
+#include "ProductPipeline.hpp"
+#include <algorithm>
+#include <map>
+#include <thread>
+#include "spdlog/spdlog.h"
+
+/**
+ * @param num_workers number of computing threads, at least one is used
+ * @param block_rows number of rows handed to a worker at a time
+ */
+ProductPipeline::ProductPipeline(int num_workers, int block_rows){
+    this->num_workers = num_workers > 0 ? num_workers : 1;
+    this->block_rows = block_rows > 0 ? block_rows : 1;
+}
+
+/**
+ * Compute every product of every row of a volume
+ * @param fitted_data the volume, finalized or streamed, only read
+ * @param engine the products to compute, each worker computes with a copy
+ * @param write_row called for each row on the calling thread, from the last
+ * row of the volume to the first
+ */
+void ProductPipeline::run(LidarVolume &fitted_data,
+        const ProductEngine &engine, RowFunction write_row){
+    long block_count = (fitted_data.y_idx_extent + block_rows - 1)
+        / block_rows;
+    //Room for every worker to finish a block while the one before waits
+    BoundedQueue<ProductBlock> computed(PRODUCT_REORDER_BLOCKS * num_workers);
+    //However long one block takes, the ones after it can't pile up
+    ReorderWindow window(PRODUCT_REORDER_BLOCKS * num_workers);
+    std::atomic<long> next_block(0);
+
+    spdlog::debug("Computing products with {} workers", num_workers);
+
+    std::vector<ProductEngine> worker_engines(num_workers, engine);
+    std::atomic<int> workers_left(num_workers);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_workers; i++) {
+        workers.emplace_back([&, i]{
+            compute_blocks(fitted_data, worker_engines[i], block_count,
+                    next_block, computed, window);
+            //The last worker out lets the calling thread finish
+            if (--workers_left == 0) {
+                computed.close();
+            }
+        });
+    }
+
+    //Blocks finish out of order, hold on to them until their turn comes
+    size_t product_count = engine.product_count();
+    std::vector<const float*> product_rows(product_count);
+    std::map<long, ProductBlock> pending;
+    long next_seq = 0;
+    ProductBlock block;
+    while (computed.pop(block)) {
+        pending[block.seq] = std::move(block);
+        auto it = pending.find(next_seq);
+        while (it != pending.end()) {
+            ProductBlock &ready = it->second;
+            for (int r = 0; r < ready.rows; r++) {
+                for (size_t i = 0; i < product_count; i++) {
+                    product_rows[i] = ready.values.data() +
+                        (r * product_count + i) * fitted_data.x_idx_extent;
+                }
+                write_row(ready.first_y - r, product_rows);
+            }
+            pending.erase(it);
+            window.advance();
+            it = pending.find(++next_seq);
+        }
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (!pending.empty()) {
+        spdlog::critical("Product pipeline finished with {} unwritten blocks",
+                pending.size());
+    }
+}
+
+/**
+ * Worker stage: compute the rows of every product for each block taken
+ * @param fitted_data the volume
+ * @param engine the engine owned by this worker
+ * @param block_count the number of blocks of the volume
+ * @param next_block the next block no worker has taken
+ * @param computed queue of computed blocks waiting to be written
+ * @param window holds a block back while too many blocks before it are
+ * still unwritten
+ */
+void ProductPipeline::compute_blocks(LidarVolume &fitted_data,
+        ProductEngine &engine, long block_count, std::atomic<long> &next_block,
+        BoundedQueue<ProductBlock> &computed, ReorderWindow &window){
+    size_t product_count = engine.product_count();
+    size_t width = fitted_data.x_idx_extent;
+    for (long seq = next_block++; seq < block_count; seq = next_block++) {
+        window.wait(seq);
+        ProductBlock block;
+        block.seq = seq;
+        //Blocks go from the last row of the volume to the first
+        block.first_y = fitted_data.y_idx_extent - 1 - seq * block_rows;
+        block.rows = std::min(block_rows, block.first_y + 1);
+        block.values.resize(block.rows * product_count * width);
+        for (int r = 0; r < block.rows; r++) {
+            engine.compute_row(fitted_data, block.first_y - r);
+            for (size_t i = 0; i < product_count; i++) {
+                std::copy(engine.row(i), engine.row(i) + width,
+                        block.values.begin() + (r * product_count + i) * width);
+            }
+        }
+        if (!computed.push(std::move(block))) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+// File name: ProductPipeline.hpp
+// Created on: 18-October-2026
+
+#ifndef PRODUCTPIPELINE_HPP_
+#define PRODUCTPIPELINE_HPP_
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "BoundedQueue.hpp"
+#include "ReorderWindow.hpp"
+#include "LidarVolume.hpp"
+#include "ProductEngine.hpp"
+
+// Number of rows of a volume handed to a worker at a time
+#define PRODUCT_BLOCK_ROWS 8
+// Computed blocks allowed to wait for an earlier one to be written, per worker
+#define PRODUCT_REORDER_BLOCKS 2
+
+//The rows of every product for a run of rows of a volume, row r of product
+//i starting at values[(r * product_count + i) * width]
+struct ProductBlock{
+    long seq;
+    int first_y;
+    int rows;
+    std::vector<float> values;
+};
+
+/**
+ * Computes the products of a volume on several threads. Workers each take
+ * runs of rows with a copy of the ProductEngine and the calling thread hands
+ * the rows on in the same order produce_products walks them, top row first.
+ * Every cell is still computed whole by one thread, walking its peaks in the
+ * same order, so the products are the same for any number of threads.
+ */
+class ProductPipeline{
+
+    public:
+        //Consumes the rows of every product for row y of the volume, called
+        //in order on the calling thread
+        typedef std::function<void(int y,
+                const std::vector<const float*> &product_rows)> RowFunction;
+
+        ProductPipeline(int num_workers, int block_rows = PRODUCT_BLOCK_ROWS);
+
+        void run(LidarVolume &fitted_data, const ProductEngine &engine,
+                RowFunction write_row);
+
+    private:
+        int num_workers;
+        int block_rows;
+
+        void compute_blocks(LidarVolume &fitted_data, ProductEngine &engine,
+                long block_count, std::atomic<long> &next_block,
+                BoundedQueue<ProductBlock> &computed, ReorderWindow &window);
+};
+
+#endif /* PRODUCTPIPELINE_HPP_ */
@@ -0,0 +1,74 @@
+// File name: ProductPipeline_unittests.cpp
+// Created on: 18-October-2026
+
+#include "ProductPipeline.hpp"
+#include "gtest/gtest.h"
+
+class ProductPipelineTest : public testing::Test {
+    protected:
+        LidarVolume volume;
+        ProductEngine engine;
+
+        //A 13 x 11 volume with a varying number of peaks in each cell
+        void SetUp(){
+            volume.setBoundingBox(0, 12, 0, 10, 0, 1);
+            volume.allocateMemory();
+            srand(7);
+            for (int y = 0; y < volume.y_idx_extent; y++) {
+                for (int x = 0; x < volume.x_idx_extent; x++) {
+                    int count = (x + y) % 4;
+                    for (int i = 0; i < count; i++) {
+                        Peak *peak = volume.peak_arena.allocate();
+                        peak->x_activation = x + 0.5;
+                        peak->y_activation = y + 0.5;
+                        peak->amp = rand() % 1000 / 7.0;
+                        peak->z_activation = rand() % 1000 / 3.0;
+                        peak->position_in_wave = i + 1;
+                        peak->is_final_peak = i == count - 1;
+                        volume.insert_peak(peak);
+                    }
+                }
+            }
+            volume.finalize();
+            for (int calc = 0; calc < 6; calc++) {
+                engine.add_product(calc, 2, 1);
+                engine.add_product(calc, 0, 0);
+            }
+        }
+
+        void TearDown(){
+            volume.deallocateMemory();
+        }
+};
+
+//Tests that every row comes back in order, the same for any number of
+//workers
+TEST_F(ProductPipelineTest, sameAsSerial){
+    std::vector<std::vector<float>> expected;
+    for (int y = volume.y_idx_extent - 1; y >= 0; y--) {
+        engine.compute_row(volume, y);
+        for (size_t i = 0; i < engine.product_count(); i++) {
+            expected.push_back(std::vector<float>(engine.row(i),
+                        engine.row(i) + volume.x_idx_extent));
+        }
+    }
+
+    for (int workers : {1, 3, 8}) {
+        ProductPipeline pipeline(workers, 2);
+        int next_y = volume.y_idx_extent - 1;
+        size_t row = 0;
+        pipeline.run(volume, engine, [&](int y,
+                    const std::vector<const float*> &product_rows){
+            ASSERT_EQ(next_y--, y);
+            ASSERT_EQ(engine.product_count(), product_rows.size());
+            for (const float *product_row : product_rows) {
+                for (int x = 0; x < volume.x_idx_extent; x++) {
+                    ASSERT_EQ(expected[row][x], product_row[x]);
+                }
+                row++;
+            }
+        });
+        EXPECT_EQ(-1, next_y);
+        EXPECT_EQ(expected.size(), row);
+    }
+}
@@ -0,0 +1,184 @@
+// File name: PulseIndex.cpp
+// Created on: 18-October-2026
+
+#include "PulseIndex.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sys/stat.h>
+#include "spdlog/spdlog.h"
+
+//Start of every index file, the last two characters are the format version
+static const char INDEX_MAGIC[8] = {'P', 'L', 'S', 'I', 'D', 'X', '0', '1'};
+
+/**
+ * @param block_size number of pulses covered by each block
+ */
+PulseIndex::PulseIndex(int64_t block_size){
+    pulses_per_block = block_size > 0 ? block_size : 1;
+    clear();
+}
+
+/**
+ * Remove every block
+ */
+void PulseIndex::clear(){
+    pulse_count = 0;
+    indexed_file_size = 0;
+    index.clear();
+}
+
+/**
+ * Add the next pulse of the flight line, starting a new block every
+ * block_size pulses
+ * @param pls_offset where the pulse record starts in the pls file
+ * @param wvs_offset where the pulse's waves start in the wvs file
+ * @param gps_info the position of the pulse
+ */
+void PulseIndex::add_pulse(int64_t pls_offset, int64_t wvs_offset,
+        const WaveGPSInformation &gps_info){
+    double x_min = std::min(gps_info.x_first, gps_info.x_last);
+    double x_max = std::max(gps_info.x_first, gps_info.x_last);
+    double y_min = std::min(gps_info.y_first, gps_info.y_last);
+    double y_max = std::max(gps_info.y_first, gps_info.y_last);
+
+    if (pulse_count % pulses_per_block == 0) {
+        PulseIndexBlock block;
+        block.first_pulse = pulse_count;
+        block.pulse_count = 0;
+        block.pls_offset = pls_offset;
+        block.wvs_offset = wvs_offset;
+        block.gps_time_min = block.gps_time_max = gps_info.gpsTime;
+        block.x_min = x_min;
+        block.x_max = x_max;
+        block.y_min = y_min;
+        block.y_max = y_max;
+        index.push_back(block);
+    }
+    PulseIndexBlock &block = index.back();
+    block.pulse_count++;
+    block.gps_time_min = std::min(block.gps_time_min, gps_info.gpsTime);
+    block.gps_time_max = std::max(block.gps_time_max, gps_info.gpsTime);
+    block.x_min = std::min(block.x_min, x_min);
+    block.x_max = std::max(block.x_max, x_max);
+    block.y_min = std::min(block.y_min, y_min);
+    block.y_max = std::max(block.y_max, y_max);
+    pulse_count++;
+}
+
+/**
+ * Index every pulse of a freshly opened reader, only the pulse records are
+ * read. The reader is left at the end of the file.
+ * @param pReader reader that has not read any pulses yet
+ * @param pls_file_size size of the pls file, to tell later if the index is
+ * out of date
+ * @return false if the file has no pulses
+ */
+bool PulseIndex::build(PULSEreader *pReader, int64_t pls_file_size){
+    clear();
+    WaveGPSInformation gps_info;
+    int64_t pls_offset = pReader->header.offset_to_pulse_data;
+    while (pReader->read_pulse()) {
+        gps_info.populateGPS(pReader);
+        add_pulse(pls_offset, pReader->pulse.offset_to_waves, gps_info);
+        pls_offset += pReader->header.pulse_size;
+    }
+    indexed_file_size = pls_file_size;
+    spdlog::debug("Indexed {} pulses in {} blocks", pulse_count, index.size());
+    return pulse_count > 0;
+}
+
+/**
+ * Write the index to a file
+ * @param fileName the file to write, see index_file_name
+ * @return false if the file could not be written
+ */
+bool PulseIndex::save(const std::string &fileName) const{
+    std::ofstream file(fileName, std::ios::binary);
+    int64_t block_count = index.size();
+    file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    file.write(reinterpret_cast<const char*>(&pulses_per_block), sizeof(int64_t));
+    file.write(reinterpret_cast<const char*>(&pulse_count), sizeof(int64_t));
+    file.write(reinterpret_cast<const char*>(&indexed_file_size),
+            sizeof(int64_t));
+    file.write(reinterpret_cast<const char*>(&block_count), sizeof(int64_t));
+    file.write(reinterpret_cast<const char*>(index.data()),
+            block_count * sizeof(PulseIndexBlock));
+    file.close();
+    if (!file) {
+        spdlog::warn("Unable to write pulse index {}, the pulses will be "
+                "indexed again every time the file is opened", fileName);
+        std::remove(fileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Read an index written by save
+ * @param fileName the file to read
+ * @param number_of_pulses pulses in the flight line, according to its header
+ * @param pls_file_size size of the pls file now
+ * @return false if the file could not be read or indexes a different version
+ * of the flight line
+ */
+bool PulseIndex::load(const std::string &fileName, int64_t number_of_pulses,
+        int64_t pls_file_size){
+    clear();
+    std::ifstream file(fileName, std::ios::binary);
+    char magic[sizeof(INDEX_MAGIC)];
+    int64_t block_size, block_count;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&block_size), sizeof(int64_t));
+    file.read(reinterpret_cast<char*>(&pulse_count), sizeof(int64_t));
+    file.read(reinterpret_cast<char*>(&indexed_file_size), sizeof(int64_t));
+    file.read(reinterpret_cast<char*>(&block_count), sizeof(int64_t));
+    if (!file || !std::equal(magic, magic + sizeof(magic), INDEX_MAGIC)
+            || block_size < 1 || block_count < 0
+            || pulse_count != number_of_pulses
+            || indexed_file_size != pls_file_size
+            || block_count != (pulse_count + block_size - 1) / block_size) {
+        clear();
+        return false;
+    }
+    index.resize(block_count);
+    file.read(reinterpret_cast<char*>(index.data()),
+            block_count * sizeof(PulseIndexBlock));
+    if (!file) {
+        clear();
+        return false;
+    }
+    pulses_per_block = block_size;
+    return true;
+}
+
+/**
+ * @param pulse index of a pulse, 0 is the first pulse in the file
+ * @return the block containing the pulse, NULL if there is no such pulse
+ */
+const PulseIndexBlock* PulseIndex::find_block(int64_t pulse) const{
+    if (pulse < 0 || pulse >= pulse_count) {
+        return NULL;
+    }
+    return &index[pulse / pulses_per_block];
+}
+
+/**
+ * The sidecar file the index of a pls file is kept in
+ * @param plsFileName path to the pls file
+ * @return path to the index file
+ */
+std::string PulseIndex::index_file_name(const std::string &plsFileName){
+    return plsFileName + ".idx";
+}
+
+/**
+ * @param fileName the file to check
+ * @return the size of the file in bytes, -1 if it doesn't exist
+ */
+int64_t PulseIndex::file_size(const std::string &fileName){
+    struct stat info;
+    if (stat(fileName.c_str(), &info) != 0) {
+        return -1;
+    }
+    return info.st_size;
+}
@@ -0,0 +1,61 @@
+// File name: PulseIndex.hpp
+// Created on: 18-October-2026
+
+#ifndef PULSEINDEX_HPP_
+#define PULSEINDEX_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pulsereader.hpp"
+#include "WaveGPSInformation.hpp"
+
+// Number of pulses covered by each block of the index
+#define PULSE_INDEX_BLOCK_SIZE 4096
+
+//A run of consecutive pulses, where it starts in the pls and wvs files and
+//the time and area its pulses cover
+struct PulseIndexBlock{
+    int64_t first_pulse;
+    int64_t pulse_count;
+    int64_t pls_offset;
+    int64_t wvs_offset;
+    double gps_time_min, gps_time_max;
+    double x_min, x_max;
+    double y_min, y_max;
+};
+
+/**
+ * Records where every Kth pulse of a flight line starts, so a reader can seek
+ * to it, along with the GPS time and the xy bounds of the returning waves of
+ * each block of K pulses. Kept in a sidecar file next to the pls file.
+ */
+class PulseIndex{
+
+    public:
+        PulseIndex(int64_t block_size = PULSE_INDEX_BLOCK_SIZE);
+
+        void clear();
+        void add_pulse(int64_t pls_offset, int64_t wvs_offset,
+                const WaveGPSInformation &gps_info);
+        bool build(PULSEreader *pReader, int64_t pls_file_size);
+        bool save(const std::string &fileName) const;
+        bool load(const std::string &fileName, int64_t number_of_pulses,
+                int64_t pls_file_size);
+
+        int64_t block_size() const { return pulses_per_block; }
+        int64_t number_of_pulses() const { return pulse_count; }
+        const std::vector<PulseIndexBlock>& blocks() const { return index; }
+        const PulseIndexBlock* find_block(int64_t pulse) const;
+
+        static std::string index_file_name(const std::string &plsFileName);
+        static int64_t file_size(const std::string &fileName);
+
+    private:
+        int64_t pulses_per_block;
+        int64_t pulse_count;
+        int64_t indexed_file_size;
+        std::vector<PulseIndexBlock> index;
+};
+
+#endif /* PULSEINDEX_HPP_ */
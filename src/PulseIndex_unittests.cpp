@@ -0,0 +1,77 @@
+// File name: PulseIndex_unittests.cpp
+// Created on: 18-October-2026
+
+#include "PulseIndex.hpp"
+#include "gtest/gtest.h"
+
+class PulseIndexTest : public testing::Test {
+    protected:
+
+        virtual void SetUp(){
+            //Ten pulses moving diagonally, three pulses per block
+            for (int i = 0; i < 10; i++) {
+                WaveGPSInformation gps;
+                gps.gpsTime = 100 + i;
+                gps.x_first = i;
+                gps.x_last = i + 0.5;
+                gps.y_first = 20 - i;
+                gps.y_last = 19 - i;
+                index.add_pulse(16 + 48 * i, 60 + 100 * i, gps);
+            }
+        }
+
+        void TearDown(){
+            std::remove("do_not_use.pls.idx");
+        }
+
+        PulseIndex index{3};
+};
+
+//Tests that every block records where it starts and what it covers
+TEST_F(PulseIndexTest, blocks){
+    ASSERT_EQ(10, index.number_of_pulses());
+    ASSERT_EQ(4u, index.blocks().size());
+
+    const PulseIndexBlock &second = index.blocks()[1];
+    EXPECT_EQ(3, second.first_pulse);
+    EXPECT_EQ(3, second.pulse_count);
+    EXPECT_EQ(16 + 48 * 3, second.pls_offset);
+    EXPECT_EQ(60 + 100 * 3, second.wvs_offset);
+    EXPECT_EQ(103, second.gps_time_min);
+    EXPECT_EQ(105, second.gps_time_max);
+    EXPECT_EQ(3, second.x_min);
+    EXPECT_EQ(5.5, second.x_max);
+    EXPECT_EQ(14, second.y_min);
+    EXPECT_EQ(17, second.y_max);
+
+    EXPECT_EQ(1, index.blocks()[3].pulse_count);
+    EXPECT_EQ(&index.blocks()[3], index.find_block(9));
+    EXPECT_EQ(&index.blocks()[0], index.find_block(2));
+    EXPECT_EQ(NULL, index.find_block(10));
+}
+
+//Tests that a saved index loads back the same
+TEST_F(PulseIndexTest, saveAndLoad){
+    ASSERT_TRUE(index.save("do_not_use.pls.idx"));
+
+    PulseIndex loaded;
+    ASSERT_TRUE(loaded.load("do_not_use.pls.idx", 10, 0));
+    EXPECT_EQ(3, loaded.block_size());
+    ASSERT_EQ(index.blocks().size(), loaded.blocks().size());
+    for (size_t i = 0; i < index.blocks().size(); i++) {
+        EXPECT_EQ(index.blocks()[i].pls_offset, loaded.blocks()[i].pls_offset);
+        EXPECT_EQ(index.blocks()[i].wvs_offset, loaded.blocks()[i].wvs_offset);
+        EXPECT_EQ(index.blocks()[i].y_min, loaded.blocks()[i].y_min);
+    }
+}
+
+//Tests that an index of a different version of the file is not used
+TEST_F(PulseIndexTest, staleIndex){
+    ASSERT_TRUE(index.save("do_not_use.pls.idx"));
+
+    PulseIndex loaded;
+    EXPECT_FALSE(loaded.load("do_not_use.pls.idx", 11, 0));
+    EXPECT_FALSE(loaded.load("do_not_use.pls.idx", 10, 1234));
+    EXPECT_FALSE(loaded.load("no_such_file.idx", 10, 0));
+    EXPECT_EQ(0, loaded.number_of_pulses());
+}
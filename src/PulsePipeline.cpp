@@ -0,0 +1,165 @@
+// File name: PulsePipeline.cpp
+// Created on: 18-October-2026
+
+#include "PulsePipeline.hpp"
+#include <atomic>
+#include <map>
+#include <thread>
+#include "spdlog/spdlog.h"
+
+/**
+ * @param num_workers number of fitting threads, at least one is used
+ * @param batch_size number of pulses handed to a worker at a time
+ * @param queue_depth number of batches allowed to wait between stages
+ */
+PulsePipeline::PulsePipeline(int num_workers, size_t batch_size,
+        size_t queue_depth){
+    this->num_workers = num_workers > 0 ? num_workers : 1;
+    this->batch_size = batch_size > 0 ? batch_size : 1;
+    this->queue_depth = queue_depth > 0 ? queue_depth : 1;
+}
+
+/**
+ * Read, fit and merge every remaining pulse of the flight line
+ * @param raw_data the flight line to read pulses from
+ * @param fitter configured fitter that each worker copies. The pass, fail,
+ * total and short counters of every worker are added to it when done
+ * @param fit called on a worker thread for each pulse
+ * @param merge called on the calling thread for each pulse, in file order
+ * @param peak_owner arena that takes every peak found once the pipeline is
+ * done. When NULL the peaks are freed as soon as their batch is merged.
+ */
+void PulsePipeline::run(FlightLineData &raw_data, GaussianFitter &fitter,
+        FitFunction fit, MergeFunction merge, PeakArena *peak_owner){
+    BoundedQueue<PulseBatch> to_fit(queue_depth);
+    BoundedQueue<PulseBatch> to_merge(queue_depth);
+    //However long one batch takes, the ones after it can't pile up
+    ReorderWindow window(PIPELINE_REORDER_BATCHES * num_workers);
+
+    spdlog::debug("Starting pulse pipeline with {} workers", num_workers);
+
+    //Every worker starts from the caller's settings with zeroed counters
+    std::vector<GaussianFitter> worker_fitters(num_workers, fitter);
+    for(GaussianFitter &worker_fitter : worker_fitters){
+        worker_fitter.total = 0;
+        worker_fitter.pass = 0;
+        worker_fitter.fail = 0;
+        worker_fitter.small = 0;
+    }
+
+    //Peaks that outlive the pipeline are kept in one arena per worker, so
+    //each worker leaves at most one partly used block behind instead of
+    //one per batch
+    std::vector<PeakArena> worker_arenas(peak_owner != NULL ? num_workers : 0);
+
+    std::atomic<int> workers_left(num_workers);
+    std::thread reader(&PulsePipeline::read_pulses, this, std::ref(raw_data),
+            std::ref(to_fit));
+    std::vector<std::thread> workers;
+    for(int i = 0; i < num_workers; i++){
+        workers.emplace_back([&, i]{
+            fit_batches(worker_fitters[i],
+                    peak_owner != NULL ? &worker_arenas[i] : NULL, fit,
+                    to_fit, to_merge, window);
+            //The last worker out lets the merge stage finish
+            if(--workers_left == 0){
+                to_merge.close();
+            }
+        });
+    }
+
+    //Batches finish out of order, hold on to them until their turn comes
+    std::map<long, PulseBatch> pending;
+    long next_seq = 0;
+    PulseBatch batch;
+    while(to_merge.pop(batch)){
+        pending[batch.seq] = std::move(batch);
+        auto it = pending.find(next_seq);
+        while(it != pending.end()){
+            PulseBatch &ready = it->second;
+            for(size_t i = 0; i < ready.pulses.size(); i++){
+                merge(ready.pulses[i], ready.peaks[i]);
+            }
+            pending.erase(it);
+            window.advance();
+            it = pending.find(++next_seq);
+        }
+    }
+
+    reader.join();
+    for(std::thread &worker : workers){
+        worker.join();
+    }
+    for(PeakArena &worker_arena : worker_arenas){
+        peak_owner->adopt(worker_arena);
+    }
+
+    if(!pending.empty()){
+        spdlog::critical("Pulse pipeline finished with {} unmerged batches",
+                pending.size());
+    }
+
+    for(GaussianFitter &worker_fitter : worker_fitters){
+        fitter.total += worker_fitter.total;
+        fitter.pass += worker_fitter.pass;
+        fitter.fail += worker_fitter.fail;
+        fitter.small += worker_fitter.small;
+    }
+}
+
+/**
+ * Reader stage: decode pulses into batches until the file is exhausted
+ * @param raw_data the flight line to read pulses from
+ * @param to_fit queue of batches waiting for a worker
+ */
+void PulsePipeline::read_pulses(FlightLineData &raw_data,
+        BoundedQueue<PulseBatch> &to_fit){
+    long seq = 0;
+    while(raw_data.hasNextPulse()){
+        PulseBatch batch;
+        batch.seq = seq++;
+        batch.pulses.reserve(batch_size);
+        while(batch.pulses.size() < batch_size && raw_data.hasNextPulse()){
+            batch.pulses.emplace_back();
+            PulseRecord &record = batch.pulses.back();
+            raw_data.getNextPulse(&record.pulse);
+            record.gps_info = raw_data.current_wave_gps_info;
+        }
+        if(!to_fit.push(std::move(batch))){
+            break;
+        }
+    }
+    to_fit.close();
+}
+
+/**
+ * Worker stage: fit every pulse of each batch taken from the queue
+ * @param worker_fitter the fitter owned by this worker
+ * @param worker_arena arena the peaks of every batch are allocated from, or
+ * NULL to give each batch its own
+ * @param fit the function used to fit a single pulse
+ * @param to_fit queue of batches waiting for a worker
+ * @param to_merge queue of fitted batches waiting to be merged
+ * @param window holds a fitted batch back while too many batches before it
+ * are still unmerged
+ */
+void PulsePipeline::fit_batches(GaussianFitter &worker_fitter,
+        PeakArena *worker_arena, FitFunction &fit, BoundedQueue<PulseBatch> &to_fit,
+        BoundedQueue<PulseBatch> &to_merge, ReorderWindow &window){
+    PulseBatch batch;
+    while(to_fit.pop(batch)){
+        batch.peaks.resize(batch.pulses.size());
+        //Unless they outlive the pipeline, peaks found belong to the batch
+        //and are freed once it is merged
+        worker_fitter.peak_arena = worker_arena != NULL ? worker_arena
+            : &batch.peak_arena;
+        for(size_t i = 0; i < batch.pulses.size(); i++){
+            fit(batch.pulses[i], worker_fitter, batch.peaks[i]);
+        }
+        worker_fitter.peak_arena = NULL;
+        window.wait(batch.seq);
+        if(!to_merge.push(std::move(batch))){
+            break;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+// File name: PulsePipeline.hpp
+// Created on: 18-October-2026
+
+#ifndef PULSEPIPELINE_HPP_
+#define PULSEPIPELINE_HPP_
+
+#include <functional>
+#include <vector>
+#include "BoundedQueue.hpp"
+#include "ReorderWindow.hpp"
+#include "FlightLineData.hpp"
+#include "GaussianFitter.hpp"
+#include "Peak.hpp"
+#include "PeakArena.hpp"
+#include "PulseData.hpp"
+#include "WaveGPSInformation.hpp"
+
+// Number of pulses handed to a worker at a time
+#define PIPELINE_BATCH_SIZE 256
+// Number of batches allowed to wait in each queue
+#define PIPELINE_QUEUE_DEPTH 8
+// Fitted batches allowed to wait for an earlier one to be merged, per worker
+#define PIPELINE_REORDER_BATCHES 2
+
+//A single pulse along with the gps information it was read with
+struct PulseRecord{
+    PulseData pulse;
+    WaveGPSInformation gps_info;
+};
+
+//A run of consecutive pulses and, once fitted, the peaks of each pulse along
+//with the arena that owns them when they don't outlive the pipeline
+struct PulseBatch{
+    long seq;
+    std::vector<PulseRecord> pulses;
+    std::vector<std::vector<Peak*>> peaks;
+    PeakArena peak_arena;
+};
+
+/**
+ * Fits a flight line on several threads. One reader thread decodes pulses
+ * into batches, a pool of workers each fits batches with its own copy of a
+ * GaussianFitter, and the calling thread merges the fitted batches back in
+ * the order the pulses were read, so the merged results are the same as a
+ * serial pass over the file.
+ */
+class PulsePipeline{
+
+    public:
+        //Fits one pulse with the worker's fitter, storing the peaks found
+        typedef std::function<void(PulseRecord&, GaussianFitter&,
+                std::vector<Peak*>&)> FitFunction;
+        //Consumes the peaks of one pulse, called in file order
+        typedef std::function<void(PulseRecord&,
+                std::vector<Peak*>&)> MergeFunction;
+
+        PulsePipeline(int num_workers, size_t batch_size = PIPELINE_BATCH_SIZE,
+                size_t queue_depth = PIPELINE_QUEUE_DEPTH);
+
+        void run(FlightLineData &raw_data, GaussianFitter &fitter,
+                FitFunction fit, MergeFunction merge,
+                PeakArena *peak_owner = NULL);
+
+    private:
+        int num_workers;
+        size_t batch_size;
+        size_t queue_depth;
+
+        void read_pulses(FlightLineData &raw_data,
+                BoundedQueue<PulseBatch> &to_fit);
+        void fit_batches(GaussianFitter &worker_fitter,
+                PeakArena *worker_arena, FitFunction &fit,
+                BoundedQueue<PulseBatch> &to_fit,
+                BoundedQueue<PulseBatch> &to_merge, ReorderWindow &window);
+};
+
+#endif /* PULSEPIPELINE_HPP_ */
@@ -0,0 +1,158 @@
+// File name: QuantileSketch.cpp
+// Created on: 18-October-2026
+
+#include "QuantileSketch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/**
+ * The t-digest scale function, a centroid may span at most one unit of it
+ * @param fraction a fraction of the values of the sketch
+ * @return the scale at the fraction, from -QUANTILE_SKETCH_SIZE / 4 to
+ * QUANTILE_SKETCH_SIZE / 4
+ */
+double scale(double fraction){
+    fraction = std::min(1.0, std::max(0.0, fraction));
+    return QUANTILE_SKETCH_SIZE / (2 * std::acos(-1.0))
+        * std::asin(2 * fraction - 1);
+}
+
+}
+
+QuantileSketch::QuantileSketch(){
+    clear();
+}
+
+/**
+ * Forget every value, keeping the memory for the next ones
+ */
+void QuantileSketch::clear(){
+    centroids.clear();
+    sorted = true;
+    value_count = 0;
+    min_val = std::numeric_limits<float>::max();
+    max_val = std::numeric_limits<float>::lowest();
+}
+
+/**
+ * @param value the value to add to the sketch
+ */
+void QuantileSketch::add(float value){
+    Centroid centroid;
+    centroid.mean = value;
+    centroid.weight = 1;
+    centroids.push_back(centroid);
+    sorted = false;
+    value_count++;
+    min_val = std::min(min_val, value);
+    max_val = std::max(max_val, value);
+    if (centroids.size() > 2 * QUANTILE_SKETCH_SIZE) {
+        compress();
+    }
+}
+
+/**
+ * Add every value of another sketch, as if they had been added to this one
+ * @param other a sketch of other values
+ */
+void QuantileSketch::merge(const QuantileSketch &other){
+    if (other.value_count == 0) {
+        return;
+    }
+    centroids.insert(centroids.end(), other.centroids.begin(),
+            other.centroids.end());
+    sorted = false;
+    value_count += other.value_count;
+    min_val = std::min(min_val, other.min_val);
+    max_val = std::max(max_val, other.max_val);
+    if (centroids.size() > 2 * QUANTILE_SKETCH_SIZE) {
+        compress();
+    }
+}
+
+/**
+ * Find a quantile by interpolating between the centres of the centroids
+ * around it, the smallest and largest values standing in past the first and
+ * last centres
+ * @param fraction the fraction of the values below the quantile, 0.5 for the
+ * median
+ * @return the quantile, 0 if the sketch is empty
+ */
+double QuantileSketch::quantile(double fraction) const{
+    if (value_count == 0) {
+        return 0;
+    }
+    sort();
+    fraction = std::min(1.0, std::max(0.0, fraction));
+    //Ranks are counted from the start of the first value, so a value of
+    //rank i is centred on i + 0.5
+    double target = fraction * (value_count - 1) + 0.5;
+    double prev_rank = 0.5;
+    double prev_val = min_val;
+    double before = 0;
+    for (const Centroid &centroid : centroids) {
+        double rank = before + centroid.weight / 2;
+        if (target <= rank) {
+            if (rank <= prev_rank) {
+                return centroid.mean;
+            }
+            return prev_val + (target - prev_rank) / (rank - prev_rank)
+                * (centroid.mean - prev_val);
+        }
+        prev_rank = rank;
+        prev_val = centroid.mean;
+        before += centroid.weight;
+    }
+    double last_rank = value_count - 0.5;
+    if (last_rank <= prev_rank) {
+        return prev_val;
+    }
+    return prev_val + (target - prev_rank) / (last_rank - prev_rank)
+        * (max_val - prev_val);
+}
+
+/**
+ * Merge neighbouring centroids as long as each spans at most one unit of the
+ * scale function, leaving at most about QUANTILE_SKETCH_SIZE of them
+ */
+void QuantileSketch::compress(){
+    sort();
+    double total = value_count;
+    std::vector<Centroid> merged;
+    merged.reserve(2 * QUANTILE_SKETCH_SIZE + 1);
+    Centroid current = centroids[0];
+    double before = 0;
+    double low = scale(0);
+    for (size_t i = 1; i < centroids.size(); i++) {
+        const Centroid &next = centroids[i];
+        double weight = (double)current.weight + next.weight;
+        if (scale((before + weight) / total) - low <= 1) {
+            current.mean += (next.mean - (double)current.mean) * next.weight
+                / weight;
+            current.weight = weight;
+        } else {
+            merged.push_back(current);
+            before += current.weight;
+            low = scale(before / total);
+            current = next;
+        }
+    }
+    merged.push_back(current);
+    centroids.swap(merged);
+}
+
+/**
+ * Put the centroids in order of their means, if they are not already
+ */
+void QuantileSketch::sort() const{
+    if (!sorted) {
+        std::sort(centroids.begin(), centroids.end(),
+                [](const Centroid &a, const Centroid &b){
+                    return a.mean < b.mean;
+                });
+        sorted = true;
+    }
+}
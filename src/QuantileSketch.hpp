@@ -0,0 +1,57 @@
+// File name: QuantileSketch.hpp
+// Created on: 18-October-2026
+
+#ifndef QUANTILESKETCH_HPP_
+#define QUANTILESKETCH_HPP_
+
+#include <cstddef>
+#include <vector>
+
+// Centroids a sketch is compressed down to, it keeps every value exactly
+// until it holds twice as many
+#define QUANTILE_SKETCH_SIZE 64
+
+/**
+ * Quantiles of a stream of values in bounded memory. Values are kept exactly
+ * until there are more than 2 * QUANTILE_SKETCH_SIZE of them, then merged
+ * into weighted centroids as in the merging t-digest of Dunning, small near
+ * the tails and large near the median, so no more than about
+ * 2 * QUANTILE_SKETCH_SIZE centroids are ever held. Sketches of parts of the
+ * same values can be merged. Quantiles of an exact sketch are interpolated
+ * between the closest ranks, the same as R type 7 and numpy.
+ */
+class QuantileSketch{
+
+    public:
+        QuantileSketch();
+
+        void clear();
+        void add(float value);
+        void merge(const QuantileSketch &other);
+        double quantile(double fraction) const;
+
+        size_t count() const { return value_count; }
+        bool is_exact() const { return value_count == centroids.size(); }
+        size_t bytes() const {
+            return sizeof(QuantileSketch)
+                + centroids.capacity() * sizeof(Centroid);
+        }
+
+    private:
+        struct Centroid{
+            float mean;
+            float weight;
+        };
+
+        //Sorted by mean before quantiles are found
+        mutable std::vector<Centroid> centroids;
+        mutable bool sorted;
+        size_t value_count;
+        float min_val;
+        float max_val;
+
+        void compress();
+        void sort() const;
+};
+
+#endif /* QUANTILESKETCH_HPP_ */
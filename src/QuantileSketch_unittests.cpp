@@ -0,0 +1,105 @@
+// File name: QuantileSketch_unittests.cpp
+// Created on: 18-October-2026
+
+#include "QuantileSketch.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include "gtest/gtest.h"
+
+//Tests that a small sketch finds quantiles between the closest ranks
+TEST(QuantileSketchTest, exactSmall){
+    QuantileSketch sketch;
+    EXPECT_EQ(0u, sketch.count());
+    float values[] = {6, 2, 4, 4};
+    for (float value : values) {
+        sketch.add(value);
+    }
+    ASSERT_TRUE(sketch.is_exact());
+    EXPECT_EQ(4u, sketch.count());
+    EXPECT_EQ(4, sketch.quantile(0.5));
+    EXPECT_DOUBLE_EQ(2.6, sketch.quantile(0.1));
+    EXPECT_DOUBLE_EQ(3.5, sketch.quantile(0.25));
+    EXPECT_DOUBLE_EQ(5.88, sketch.quantile(0.98));
+    EXPECT_EQ(2, sketch.quantile(0));
+    EXPECT_EQ(6, sketch.quantile(1));
+
+    sketch.clear();
+    sketch.add(3);
+    EXPECT_EQ(3, sketch.quantile(0.1));
+    EXPECT_EQ(3, sketch.quantile(0.9));
+}
+
+//Tests that every value is kept until the sketch is full, with the same
+//quantiles as sorting them
+TEST(QuantileSketchTest, exactUntilFull){
+    QuantileSketch sketch;
+    std::vector<float> values;
+    srand(3);
+    for (int i = 0; i < 2 * QUANTILE_SKETCH_SIZE; i++) {
+        values.push_back(rand() % 1000 / 8.0);
+        sketch.add(values.back());
+    }
+    ASSERT_TRUE(sketch.is_exact());
+    std::sort(values.begin(), values.end());
+    for (double fraction : {0.1, 0.25, 0.5, 0.75, 0.9, 0.98}) {
+        double rank = fraction * (values.size() - 1);
+        size_t low = rank;
+        double expected = values[low] + (rank - low)
+            * (values[std::min(low + 1, values.size() - 1)] - values[low]);
+        EXPECT_NEAR(expected, sketch.quantile(fraction), 1e-9);
+    }
+    sketch.add(0);
+    EXPECT_FALSE(sketch.is_exact());
+}
+
+//Tests that a large sketch stays small and close to the true quantiles
+TEST(QuantileSketchTest, estimatedLarge){
+    QuantileSketch sketch;
+    std::vector<float> values;
+    const int count = 100000;
+    srand(5);
+    for (int i = 0; i < count; i++) {
+        //Skewed towards small values
+        float value = rand() % count;
+        values.push_back(value * value / count);
+        sketch.add(values.back());
+    }
+    EXPECT_EQ((size_t)count, sketch.count());
+    EXPECT_LE(sketch.bytes(), sizeof(QuantileSketch)
+            + (2 * QUANTILE_SKETCH_SIZE + 1) * 2 * sizeof(float));
+    //Within a percent of the range
+    std::sort(values.begin(), values.end());
+    for (double fraction : {0.1, 0.25, 0.5, 0.75, 0.9, 0.98}) {
+        EXPECT_NEAR(values[fraction * (count - 1)], sketch.quantile(fraction),
+                0.01 * count);
+    }
+    EXPECT_EQ(values.front(), sketch.quantile(0));
+    EXPECT_EQ(values.back(), sketch.quantile(1));
+}
+
+//Tests that sketches of parts of the values merge to one of all of them
+TEST(QuantileSketchTest, merge){
+    QuantileSketch low, high, empty;
+    for (int i = 0; i < 10; i++) {
+        low.add(i);
+        high.add(10 + i);
+    }
+    low.merge(empty);
+    low.merge(high);
+    ASSERT_TRUE(low.is_exact());
+    EXPECT_EQ(20u, low.count());
+    EXPECT_DOUBLE_EQ(9.5, low.quantile(0.5));
+
+    QuantileSketch whole, left, right;
+    srand(9);
+    for (int i = 0; i < 20000; i++) {
+        float value = rand() % 5000;
+        whole.add(value);
+        (i % 3 == 0 ? left : right).add(value);
+    }
+    left.merge(right);
+    EXPECT_EQ(whole.count(), left.count());
+    for (double fraction : {0.1, 0.5, 0.9}) {
+        EXPECT_NEAR(whole.quantile(fraction), left.quantile(fraction), 50);
+    }
+}
@@ -0,0 +1,363 @@
+// File name: RasterWriter.cpp
+// Created on: 18-October-2026
+
+#include "RasterWriter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+#include "CellMoments.hpp"
+#include "cpl_string.h"
+#include "spdlog/spdlog.h"
+
+/**
+ * @param gdal_ds the dataset to write to, every band of it is written
+ * @param options how the dataset was created, see
+ * LidarDriver::setup_gdal_ds
+ */
+RasterWriter::RasterWriter(GDALDataset *gdal_ds, const RasterOptions &options)
+    : gdal_ds(gdal_ds), options(options){
+    gdal_ds->GetRasterBand(1)->GetBlockSize(&block_width, &block_height);
+    if (block_width < 1) {
+        block_width = gdal_ds->GetRasterXSize();
+    }
+    if (block_height < 1) {
+        block_height = 1;
+    }
+    raster_height = gdal_ds->GetRasterYSize();
+    bands = gdal_ds->GetRasterCount();
+    int level_count = gdal_ds->GetRasterBand(1)->GetOverviewCount();
+    if (level_count > 0) {
+        overviews.assign(bands, OverviewBuilder(gdal_ds->GetRasterXSize(),
+                    raster_height, level_count));
+    }
+    block.first_row = 0;
+    block.rows = 0;
+    block.x_offset = 0;
+    block.width = 0;
+    ok = true;
+    queue = NULL;
+    if (options.write_memory > 0) {
+        //The widest block there can be
+        size_t block_bytes = sizeof(float) * bands * block_height
+            * gdal_ds->GetRasterXSize();
+        queue = new BoundedQueue<RasterBlock>(
+                options.write_memory / block_bytes);
+        writer_thread = std::thread(&RasterWriter::write_blocks, this);
+    }
+}
+
+RasterWriter::~RasterWriter(){
+    finish();
+}
+
+/**
+ * Add a row of values to every band, writing out the block it finishes
+ * @param row the row of the dataset
+ * @param x_offset the column of the dataset of the first value
+ * @param width the number of values
+ * @param values the values of the row of each band
+ */
+void RasterWriter::write_row(int row, int x_offset, int width,
+        const float *const *values){
+    //Only consecutive rows of the same columns are written together
+    if (block.rows > 0 && (row != block.first_row + block.rows ||
+                x_offset != block.x_offset || width != block.width)) {
+        flush();
+    }
+    if (block.rows == 0) {
+        block.first_row = row;
+        block.x_offset = x_offset;
+        block.width = width;
+        block.values.resize((size_t)bands * block_height * width);
+    }
+    for (int band = 0; band < bands; band++) {
+        size_t start = ((size_t)band * block_height + block.rows) * width;
+        std::copy(values[band], values[band] + width,
+                block.values.begin() + start);
+    }
+    block.rows++;
+    if ((row + 1) % block_height == 0 || row + 1 == raster_height) {
+        flush();
+    }
+}
+
+/**
+ * Write out the rows collected so far, or hand them to the writer's thread
+ * @return false if writing an earlier block failed
+ */
+bool RasterWriter::flush(){
+    if (block.rows == 0) {
+        return ok;
+    }
+    if (queue != NULL) {
+        queue->push(std::move(block));
+        block = RasterBlock();
+    } else {
+        write_block(block);
+    }
+    block.rows = 0;
+    return ok;
+}
+
+/**
+ * Write out the rows collected so far, wait for every block to be written,
+ * and write every row of the overviews still waiting on pixels that were
+ * never written
+ * @return false if writing the dataset failed
+ */
+bool RasterWriter::finish(){
+    flush();
+    if (queue != NULL) {
+        queue->close();
+        writer_thread.join();
+        delete queue;
+        queue = NULL;
+    }
+    for (OverviewBuilder &builder : overviews) {
+        builder.finish();
+    }
+    write_overviews();
+    return ok;
+}
+
+/**
+ * Write the blocks handed to the writer's thread until the queue is closed
+ */
+void RasterWriter::write_blocks(){
+    RasterBlock finished;
+    while (queue->pop(finished)) {
+        write_block(finished);
+    }
+}
+
+/**
+ * Write a block, leaving out the blocks of the dataset without data, and
+ * the overview rows it finishes
+ * @param block the rows of every band
+ */
+void RasterWriter::write_block(RasterBlock &block){
+    prepare_block(block);
+    bool int16 = options.int16_scale != 0;
+    char *data = int16 ? (char *) int16_rows.data() :
+        (char *) block.values.data();
+    int value_size = int16 ? sizeof(int16_t) : sizeof(float);
+    int block_end = block.x_offset + block.width;
+    //Blocks of the dataset without data are left unwritten, each run of
+    //blocks with data is written in one call
+    int run_start = -1;
+    int x = block.x_offset;
+    while (x < block_end) {
+        int tile_end = std::min((x / block_width + 1) * block_width,
+                block_end);
+        bool empty = is_empty(block, x - block.x_offset, tile_end - x);
+        if (!empty && run_start < 0) {
+            run_start = x;
+        }
+        if (run_start >= 0 && (empty || tile_end == block_end)) {
+            int run_end = empty ? x : tile_end;
+            // Refer to http://www.gdal.org/classGDALDataset.html
+            CPLErr retval = gdal_ds->RasterIO(GF_Write, run_start,
+                    block.first_row, run_end - run_start, block.rows,
+                    data + (size_t)(run_start - block.x_offset) * value_size,
+                    run_end - run_start, block.rows, data_type(options),
+                    bands, NULL, value_size, (long)value_size * block.width,
+                    (long)value_size * block.width * block_height, NULL);
+            if (retval != CE_None) {
+                spdlog::error("Error writing rows {} to {}", block.first_row,
+                        block.first_row + block.rows - 1);
+                ok = false;
+            }
+            run_start = -1;
+        }
+        x = tile_end;
+    }
+    write_overviews();
+}
+
+/**
+ * @param block the rows of every band
+ * @param start the first column of the block to look at
+ * @param count the number of columns to look at
+ * @return true if every band has no data in those columns of the block
+ */
+bool RasterWriter::is_empty(const RasterBlock &block, int start,
+        int count) const{
+    for (int band = 0; band < bands; band++) {
+        for (int row = 0; row < block.rows; row++) {
+            const float *values = block.values.data() +
+                ((size_t)band * block_height + row) * block.width + start;
+            for (int x = 0; x < count; x++) {
+                if (values[x] != (float) NO_DATA) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Encode a block and add it to the overviews, a band to each thread
+ * @param block the rows of every band
+ */
+void RasterWriter::prepare_block(RasterBlock &block){
+    bool int16 = options.int16_scale != 0;
+    if (!int16 && overviews.empty()) {
+        return;
+    }
+    if (int16) {
+        int16_rows.resize(block.values.size());
+    }
+    auto prepare_bands = [&](int first_band, int step){
+        for (int band = first_band; band < bands; band += step) {
+            size_t start = (size_t)band * block_height * block.width;
+            if (int16) {
+                size_t end = start + (size_t)block.rows * block.width;
+                for (size_t i = start; i < end; i++) {
+                    int16_rows[i] = encode(block.values[i], options);
+                }
+            }
+            if (!overviews.empty()) {
+                overviews[band].add_rows(block.first_row, block.rows,
+                        block.x_offset, block.width,
+                        block.values.data() + start);
+            }
+        }
+    };
+    int threads = std::min(options.threads, bands);
+    std::vector<std::thread> workers;
+    for (int thread = 1; thread < threads; thread++) {
+        workers.push_back(std::thread(prepare_bands, thread, threads));
+    }
+    prepare_bands(0, std::max(threads, 1));
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Write every finished row of the overviews of each band
+ */
+void RasterWriter::write_overviews(){
+    std::vector<int16_t> encoded;
+    for (int band = 0; band < (int)overviews.size(); band++) {
+        GDALRasterBand *gdal_band = gdal_ds->GetRasterBand(band + 1);
+        for (OverviewRow &row : overviews[band].finished_rows()) {
+            if (std::all_of(row.values.begin(), row.values.end(),
+                        [](float value){ return value == (float) NO_DATA; })) {
+                continue;
+            }
+            void *data = row.values.data();
+            if (options.int16_scale != 0) {
+                encoded.resize(row.values.size());
+                for (size_t x = 0; x < row.values.size(); x++) {
+                    encoded[x] = encode(row.values[x], options);
+                }
+                data = encoded.data();
+            }
+            CPLErr retval = gdal_band->GetOverview(row.level - 1)->RasterIO(
+                    GF_Write, 0, row.row, row.values.size(), 1, data,
+                    row.values.size(), 1, data_type(options), 0, 0, NULL);
+            if (retval != CE_None) {
+                spdlog::error("Error writing row {} of overview {}", row.row,
+                        row.level);
+                ok = false;
+            }
+        }
+        overviews[band].finished_rows().clear();
+    }
+}
+
+/**
+ * @param options the layout and encoding of a product
+ * @param band_count the number of products in the dataset
+ * @return GTiff creation options for the dataset, free with CSLDestroy
+ */
+char** RasterWriter::creation_options(const RasterOptions &options,
+        int band_count){
+    char **create_opts = NULL;
+    if (options.tile_size > 0) {
+        std::string tile_size = std::to_string(options.tile_size);
+        create_opts = CSLSetNameValue(create_opts, "TILED", "YES");
+        create_opts = CSLSetNameValue(create_opts, "BLOCKXSIZE",
+                tile_size.c_str());
+        create_opts = CSLSetNameValue(create_opts, "BLOCKYSIZE",
+                tile_size.c_str());
+    }
+    if (options.compression != "NONE") {
+        create_opts = CSLSetNameValue(create_opts, "COMPRESS",
+                options.compression.c_str());
+        //Floating point predictor for Float32, horizontal for Int16
+        create_opts = CSLSetNameValue(create_opts, "PREDICTOR",
+                options.int16_scale != 0 ? "2" : "3");
+        if (options.threads > 1) {
+            create_opts = CSLSetNameValue(create_opts, "NUM_THREADS",
+                    std::to_string(options.threads).c_str());
+        }
+    }
+    //Each band is tiled on its own, so a product reads back without the
+    //others
+    if (band_count > 1) {
+        create_opts = CSLSetNameValue(create_opts, "INTERLEAVE", "BAND");
+    }
+    //Blocks never written are left out of the file, reading back as no data
+    create_opts = CSLSetNameValue(create_opts, "SPARSE_OK", "TRUE");
+    create_opts = CSLSetNameValue(create_opts, "BIGTIFF", "IF_SAFER");
+    return create_opts;
+}
+
+/**
+ * Give every band of a dataset that has not been written to yet empty
+ * internal overviews, halving it until it fits in a tile
+ * @param gdal_ds the new dataset
+ * @param options the layout of the dataset
+ * @return the result of creating the overviews
+ */
+CPLErr RasterWriter::create_overviews(GDALDataset *gdal_ds,
+        const RasterOptions &options){
+    int tile_size = options.tile_size > 0 ? options.tile_size :
+        RASTER_TILE_SIZE;
+    int level_count = OverviewBuilder::count_levels(
+            gdal_ds->GetRasterXSize(), gdal_ds->GetRasterYSize(), tile_size);
+    if (level_count == 0) {
+        return CE_None;
+    }
+    std::vector<int> factors;
+    for (int level = 1; level <= level_count; level++) {
+        factors.push_back(1 << level);
+    }
+    //NONE only creates the overviews, RasterWriter fills them in
+    return gdal_ds->BuildOverviews("NONE", level_count, factors.data(), 0,
+            NULL, NULL, NULL);
+}
+
+/**
+ * @param options the layout and encoding of a product
+ * @return the type the product is stored as
+ */
+GDALDataType RasterWriter::data_type(const RasterOptions &options){
+    return options.int16_scale != 0 ? GDT_Int16 : GDT_Float32;
+}
+
+/**
+ * @param value a value of a product
+ * @param options the scale and offset of the Int16 encoding
+ * @return the value as a count of int16_scale from int16_offset, clamped to
+ * the range of Int16, RASTER_INT16_NO_DATA for NO_DATA
+ */
+int16_t RasterWriter::encode(float value, const RasterOptions &options){
+    if (value == (float) NO_DATA || !std::isfinite(value)) {
+        return RASTER_INT16_NO_DATA;
+    }
+    double scaled = std::round((value - options.int16_offset)
+            / options.int16_scale);
+    if (scaled > INT16_MAX) {
+        return INT16_MAX;
+    }
+    //The lowest value is kept for no data
+    if (scaled <= RASTER_INT16_NO_DATA) {
+        return RASTER_INT16_NO_DATA + 1;
+    }
+    return (int16_t) scaled;
+}
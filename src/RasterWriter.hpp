@@ -0,0 +1,121 @@
+// File name: RasterWriter.hpp
+// Created on: 18-October-2026
+
+#ifndef RASTERWRITER_HPP_
+#define RASTERWRITER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gdal_priv.h"
+#include "BoundedQueue.hpp"
+#include "OverviewBuilder.hpp"
+
+// Default number of pixels along each side of a tile of a product
+#define RASTER_TILE_SIZE 256
+// Value an Int16 product is given where there is no data
+#define RASTER_INT16_NO_DATA -32768
+// Default bytes of finished blocks waiting to be written, 64 MB
+#define RASTER_WRITE_MEMORY (64 << 20)
+
+//How products are laid out and encoded on disk
+struct RasterOptions{
+    //Pixels along each side of a tile, 0 writes strips instead
+    int tile_size = RASTER_TILE_SIZE;
+    //GTiff compression, NONE, DEFLATE, LZW or ZSTD
+    std::string compression = "DEFLATE";
+    //Threads compressing the blocks of each product
+    int threads = 1;
+    //If not 0, products are stored as Int16 values of this size each, from
+    //int16_offset, instead of as Float32
+    double int16_scale = 0;
+    double int16_offset = 0;
+    //Give each product internal overviews, halving it until it fits in a
+    //tile, built from the rows as they are written
+    bool overviews = false;
+    //Bytes of finished blocks allowed to wait for a thread of their own to
+    //write them, 0 writes each block on the thread that finished it
+    size_t write_memory = RASTER_WRITE_MEMORY;
+};
+
+//Rows of every band collected to be written together
+struct RasterBlock{
+    int first_row;
+    int rows;
+    int x_offset;
+    int width;
+    //Rows of each band, block_height * width values apart
+    std::vector<float> values;
+};
+
+/**
+ * Collects the rows of the products of a dataset, one product to a band, and
+ * writes them in blocks that line up with the blocks of the dataset, so each
+ * tile is compressed once, whole, instead of being rewritten for every row.
+ * The block of every band is written in a single call. Rows must be written
+ * top down; a block is written as soon as its last row is added, or on flush.
+ * Blocks of the dataset holding only NO_DATA are not written at all, so the
+ * empty parts of a flight line's bounding box take no space in the file.
+ * If the dataset has overviews, each block is also added to the overviews of
+ * its band, the bands on as many threads as the products are compressed on,
+ * and every row of an overview is written as soon as it is finished.
+ * Unless write_memory is 0, finished blocks are handed to a thread of the
+ * writer's own, so the next rows are computed while earlier ones are
+ * compressed and written; write_row only waits once write_memory bytes of
+ * blocks are queued.
+ */
+class RasterWriter{
+
+    public:
+        RasterWriter(GDALDataset *gdal_ds,
+                const RasterOptions &options = RasterOptions());
+        ~RasterWriter();
+        RasterWriter(const RasterWriter &) = delete;
+        RasterWriter& operator=(const RasterWriter &) = delete;
+
+        void write_row(int row, int x_offset, int width,
+                const float *const *values);
+        void write_row(int row, int x_offset, int width, const float *values){
+            write_row(row, x_offset, width, &values);
+        }
+        bool flush();
+        bool finish();
+        bool is_ok() const { return ok.load(); }
+        int band_count() const { return bands; }
+
+        static char** creation_options(const RasterOptions &options,
+                int band_count = 1);
+        static GDALDataType data_type(const RasterOptions &options);
+        static CPLErr create_overviews(GDALDataset *gdal_ds,
+                const RasterOptions &options);
+        static int16_t encode(float value, const RasterOptions &options);
+
+    private:
+        GDALDataset *gdal_ds;
+        RasterOptions options;
+        int bands;
+        int block_width;
+        int block_height;
+        int raster_height;
+        //The rows collected but not yet written
+        RasterBlock block;
+        //Blocks waiting for writer_thread, NULL if blocks are written by
+        //flush
+        BoundedQueue<RasterBlock> *queue;
+        std::thread writer_thread;
+        //Everything below is used only by the thread writing blocks
+        std::vector<int16_t> int16_rows;
+        //The overviews of each band, empty if the dataset has none
+        std::vector<OverviewBuilder> overviews;
+        std::atomic<bool> ok;
+
+        void write_blocks();
+        void write_block(RasterBlock &block);
+        bool is_empty(const RasterBlock &block, int start, int count) const;
+        void prepare_block(RasterBlock &block);
+        void write_overviews();
+};
+
+#endif /* RASTERWRITER_HPP_ */
@@ -0,0 +1,241 @@
+// File name: RasterWriter_unittests.cpp
+// Created on: 18-October-2026
+
+#include "RasterWriter.hpp"
+#include "CellMoments.hpp"
+#include "cpl_string.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class RasterWriterTest : public testing::Test {
+    protected:
+        const char *filename = "do_not_use_raster.tif";
+        GDALDriver *tiff_driver;
+
+        void SetUp(){
+            GDALAllRegister();
+            tiff_driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+        }
+
+        void TearDown(){
+            std::remove(filename);
+        }
+
+        GDALDataset* create(int width, int height,
+                const RasterOptions &options){
+            char **create_opts = RasterWriter::creation_options(options);
+            GDALDataset *gdal_ds = tiff_driver->Create(filename, width, height,
+                    1, RasterWriter::data_type(options), create_opts);
+            CSLDestroy(create_opts);
+            return gdal_ds;
+        }
+};
+
+//Tests the creation options of each layout
+TEST_F(RasterWriterTest, creationOptions){
+    RasterOptions options;
+    options.threads = 4;
+    char **create_opts = RasterWriter::creation_options(options);
+    EXPECT_STREQ("YES", CSLFetchNameValue(create_opts, "TILED"));
+    EXPECT_STREQ("256", CSLFetchNameValue(create_opts, "BLOCKXSIZE"));
+    EXPECT_STREQ("DEFLATE", CSLFetchNameValue(create_opts, "COMPRESS"));
+    EXPECT_STREQ("3", CSLFetchNameValue(create_opts, "PREDICTOR"));
+    EXPECT_STREQ("4", CSLFetchNameValue(create_opts, "NUM_THREADS"));
+    EXPECT_STREQ("TRUE", CSLFetchNameValue(create_opts, "SPARSE_OK"));
+    CSLDestroy(create_opts);
+    EXPECT_EQ(GDT_Float32, RasterWriter::data_type(options));
+
+    options.tile_size = 0;
+    options.compression = "NONE";
+    options.int16_scale = 0.01;
+    create_opts = RasterWriter::creation_options(options);
+    EXPECT_EQ(NULL, CSLFetchNameValue(create_opts, "TILED"));
+    EXPECT_EQ(NULL, CSLFetchNameValue(create_opts, "COMPRESS"));
+    CSLDestroy(create_opts);
+    EXPECT_EQ(GDT_Int16, RasterWriter::data_type(options));
+}
+
+//Tests the scaled Int16 encoding
+TEST_F(RasterWriterTest, encode){
+    RasterOptions options;
+    options.int16_scale = 0.5;
+    options.int16_offset = 1000;
+    EXPECT_EQ(0, RasterWriter::encode(1000, options));
+    EXPECT_EQ(5, RasterWriter::encode(1002.6, options));
+    EXPECT_EQ(-4, RasterWriter::encode(998, options));
+    EXPECT_EQ(RASTER_INT16_NO_DATA, RasterWriter::encode(NO_DATA, options));
+    EXPECT_EQ(INT16_MAX, RasterWriter::encode(1e9, options));
+    EXPECT_EQ(RASTER_INT16_NO_DATA + 1, RasterWriter::encode(-1e9, options));
+}
+
+//Tests that rows written in windows and blocks read back in place
+TEST_F(RasterWriterTest, writeRows){
+    RasterOptions options;
+    options.tile_size = 16;
+    GDALDataset *gdal_ds = create(40, 40, options);
+    ASSERT_TRUE(gdal_ds != NULL);
+    {
+        RasterWriter writer(gdal_ds, options);
+        float values[40];
+        //Two windows side by side, each written top down
+        for (int window = 0; window < 2; window++) {
+            for (int row = 0; row < 40; row++) {
+                for (int x = 0; x < 20; x++) {
+                    values[x] = row * 100 + window * 20 + x;
+                }
+                writer.write_row(row, window * 20, 20, values);
+            }
+        }
+        EXPECT_TRUE(writer.flush());
+    }
+
+    std::vector<float> read(40 * 40);
+    ASSERT_EQ(CE_None, gdal_ds->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, 40,
+                40, read.data(), 40, 40, GDT_Float32, 0, 0, NULL));
+    for (int row = 0; row < 40; row++) {
+        for (int x = 0; x < 40; x++) {
+            ASSERT_EQ(row * 100 + x, read[row * 40 + x]);
+        }
+    }
+    GDALClose((GDALDatasetH) gdal_ds);
+}
+
+//Tests that Int16 products read back within half a step
+TEST_F(RasterWriterTest, writeInt16){
+    RasterOptions options;
+    options.compression = "LZW";
+    options.int16_scale = 0.25;
+    GDALDataset *gdal_ds = create(8, 3, options);
+    ASSERT_TRUE(gdal_ds != NULL);
+    {
+        RasterWriter writer(gdal_ds, options);
+        for (int row = 0; row < 3; row++) {
+            float values[8];
+            for (int x = 0; x < 8; x++) {
+                values[x] = x == 7 ? NO_DATA : row + x * 0.3;
+            }
+            writer.write_row(row, 0, 8, values);
+        }
+    }
+
+    int16_t read[3 * 8];
+    ASSERT_EQ(CE_None, gdal_ds->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, 8, 3,
+                read, 8, 3, GDT_Int16, 0, 0, NULL));
+    for (int row = 0; row < 3; row++) {
+        for (int x = 0; x < 7; x++) {
+            EXPECT_NEAR(row + x * 0.3, read[row * 8 + x] * 0.25, 0.125);
+        }
+        EXPECT_EQ(RASTER_INT16_NO_DATA, read[row * 8 + 7]);
+    }
+    GDALClose((GDALDatasetH) gdal_ds);
+}
+
+//Tests that the products of a dataset are written one to each band
+TEST_F(RasterWriterTest, writeBands){
+    RasterOptions options;
+    options.tile_size = 16;
+    char **create_opts = RasterWriter::creation_options(options, 3);
+    EXPECT_STREQ("BAND", CSLFetchNameValue(create_opts, "INTERLEAVE"));
+    GDALDataset *gdal_ds = tiff_driver->Create(filename, 20, 20, 3,
+            GDT_Float32, create_opts);
+    CSLDestroy(create_opts);
+    ASSERT_TRUE(gdal_ds != NULL);
+    {
+        RasterWriter writer(gdal_ds, options);
+        ASSERT_EQ(3, writer.band_count());
+        std::vector<float> bands[3];
+        for (int row = 0; row < 20; row++) {
+            const float *rows[3];
+            for (int band = 0; band < 3; band++) {
+                bands[band].assign(20, band * 1000 + row);
+                rows[band] = bands[band].data();
+            }
+            writer.write_row(row, 0, 20, rows);
+        }
+    }
+
+    std::vector<float> read(20 * 20);
+    for (int band = 0; band < 3; band++) {
+        ASSERT_EQ(CE_None, gdal_ds->GetRasterBand(band + 1)->RasterIO(GF_Read,
+                    0, 0, 20, 20, read.data(), 20, 20, GDT_Float32, 0, 0,
+                    NULL));
+        for (int row = 0; row < 20; row++) {
+            EXPECT_EQ(band * 1000 + row, read[row * 20 + 19]);
+        }
+    }
+    GDALClose((GDALDatasetH) gdal_ds);
+}
+
+//Tests that the overviews are filled in as the rows are written
+TEST_F(RasterWriterTest, writeOverviews){
+    RasterOptions options;
+    options.tile_size = 16;
+    options.overviews = true;
+    GDALDataset *gdal_ds = create(40, 40, options);
+    ASSERT_TRUE(gdal_ds != NULL);
+    ASSERT_EQ(CE_None, RasterWriter::create_overviews(gdal_ds, options));
+    ASSERT_EQ(2, gdal_ds->GetRasterBand(1)->GetOverviewCount());
+    {
+        RasterWriter writer(gdal_ds, options);
+        float values[40];
+        for (int row = 0; row < 40; row++) {
+            for (int x = 0; x < 40; x++) {
+                values[x] = x < 20 ? row : NO_DATA;
+            }
+            writer.write_row(row, 0, 40, values);
+        }
+        EXPECT_TRUE(writer.finish());
+    }
+
+    //The blocks of the right half were never written
+    std::vector<float> product(40 * 40);
+    ASSERT_EQ(CE_None, gdal_ds->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, 40,
+                40, product.data(), 40, 40, GDT_Float32, 0, 0, NULL));
+    EXPECT_EQ(39, product[39 * 40]);
+    EXPECT_EQ(NO_DATA, product[39 * 40 + 39]);
+
+    GDALRasterBand *overview = gdal_ds->GetRasterBand(1)->GetOverview(0);
+    ASSERT_EQ(20, overview->GetXSize());
+    std::vector<float> read(20 * 20);
+    ASSERT_EQ(CE_None, overview->RasterIO(GF_Read, 0, 0, 20, 20, read.data(),
+                20, 20, GDT_Float32, 0, 0, NULL));
+    for (int row = 0; row < 20; row++) {
+        EXPECT_EQ(row * 2 + 0.5, read[row * 20]);
+        EXPECT_EQ(NO_DATA, read[row * 20 + 19]);
+    }
+    GDALClose((GDALDatasetH) gdal_ds);
+}
+
+//Tests that blocks written in the background and on the calling thread read
+//back the same
+TEST_F(RasterWriterTest, backgroundWrites){
+    for (size_t write_memory : {(size_t) 0, (size_t) 1}) {
+        RasterOptions options;
+        options.tile_size = 16;
+        //Room for a single waiting block
+        options.write_memory = write_memory;
+        GDALDataset *gdal_ds = create(40, 40, options);
+        ASSERT_TRUE(gdal_ds != NULL);
+        {
+            RasterWriter writer(gdal_ds, options);
+            float values[40];
+            for (int row = 0; row < 40; row++) {
+                for (int x = 0; x < 40; x++) {
+                    values[x] = row * 100 + x;
+                }
+                writer.write_row(row, 0, 40, values);
+            }
+            EXPECT_TRUE(writer.finish());
+        }
+
+        std::vector<float> read(40 * 40);
+        ASSERT_EQ(CE_None, gdal_ds->GetRasterBand(1)->RasterIO(GF_Read, 0, 0,
+                    40, 40, read.data(), 40, 40, GDT_Float32, 0, 0, NULL));
+        for (int row = 0; row < 40; row++) {
+            for (int x = 0; x < 40; x++) {
+                ASSERT_EQ(row * 100 + x, read[row * 40 + x]);
+            }
+        }
+        GDALClose((GDALDatasetH) gdal_ds);
+    }
+}
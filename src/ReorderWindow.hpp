@@ -0,0 +1,51 @@
+// File name: ReorderWindow.hpp
+// Created on: 18-October-2026
+
+#ifndef REORDERWINDOW_HPP_
+#define REORDERWINDOW_HPP_
+
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * Limits how far ahead of the consumer the stages of a threaded pipeline may
+ * get when items are numbered in order but finish out of order. A producer
+ * waits before handing on item seq until it is within size items of the
+ * next one the consumer needs, so at most size items are ever held waiting
+ * for their turn. Items must be taken in increasing order, then the one the
+ * consumer needs is never the one waiting and the pipeline can't stall.
+ */
+class ReorderWindow{
+
+    public:
+        explicit ReorderWindow(long size)
+            : size(size > 0 ? size : 1), next(0) {}
+
+        /**
+         * Wait until an item is close enough to the consumer to be handed on
+         * @param seq the number of the item
+         */
+        void wait(long seq){
+            std::unique_lock<std::mutex> lock(mtx);
+            in_window.wait(lock, [this, seq]{
+                return seq < next + size;
+            });
+        }
+
+        /**
+         * The consumer is done with the next item, let the ones after it in
+         */
+        void advance(){
+            std::lock_guard<std::mutex> lock(mtx);
+            next++;
+            in_window.notify_all();
+        }
+
+    private:
+        long size;
+        long next;
+        std::mutex mtx;
+        std::condition_variable in_window;
+};
+
+#endif /* REORDERWINDOW_HPP_ */
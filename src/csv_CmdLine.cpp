@@ -4,6 +4,7 @@
 
 
 #include "csv_CmdLine.hpp"
+#include "PeakStore.hpp"
 
 using namespace std;
 
@@ -38,6 +39,8 @@ csv_CmdLine::file_type csv_CmdLine::get_file_type (std::string &f_name) {
         return pls;
     } else if (file_ext == ".txt") {
         return txt;
+    } else if (file_ext == PEAK_STORE_EXTENSION) {
+        return peaks;
     } else {
         return other;
     }
@@ -62,6 +65,10 @@ void csv_CmdLine::setInputFileName(char *args){
             is_txt = true;
             check_input_txt_exists();
             break;
+        case peaks:
+            is_peak_store = true;
+            check_input_txt_exists();
+            break;
         case other:
         default:
             if (!quiet) std::cerr << "Not a supported filetype" << std::endl;
@@ -83,13 +90,26 @@ void csv_CmdLine::setUsageMessage()
     buffer << std::endl;
     buffer << "Options:  " << std::endl;
     buffer << "       -f  <path to pls/txt file>"
-        << "  :Reads pls file for peak data" << std::endl;
+        << "  :Reads pls file for peak data, or the peaks of a peak store"
+        << " ending in " << PEAK_STORE_EXTENSION << ", written grouped by"
+        << " where they are instead of in pulse order" << std::endl;
     buffer << "       -d"
         << "  :Disables gaussian fitter, using first diff method instead" << std::endl;
     buffer << "       -h"
         << "  :Prints this help message" << std::endl;
     buffer << "       -n  <level>"
         << "  :Sets the noise level. Defaults to 6.\n";
+    buffer << "       -g  <fitter>"
+        << "  :Sets the gaussian fitting solver, 'gsl' or 'native'. Defaults to gsl."
+        << std::endl;
+    buffer << "       -t  <threads>"
+        << "  :Sets the number of threads used to fit pulses. Defaults to 1."
+        << std::endl;
+    buffer << "       --mmap"
+        << "  :Reads the pls and wvs files by memory mapping them" << std::endl;
+    buffer << "       -b  <kilobytes>"
+        << "  :Sets the csv buffer size per product. Defaults to 1024."
+        << std::endl;
     buffer << "       -p "
         << "  :Writes peak data to CSV" << std::endl;
     buffer << "       -l "
@@ -135,6 +155,7 @@ std::string csv_CmdLine::getUsageMessage(){
 csv_CmdLine::csv_CmdLine(){
     quiet = false;
     is_txt = false;
+    is_peak_store = false;
     printUsageMessage = false;
     useGaussianFitting = true;
     log_diagnostics = false;
@@ -185,6 +206,10 @@ bool csv_CmdLine::parse_args(int argc,char *argv[]){
         {"firstdiff", no_argument, NULL, 'd'},
         {"peaks", required_argument,NULL,'p'},
         {"log-diag", no_argument, NULL, 'l'},
+        {"threads", required_argument, NULL, 't'},
+        {"fitter", required_argument, NULL, 'g'},
+        {"mmap", no_argument, NULL, 'M'},
+        {"buffer_size", required_argument, NULL, 'b'},
         {0, 0, 0, 0}
     };
 
@@ -194,7 +219,7 @@ bool csv_CmdLine::parse_args(int argc,char *argv[]){
      * ":hf:s:" indicate that option 'h' is without arguments while
      * option 'f' and 's' require arguments
      */
-    while((optionChar = getopt_long (argc, argv, "-:hdf:n:p:l",
+    while((optionChar = getopt_long (argc, argv, "-:hdf:n:p:lt:b:g:",
                     long_options, &option_index))!= -1){
         if (optionChar == 'f') { //Set the filename to parse
             fArg = optarg;
@@ -213,6 +238,48 @@ bool csv_CmdLine::parse_args(int argc,char *argv[]){
                 msgs.push_back("Cannot fit noise level in type int. Error: " + std::string(e.what()));
                 printUsageMessage = true;
             }
+        } else if (optionChar == 't'){
+            try{
+                num_threads = std::stoi(optarg);
+                if (num_threads < 1){
+                    msgs.push_back("Number of threads must be at least 1");
+                    printUsageMessage = true;
+                }
+            }catch(const std::invalid_argument& e){
+                msgs.push_back("Cannot convert number of threads to int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }catch(const std::out_of_range& e){
+                msgs.push_back("Cannot fit number of threads in type int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'b'){
+            try{
+                int size = std::stoi(optarg);
+                if (size < 1){
+                    msgs.push_back("Buffer size must be at least 1 kilobyte");
+                    printUsageMessage = true;
+                } else {
+                    buffer_size = size;
+                }
+            }catch(const std::invalid_argument& e){
+                msgs.push_back("Cannot convert buffer size to int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }catch(const std::out_of_range& e){
+                msgs.push_back("Cannot fit buffer size in type int. Error: " + std::string(e.what()));
+                printUsageMessage = true;
+            }
+        } else if (optionChar == 'M'){ //Long option only
+            use_mmap = true;
+        } else if (optionChar == 'g'){
+            std::string engine(optarg);
+            if (engine == "gsl"){
+                fitter_engine = Fitter::Engine::GSL;
+            } else if (engine == "native"){
+                fitter_engine = Fitter::Engine::Native;
+            } else {
+                msgs.push_back("Invalid fitter: " + engine);
+                printUsageMessage = true;
+            }
         } else if (optionChar == 'l') {//Sets log_diagnostics
             log_diagnostics = true;
         } else if (optionChar == 'p') {
@@ -15,6 +15,7 @@
 #include <cstring>
 #include <stdexcept>
 #include <stdlib.h>
+#include "Fitter.hpp"
 
 class csv_CmdLine{
 
@@ -43,17 +44,33 @@ public:
     //Default noise level
     int noise_level = 6;
 
+    //Number of threads used to fit pulses, 1 fits on the calling thread
+    int num_threads = 1;
+
+    //Solver used for gaussian fitting
+    Fitter::Engine fitter_engine = Fitter::Engine::GSL;
+
+    //Read the input by memory mapping it instead of through PulseWaves
+    bool use_mmap = false;
+
+    //Kilobytes of csv text buffered per product before writing to disk
+    size_t buffer_size = 1024;
+
     // True stifles all output statements
     bool quiet;
 
     // True means input file was a txt file
     bool is_txt;
 
+    // True means input file was a peak store written by geotiff-driver
+    // --emit-peaks, so the peaks are read instead of fitted
+    bool is_peak_store;
+
     // True means we're gonna print a lot of extra diagnostic info
     bool log_diagnostics;
 
     // Used to communicate filetype efficiently between functions
-    enum file_type { pls, txt, other };
+    enum file_type { pls, txt, peaks, other };
 
     csv_CmdLine();
 
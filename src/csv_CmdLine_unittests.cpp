@@ -97,6 +97,12 @@ TEST_F(csv_CmdLineTest, get_file_type_txt) {
     ASSERT_EQ(csv_CmdLine::txt, cmd.get_file_type(file_name));
 }
 
+// Tests that passing file with peak store extension returns peaks
+TEST_F(csv_CmdLineTest, get_file_type_peaks) {
+    std::string file_name = "what.peaks";
+    ASSERT_EQ(csv_CmdLine::peaks, cmd.get_file_type(file_name));
+}
+
 // Tests that passing file with wvs extension returns other
 TEST_F(csv_CmdLineTest, get_file_type_wvs) {
     std::string file_name = "what.wvs";
@@ -152,6 +158,23 @@ TEST_F(csv_CmdLineTest, set_input_filename_txt) {
     ASSERT_FALSE(cmd.printUsageMessage);
 }
 
+// Tests that passing existing peak store:
+//   Sets is_peak_store to true without needing a wvs file
+//   usage message will not print
+TEST_F(csv_CmdLineTest, set_input_filename_peaks) {
+    char name[20];
+    strncpy(name, "do_not_use.peaks", 17);
+    std::ofstream store (name);
+    store.close();
+    std::remove("do_not_use.wvs");
+
+    ASSERT_NO_THROW(cmd.setInputFileName(name));
+    EXPECT_TRUE(cmd.is_peak_store);
+    EXPECT_FALSE(cmd.is_txt);
+    EXPECT_FALSE(cmd.printUsageMessage);
+    std::remove(name);
+}
+
 // Tests that passing existing invalid filetype:
 //   usage message will print
 TEST_F(csv_CmdLineTest, set_input_filename_invalid_filetype) {
@@ -537,6 +560,34 @@ TEST_F(csv_CmdLineTest, invalidLongOption){
     ASSERT_TRUE(cmd.printUsageMessage);
 }
 
+//Tests the number of fitting threads option
+TEST_F(csv_CmdLineTest, validThreadsOption){
+    //Defaults to fitting on a single thread
+    optind = 0;
+    numberOfArgs = 5;
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd.printUsageMessage);
+    EXPECT_EQ(1, cmd.num_threads);
+
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"--threads",10);
+    strncpy(commonArgSpace[6],"4",2);
+    ASSERT_NO_THROW(cmd2.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_FALSE(cmd2.printUsageMessage);
+    EXPECT_EQ(4, cmd2.num_threads);
+}
+
+//Tests invalid numbers of fitting threads
+TEST_F(csv_CmdLineTest, invalidThreadsOption){
+    optind = 0;
+    numberOfArgs = 7;
+    strncpy(commonArgSpace[5],"-t",3);
+    strncpy(commonArgSpace[6],"-2",3);
+    ASSERT_NO_THROW(cmd.parse_args(numberOfArgs,commonArgSpace));
+    ASSERT_TRUE(cmd.printUsageMessage);
+}
+
 /****************************************************************************
  *
  * Output filename tests
@@ -3,6 +3,7 @@
 // Author: Ravi, Ahmad, Spencer
 
 #include "LidarDriver.hpp"
+#include <algorithm>
 #include <chrono>
 
 // Activity level must be defined before spdlog is included.
@@ -24,7 +25,6 @@ int main (int argc, char *argv[]) {
     LidarDriver driver; //driver object with tools
     CmdLine cmdLineArgs; //command line options
     FlightLineData rawData; //the raw data read from PLS + WVS files
-    LidarVolume intermediateData; //the parsed data from the LIDAR waveforms
 
     // Parse and validate the command line args
     if(!cmdLineArgs.parse_args(argc,argv)){
@@ -51,20 +51,69 @@ int main (int argc, char *argv[]) {
 
     spdlog::info("Processing {}", cmdLineArgs.getInputFileName(true));
 
-    //ingest the raw flight data into an object
-    if (rawData.setFlightLineData(cmdLineArgs.getInputFileName(true))) {
-        return 1;
+    //ingest the raw flight data into an object, or the peaks already fitted
+    //from it
+    PeakStoreReader peakStore;
+    if (cmdLineArgs.is_peak_store) {
+        if (!peakStore.open(cmdLineArgs.getInputFileName(true))) {
+            return 1;
+        }
+        //only process the area of interest
+        if (cmdLineArgs.use_bbox && !peakStore.setWindow(
+                    cmdLineArgs.bbox_x_min, cmdLineArgs.bbox_y_min,
+                    cmdLineArgs.bbox_x_max, cmdLineArgs.bbox_y_max)) {
+            return 1;
+        }
+        const PeakStoreInfo &info = peakStore.info();
+        rawData.bb_x_min = info.bb_x_min;
+        rawData.bb_x_max = info.bb_x_max;
+        rawData.bb_y_min = info.bb_y_min;
+        rawData.bb_y_max = info.bb_y_max;
+        rawData.bb_z_min = info.bb_z_min;
+        rawData.bb_z_max = info.bb_z_max;
+        rawData.utm = info.utm;
+        rawData.geog_cs = info.geog_cs;
+        //the products are named after how the peaks were fitted
+        cmdLineArgs.useGaussianFitting = info.gaussian;
+    } else {
+        if (rawData.setFlightLineData(cmdLineArgs.getInputFileName(true),
+                    cmdLineArgs.use_mmap)) {
+            return 1;
+        }
+
+        //only process the area of interest
+        if (cmdLineArgs.use_bbox && !rawData.setWindow(cmdLineArgs.bbox_x_min,
+                    cmdLineArgs.bbox_y_min, cmdLineArgs.bbox_x_max,
+                    cmdLineArgs.bbox_y_max)) {
+            return 1;
+        }
     }
 
     spdlog::debug("driver.setup_flight_data returned");
 
     //calculate size in memory of the tif products
-    driver.calc_product_size(rawData, cmdLineArgs.selected_products.size());
+    driver.calc_product_size(rawData, cmdLineArgs.selected_products.size(),
+            cmdLineArgs.resolutions[0]);
 
     spdlog::debug("driver.calc_product_size_returned");
 
-    //fit data
-    driver.fit_data(rawData, intermediateData, cmdLineArgs);
+    //fit data once, into a volume for each resolution
+    std::vector<LidarVolume> volumes(cmdLineArgs.resolutions.size());
+    std::vector<LidarVolume*> fitted_volumes;
+    for (LidarVolume &volume : volumes) {
+        fitted_volumes.push_back(&volume);
+    }
+    if (cmdLineArgs.is_peak_store) {
+        if (!driver.load_peaks(rawData, peakStore, fitted_volumes,
+                    cmdLineArgs)) {
+            spdlog::critical("Unable to read the peak store {}",
+                    cmdLineArgs.getInputFileName(true));
+            return 1;
+        }
+        peakStore.close();
+    } else {
+        driver.fit_data(rawData, fitted_volumes, cmdLineArgs);
+    }
 
     spdlog::debug("driver.fit_data returned");
 
@@ -73,35 +122,94 @@ int main (int argc, char *argv[]) {
 
     spdlog::debug("driver.fit_data returned, will loop through products next.");
 
-    // TODO: None of this should be in main - it should be abstracted away
-    //produce the product(s)
-    for(const int& prod : cmdLineArgs.selected_products){
-        std::cout << "Writing GeoTIFF "<< cmdLineArgs.get_product_desc(prod) 
-            << std::endl;
-        //represents the tiff file
-        GDALDataset *gdal_ds;
-        //Setup gdal dataset for this product
-        gdal_ds = driver.setup_gdal_ds(driverTiff, 
-                cmdLineArgs.get_output_filename(prod).c_str(),
-                cmdLineArgs.get_product_desc(prod),
-                intermediateData.x_idx_extent,
-                intermediateData.y_idx_extent);
-
-        //orient the tiff correctly
-        driver.geo_orient_gdal(intermediateData,gdal_ds,
-                rawData.geog_cs, rawData.utm);
-        //write the tiff data
-        driver.produce_product(intermediateData, gdal_ds,
-                cmdLineArgs.get_calculation_code(prod),
-                cmdLineArgs.get_peaks_code(prod),
-                cmdLineArgs.get_variable_code(prod));
-
+    bool written = true;
+    for (size_t v = 0; v < volumes.size(); v++) {
+        LidarVolume &intermediateData = volumes[v];
+        //files are only named after their resolution when there are several
+        double resolution = volumes.size() > 1 ?
+            cmdLineArgs.resolutions[v] : 0;
+
+        //every product is open at once, so each row of peaks is read only
+        //once
+        std::vector<GDALDataset*> datasets;
+        std::vector<std::string> filenames;
+        if (cmdLineArgs.multiband) {
+            //every product as a band of one file
+            std::vector<std::string> band_descs;
+            for(const int& prod : cmdLineArgs.selected_products){
+                band_descs.push_back(cmdLineArgs.get_product_desc(prod));
+            }
+            filenames.push_back(cmdLineArgs.get_multiband_filename(
+                        resolution));
+            std::cout << "Writing GeoTIFF " << filenames.back() << std::endl;
+            datasets.push_back(driver.setup_gdal_ds(driverTiff,
+                        filenames.back(), band_descs,
+                        intermediateData.x_idx_extent,
+                        intermediateData.y_idx_extent,
+                        cmdLineArgs.raster_options));
+        } else {
+            for(const int& prod : cmdLineArgs.selected_products){
+                std::cout << "Writing GeoTIFF "
+                    << cmdLineArgs.get_product_desc(prod) << std::endl;
+                //Setup gdal dataset for this product
+                filenames.push_back(cmdLineArgs.get_output_filename(prod,
+                            resolution));
+                datasets.push_back(driver.setup_gdal_ds(driverTiff,
+                        filenames.back(), cmdLineArgs.get_product_desc(prod),
+                        intermediateData.x_idx_extent,
+                        intermediateData.y_idx_extent,
+                        cmdLineArgs.raster_options));
+            }
+        }
+        //each file is written on a thread of its own, sharing the memory
+        //allowed for blocks waiting to be written
+        RasterOptions writer_options = cmdLineArgs.raster_options;
+        if (writer_options.write_memory > 0) {
+            writer_options.write_memory = std::max<size_t>(1,
+                    writer_options.write_memory / datasets.size());
+        }
+        std::vector<RasterWriter*> writers;
+        for (GDALDataset *gdal_ds : datasets) {
+            //orient the tiff correctly
+            driver.geo_orient_gdal(intermediateData,gdal_ds,
+                    rawData.geog_cs, rawData.utm);
+            writers.push_back(new RasterWriter(gdal_ds, writer_options));
+        }
+
+        //a tiled volume is written a tile at a time, to every product at
+        //once
+        if (intermediateData.tiles != NULL) {
+            if (!driver.produce_tiled_products(intermediateData, writers,
+                        cmdLineArgs)) {
+                spdlog::critical("Unable to read back the peaks spilled to "
+                        "disk");
+                written = false;
+            }
+        } else {
+            ProductEngine engine;
+            driver.setup_product_engine(engine, cmdLineArgs);
+            driver.produce_products(intermediateData, engine, writers, 0, 0,
+                    cmdLineArgs.num_threads);
+        }
         //kill it with fire!
-        GDALClose((GDALDatasetH) gdal_ds);
+        for (size_t i = 0; i < datasets.size(); i++) {
+            if (!writers[i]->finish()) {
+                spdlog::error("Unable to write {}", filenames[i]);
+                written = false;
+            }
+            delete writers[i];
+            GDALClose((GDALDatasetH) datasets[i]);
+        }
+        intermediateData.deallocateMemory();
+    }
+    if (!written) {
+        spdlog::critical("Unable to write every product");
+        return 1;
     }
     GDALDestroyDriverManager();
-    intermediateData.deallocateMemory();
-    rawData.closeFlightLineData();
+    if (!cmdLineArgs.is_peak_store) {
+        rawData.closeFlightLineData();
+    }
 
     //Get end time
     Clock::time_point t2 = Clock::now();